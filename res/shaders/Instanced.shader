@@ -0,0 +1,39 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec2 corner;   // Corner of the quad, in [-1, 1]
+layout(location = 1) in vec2 position; // Per instance: center of the body
+layout(location = 2) in float radius;  // Per instance
+layout(location = 3) in vec4 color;    // Per instance, from normalized bytes
+
+uniform vec2 u_RadiusScale; // Turns a radius in world units into clip space on each axis, for the window's aspect ratio
+uniform vec2 u_MinHalfSize; // One pixel in clip space, so bodies smaller than a pixel still cover one
+
+out vec2 v_Corner;
+out vec4 v_Color;
+
+void main() 
+{
+    v_Corner = corner;
+    v_Color = color;
+    vec2 halfSize = max(radius * u_RadiusScale, u_MinHalfSize);
+    gl_Position = vec4(position + corner * halfSize, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_Corner;
+in vec4 v_Color;
+
+void main() 
+{
+    // Round the quad off into a circle
+    if (dot(v_Corner, v_Corner) > 1.0)
+    {
+        discard;
+    }
+    color = v_Color;
+}
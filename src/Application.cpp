@@ -47,16 +47,20 @@ std::optional<std::string> Application::HandleUpKey(const KeyAction action)
     switch (action)
     {
         case KEY_ACTION_PRESS:
-            // Move all y-positions up by 0.1 units
-            for (unsigned int i = 1; i < m_positionsLength; i += 2)
             {
-                m_positions[i] += 0.1f; // Move up by 0.1 units
-                if (m_positions[i] > 1.0f) // Wrap around if it goes off-screen
+                // Move all y-positions up by 0.1 units
+                float* const x = m_bodies.X();
+                float* const y = m_bodies.Y();
+                for (size_t i = 0; i < m_bodies.Size(); ++i)
                 {
-                    m_positions[i] = -1.0f + (m_positions[i] - 1.0f); // Wrap around to the bottom
-                }
+                    y[i] += 0.1f; // Move up by 0.1 units
+                    if (y[i] > 1.0f) // Wrap around if it goes off-screen
+                    {
+                        y[i] = -1.0f + (y[i] - 1.0f); // Wrap around to the bottom
+                    }
 
-                LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i / 2, m_positions[i - 1], m_positions[i]);
+                    LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i, x[i], y[i]);
+                }
             }
             m_updatePositions = true; // Set the flag to indicate positions have changed
             break;
@@ -77,16 +81,20 @@ std::optional<std::string> Application::HandleDownKey(const KeyAction action)
     switch (action)
     {
         case KEY_ACTION_PRESS:
-            // Move all y-positions down by 0.1 units
-            for (unsigned int i = 1; i < m_positionsLength; i += 2)
             {
-                m_positions[i] -= 0.1f; // Move down by 0.1 units
-                if (m_positions[i] < -1.0f) // Wrap around if it goes off-screen
+                // Move all y-positions down by 0.1 units
+                float* const x = m_bodies.X();
+                float* const y = m_bodies.Y();
+                for (size_t i = 0; i < m_bodies.Size(); ++i)
                 {
-                    m_positions[i] = 1.0f - (-1.0f - m_positions[i]); // Wrap around to the top
-                }
+                    y[i] -= 0.1f; // Move down by 0.1 units
+                    if (y[i] < -1.0f) // Wrap around if it goes off-screen
+                    {
+                        y[i] = 1.0f - (-1.0f - y[i]); // Wrap around to the top
+                    }
 
-                LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i / 2, m_positions[i - 1], m_positions[i]);
+                    LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i, x[i], y[i]);
+                }
             }
             m_updatePositions = true; // Set the flag to indicate positions have changed
             break;
@@ -105,16 +113,20 @@ std::optional<std::string> Application::HandleLeftKey(const KeyAction action)
     switch (action)
     {
         case KEY_ACTION_PRESS:
-            // Move all x-positions left by 0.1 units
-            for (unsigned int i = 0; i < m_positionsLength; i += 2)
             {
-                m_positions[i] -= 0.1f; // Move left by 0.1 units
-                if (m_positions[i] < -1.0f) // Wrap around if it goes off-screen
+                // Move all x-positions left by 0.1 units
+                float* const x = m_bodies.X();
+                float* const y = m_bodies.Y();
+                for (size_t i = 0; i < m_bodies.Size(); ++i)
                 {
-                    m_positions[i] = 1.0f - (-1.0f - m_positions[i]); // Wrap around to the right
-                }
+                    x[i] -= 0.1f; // Move left by 0.1 units
+                    if (x[i] < -1.0f) // Wrap around if it goes off-screen
+                    {
+                        x[i] = 1.0f - (-1.0f - x[i]); // Wrap around to the right
+                    }
 
-                LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i / 2, m_positions[i], m_positions[i+1]);
+                    LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i, x[i], y[i]);
+                }
             }
             m_updatePositions = true; // Set the flag to indicate positions have changed
             break;
@@ -133,16 +145,20 @@ std::optional<std::string> Application::HandleRightKey(const KeyAction action)
     switch (action)
     {
         case KEY_ACTION_PRESS:
-            // Move all x-positions right by 0.1 units
-            for (unsigned int i = 0; i < m_positionsLength; i += 2)
             {
-                m_positions[i] += 0.1f; // Move right by 0.1 units
-                if (m_positions[i] > 1.0f) // Wrap around if it goes off-screen
+                // Move all x-positions right by 0.1 units
+                float* const x = m_bodies.X();
+                float* const y = m_bodies.Y();
+                for (size_t i = 0; i < m_bodies.Size(); ++i)
                 {
-                    m_positions[i] = -1.0f + (m_positions[i] - 1.0f); // Wrap around to the left
-                }
+                    x[i] += 0.1f; // Move right by 0.1 units
+                    if (x[i] > 1.0f) // Wrap around if it goes off-screen
+                    {
+                        x[i] = -1.0f + (x[i] - 1.0f); // Wrap around to the left
+                    }
 
-                LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i / 2, m_positions[i], m_positions[i+1]);
+                    LOG(LogLevel::DEBUG, "Position {}: ({}, {})", i, x[i], y[i]);
+                }
             }
             m_updatePositions = true; // Set the flag to indicate positions have changed
             break;
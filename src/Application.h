@@ -8,6 +8,8 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "BodyStore.h"
+
 typedef enum
 {
     KEY_ACTION_PRESS    = GLFW_PRESS,
@@ -18,11 +20,7 @@ class Application
 {
     public:
         bool m_updatePositions = false;
-        float* m_positions = nullptr;
-        unsigned int m_positionsLength = 0;
-
-        unsigned int* m_indices = nullptr;
-        unsigned int m_indicesLength = 0;
+        BodyStore m_bodies; // Every body in the simulation, read by the physics step and the renderer
 
         // void SetPositions(float* const positions, const unsigned int positionsLength);
         // void SetIndices(unsigned int* const indices, const unsigned int indicesLength);
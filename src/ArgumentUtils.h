@@ -0,0 +1,19 @@
+#ifndef ARGUMENT_UTILS_H
+#define ARGUMENT_UTILS_H
+// ArgumentUtils.h
+// Small helpers shared by the command line parsers of the application and the benchmark.
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+// Parse a whole argument as a number
+template <typename T>
+inline bool ParseNumber(const std::string_view text, T& value)
+{
+    const char* end = text.data() + text.size();
+    const std::from_chars_result result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+#endif // !ARGUMENT_UTILS_H
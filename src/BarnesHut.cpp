@@ -0,0 +1,297 @@
+#include "BarnesHut.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "Integrator.h"
+#include "Profiler.h"
+
+// Leaves per job, and bodies per job for everything done per body
+static constexpr size_t LEAF_GRAIN = 16;
+static constexpr size_t ITEM_GRAIN = 16384;
+
+// Call function(begin, end) over [0, count), on the job system if there is one
+template <typename Function>
+static void ParallelRange(JobSystem* jobs, const size_t count, const size_t grainSize, Function&& function)
+{
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(count, grainSize, function);
+    }
+    else if (count > 0)
+    {
+        function(size_t{0}, count);
+    }
+}
+
+// Add the pull of count interactions (a multiple of LANES) on a body at (x, y), without G
+static void SumInteractions(const float* listX, const float* listY, const float* listMass, const size_t count,
+                            const float x, const float y, const float softening2, float& sumX, float& sumY)
+{
+    constexpr size_t LANES = BarnesHutTree::LANES;
+
+    // Branch free over a fixed number of lanes, so the compiler turns each line into SIMD instructions.
+    // A body's own entry has zero distance and adds nothing.
+    float accelX[LANES] = {};
+    float accelY[LANES] = {};
+    for (size_t block = 0; block < count; block += LANES)
+    {
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            const float dx = listX[block + lane] - x;
+            const float dy = listY[block + lane] - y;
+            const float inverseDistance = 1.0f / std::sqrt(dx * dx + dy * dy + softening2);
+            const float strength = listMass[block + lane] * inverseDistance * inverseDistance * inverseDistance;
+            accelX[lane] += dx * strength;
+            accelY[lane] += dy * strength;
+        }
+    }
+
+    for (size_t lane = 0; lane < LANES; ++lane)
+    {
+        sumX += accelX[lane];
+        sumY += accelY[lane];
+    }
+}
+
+BarnesHutTree::BarnesHutTree(const GravitySettings& settings)
+    : m_settings(settings)
+{
+}
+
+void BarnesHutTree::Build(const BodyStore& bodies, JobSystem* jobs)
+{
+    PROFILE_SCOPE("GravityBuild");
+
+    const size_t count = bodies.Size();
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    const float* const mass = bodies.Mass();
+    m_order.Sort(x, y, count, jobs);
+
+    // Copies in Morton order, so every node's bodies are contiguous
+    const std::vector<uint32_t>& order = m_order.GetOrder();
+    m_sortedX.resize(count);
+    m_sortedY.resize(count);
+    m_sortedMass.resize(count);
+    ParallelRange(jobs, count, ITEM_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_sortedX[i] = x[order[i]];
+            m_sortedY[i] = y[order[i]];
+            m_sortedMass[i] = mass[order[i]];
+        }
+    });
+
+    m_nodes.clear();
+    m_leaves.clear();
+    if (count > 0)
+    {
+        BuildNode(0, static_cast<uint32_t>(count), 0);
+    }
+
+    // Leaves sum their bodies, each leaf touches only its own node
+    ParallelRange(jobs, m_leaves.size(), LEAF_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            Leaf& leaf = m_leaves[i];
+            Node& node = m_nodes[leaf.node];
+            float minX = m_sortedX[node.begin];
+            float minY = m_sortedY[node.begin];
+            float maxX = minX;
+            float maxY = minY;
+            float totalMass = 0.0f;
+            float weightedX = 0.0f;
+            float weightedY = 0.0f;
+            for (uint32_t body = node.begin; body < node.end; ++body)
+            {
+                minX = std::min(minX, m_sortedX[body]);
+                minY = std::min(minY, m_sortedY[body]);
+                maxX = std::max(maxX, m_sortedX[body]);
+                maxY = std::max(maxY, m_sortedY[body]);
+                totalMass += m_sortedMass[body];
+                weightedX += m_sortedMass[body] * m_sortedX[body];
+                weightedY += m_sortedMass[body] * m_sortedY[body];
+            }
+
+            leaf.centerX = 0.5f * (minX + maxX);
+            leaf.centerY = 0.5f * (minY + maxY);
+            leaf.halfWidth = 0.5f * (maxX - minX);
+            leaf.halfHeight = 0.5f * (maxY - minY);
+            node.mass = totalMass;
+            node.comX = (totalMass > 0.0f) ? weightedX / totalMass : leaf.centerX;
+            node.comY = (totalMass > 0.0f) ? weightedY / totalMass : leaf.centerY;
+        }
+    });
+
+    // Children follow their parent, so going backwards every child is done before its parent
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        Node& node = m_nodes[i];
+        if (node.next == i + 1)
+        {
+            continue;
+        }
+
+        float totalMass = 0.0f;
+        float weightedX = 0.0f;
+        float weightedY = 0.0f;
+        for (uint32_t child = static_cast<uint32_t>(i) + 1; child < node.next; child = m_nodes[child].next)
+        {
+            totalMass += m_nodes[child].mass;
+            weightedX += m_nodes[child].mass * m_nodes[child].comX;
+            weightedY += m_nodes[child].mass * m_nodes[child].comY;
+        }
+        node.mass = totalMass;
+        node.comX = (totalMass > 0.0f) ? weightedX / totalMass : m_nodes[i + 1].comX;
+        node.comY = (totalMass > 0.0f) ? weightedY / totalMass : m_nodes[i + 1].comY;
+    }
+}
+
+void BarnesHutTree::BuildNode(const uint32_t begin, const uint32_t end, const uint32_t level)
+{
+    const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    Node node;
+    node.size = WORLD_SIZE / static_cast<float>(1u << level);
+    node.begin = begin;
+    node.end = end;
+    m_nodes.push_back(node);
+
+    if (end - begin <= LEAF_SIZE || level == MORTON_BITS)
+    {
+        m_nodes[index].next = index + 1;
+        m_leaves.push_back(Leaf{index});
+        return;
+    }
+
+    // The quadrant of a child is the 2 bits of the code below the node's own prefix. The codes are sorted,
+    // so every quadrant is a range that a binary search finds.
+    const std::vector<uint32_t>& codes = m_order.GetCodes();
+    const uint32_t shift = 2 * (MORTON_BITS - 1 - level);
+    const uint32_t prefix = codes[begin] & ~((4u << shift) - 1u);
+    uint32_t childBegin = begin;
+    for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        const uint32_t childEnd = (quadrant == 3) ? end :
+            static_cast<uint32_t>(std::lower_bound(codes.begin() + childBegin, codes.begin() + end, prefix | ((quadrant + 1) << shift)) - codes.begin());
+        if (childEnd > childBegin)
+        {
+            BuildNode(childBegin, childEnd, level + 1);
+        }
+        childBegin = childEnd;
+    }
+    m_nodes[index].next = static_cast<uint32_t>(m_nodes.size());
+}
+
+void BarnesHutTree::ComputeAccelerations(float* ax, float* ay, JobSystem* jobs)
+{
+    PROFILE_SCOPE("GravityForces");
+
+    std::atomic<uint64_t> interactionCount{0};
+    ParallelRange(jobs, m_leaves.size(), LEAF_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        std::vector<float> listX;
+        std::vector<float> listY;
+        std::vector<float> listMass;
+        uint64_t interactions = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            interactions += ComputeLeaf(m_leaves[i], listX, listY, listMass, ax, ay);
+        }
+        interactionCount.fetch_add(interactions, std::memory_order_relaxed);
+    });
+    m_interactionCount = interactionCount.load(std::memory_order_relaxed);
+}
+
+uint64_t BarnesHutTree::ComputeLeaf(const Leaf& leaf, std::vector<float>& listX, std::vector<float>& listY, std::vector<float>& listMass,
+                                    float* ax, float* ay) const
+{
+    listX.clear();
+    listY.clear();
+    listMass.clear();
+
+    const float theta2 = m_settings.openingAngle * m_settings.openingAngle;
+    const uint32_t nodeCount = static_cast<uint32_t>(m_nodes.size());
+    uint32_t index = 0;
+    while (index < nodeCount)
+    {
+        const Node& node = m_nodes[index];
+        if (node.mass == 0.0f)
+        {
+            index = node.next;
+            continue;
+        }
+
+        // Distance from the center of mass to the nearest point of the leaf's box
+        const float gapX = std::max(std::fabs(node.comX - leaf.centerX) - leaf.halfWidth, 0.0f);
+        const float gapY = std::max(std::fabs(node.comY - leaf.centerY) - leaf.halfHeight, 0.0f);
+        if (node.size * node.size < theta2 * (gapX * gapX + gapY * gapY))
+        {
+            listX.push_back(node.comX);
+            listY.push_back(node.comY);
+            listMass.push_back(node.mass);
+            index = node.next;
+            continue;
+        }
+
+        if (node.next == index + 1)
+        {
+            listX.insert(listX.end(), m_sortedX.begin() + node.begin, m_sortedX.begin() + node.end);
+            listY.insert(listY.end(), m_sortedY.begin() + node.begin, m_sortedY.begin() + node.end);
+            listMass.insert(listMass.end(), m_sortedMass.begin() + node.begin, m_sortedMass.begin() + node.end);
+        }
+        index = index + 1;
+    }
+
+    // Pad to whole blocks of lanes with entries that have no mass
+    const size_t listSize = listMass.size();
+    const size_t paddedSize = (listSize + LANES - 1) / LANES * LANES;
+    listX.resize(paddedSize, leaf.centerX);
+    listY.resize(paddedSize, leaf.centerY);
+    listMass.resize(paddedSize, 0.0f);
+
+    const Node& leafNode = m_nodes[leaf.node];
+    const std::vector<uint32_t>& order = m_order.GetOrder();
+    const float softening2 = m_settings.softening * m_settings.softening;
+    for (uint32_t body = leafNode.begin; body < leafNode.end; ++body)
+    {
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+        SumInteractions(listX.data(), listY.data(), listMass.data(), paddedSize, m_sortedX[body], m_sortedY[body], softening2, sumX, sumY);
+        ax[order[body]] = m_settings.gravitationalConstant * sumX;
+        ay[order[body]] = m_settings.gravitationalConstant * sumY;
+    }
+    return static_cast<uint64_t>(listSize) * (leafNode.end - leafNode.begin);
+}
+
+void BarnesHutTree::ComputeDirect(const BodyStore& bodies, const GravitySettings& settings, float* ax, float* ay, JobSystem* jobs)
+{
+    PROFILE_SCOPE("GravityDirect");
+
+    const size_t count = bodies.Size();
+    const size_t paddedCount = (count + LANES - 1) / LANES * LANES;
+    const float softening2 = settings.softening * settings.softening;
+
+    // Copies padded to whole blocks of lanes with bodies that have no mass
+    std::vector<float> x(paddedCount, 0.0f);
+    std::vector<float> y(paddedCount, 0.0f);
+    std::vector<float> mass(paddedCount, 0.0f);
+    std::copy(bodies.X(), bodies.X() + count, x.begin());
+    std::copy(bodies.Y(), bodies.Y() + count, y.begin());
+    std::copy(bodies.Mass(), bodies.Mass() + count, mass.begin());
+
+    ParallelRange(jobs, count, 64, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            float sumX = 0.0f;
+            float sumY = 0.0f;
+            SumInteractions(x.data(), y.data(), mass.data(), paddedCount, x[i], y[i], softening2, sumX, sumY);
+            ax[i] = settings.gravitationalConstant * sumX;
+            ay[i] = settings.gravitationalConstant * sumY;
+        }
+    });
+}
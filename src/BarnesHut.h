@@ -0,0 +1,102 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+// BarnesHut.h
+// This file contains N-body gravity, computed with a Barnes-Hut quadtree.
+// Every step the bodies are sorted by Morton code, and the quadtree is cut out of the
+// sorted order: each node is a contiguous range of it. The nodes are stored depth first
+// in one array. A node's first child directly follows it, and every node knows the
+// index just past its subtree, so walking the tree is a loop over the array with no
+// stack. A node far enough away (its size divided by its distance is below the opening
+// angle theta) pulls with its total mass from its center of mass; nearer ones are opened.
+// The tree is walked once per leaf rather than once per body: the nodes accepted for the
+// leaf's bounding box form an interaction list that every body of the leaf then sums in
+// blocks of SIMD lanes. Leaves are spread over a JobSystem.
+// Gravity doesn't wrap around the world's edges like positions do: bodies pull on each
+// other across the world, not through its edges.
+// ComputeDirect sums every pair exactly, as the reference the tree is measured against.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BodyStore.h"
+#include "JobSystem.h"
+#include "Morton.h"
+
+struct GravitySettings
+{
+    float gravitationalConstant = 1e-6f;
+    float openingAngle          = 0.7f; // Theta, larger is faster and less accurate. 0 opens every node.
+    float softening             = 0.5f * BODY_DEFAULT_RADIUS; // Plummer length, so close bodies don't fling each other away
+};
+
+class BarnesHutTree
+{
+public:
+    // Most bodies in a leaf, the bodies of one leaf share an interaction list
+    static constexpr uint32_t LEAF_SIZE = 16;
+
+    // Interactions summed together, one per SIMD lane
+    static constexpr size_t LANES = 8;
+
+    explicit BarnesHutTree(const GravitySettings& settings = {});
+
+    // Build the tree over the bodies' current positions and masses
+    void Build(const BodyStore& bodies, JobSystem* jobs = nullptr);
+
+    // Write the acceleration gravity gives every body of the last Build, by array index.
+    // ax and ay need room for the bodies of that Build.
+    void ComputeAccelerations(float* ax, float* ay, JobSystem* jobs = nullptr);
+
+    // The same accelerations from every pair of bodies, O(n^2)
+    static void ComputeDirect(const BodyStore& bodies, const GravitySettings& settings, float* ax, float* ay, JobSystem* jobs = nullptr);
+
+    const GravitySettings& GetSettings() const { return m_settings; }
+    void SetSettings(const GravitySettings& settings) { m_settings = settings; }
+
+    // Statistics of the last Build and ComputeAccelerations
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    size_t GetLeafCount() const { return m_leaves.size(); }
+    uint64_t GetInteractionCount() const { return m_interactionCount; } // Body-node and body-body terms summed
+
+private:
+    struct Node
+    {
+        float    comX = 0.0f;   // Center of mass
+        float    comY = 0.0f;
+        float    mass = 0.0f;
+        float    size = 0.0f;   // Side of the node's cell
+        uint32_t begin = 0;     // Bodies [begin, end) in Morton order
+        uint32_t end = 0;
+        uint32_t next = 0;      // Index past the subtree, a leaf's is its own index + 1
+    };
+
+    // A leaf with the box around its bodies, the unit the tree is walked for
+    struct Leaf
+    {
+        uint32_t node = 0;
+        float    centerX = 0.0f;
+        float    centerY = 0.0f;
+        float    halfWidth = 0.0f;
+        float    halfHeight = 0.0f;
+    };
+
+    GravitySettings    m_settings;
+    MortonOrder        m_order;
+    std::vector<float> m_sortedX;    // Positions and masses in Morton order
+    std::vector<float> m_sortedY;
+    std::vector<float> m_sortedMass;
+    std::vector<Node>  m_nodes;      // Depth first
+    std::vector<Leaf>  m_leaves;     // In Morton order
+    uint64_t           m_interactionCount = 0;
+
+    // Append the node of the bodies [begin, end) in the cell at level and its subtree
+    void BuildNode(uint32_t begin, uint32_t end, uint32_t level);
+
+    // Walk the tree for the leaf's box into an interaction list, then sum its pull on each of the leaf's bodies.
+    // Returns the interactions summed.
+    uint64_t ComputeLeaf(const Leaf& leaf, std::vector<float>& listX, std::vector<float>& listY, std::vector<float>& listMass,
+                         float* ax, float* ay) const;
+};
+
+#endif // !BARNES_HUT_H
@@ -0,0 +1,293 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string_view>
+#include <thread>
+
+#include "ArgumentUtils.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "Simulation.h"
+#include "Timer.h"
+
+// Bodies in each scenario when the config doesn't set a count
+static constexpr size_t PILE_BODIES = 20000;
+static constexpr size_t DISK_BODIES = 50000;
+static constexpr size_t GAS_BODIES  = 50000;
+
+static constexpr float  BENCHMARK_DT = 1.0f / 120.0f;
+static constexpr float  PI           = 3.14159265f;
+
+static constexpr BenchmarkScenario ALL_SCENARIOS[] = {BenchmarkScenario::PILE, BenchmarkScenario::DISK, BenchmarkScenario::GAS};
+
+// Mix 64 bits so that every input bit affects every output bit (the SplitMix64 finalizer)
+static uint64_t Mix(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+const char* BenchmarkScenarioToString(const BenchmarkScenario scenario)
+{
+    switch (scenario)
+    {
+        case BenchmarkScenario::PILE: return "pile";
+        case BenchmarkScenario::DISK: return "disk";
+        case BenchmarkScenario::GAS:  return "gas";
+    }
+    return "unknown";
+}
+
+bool ParseBenchmarkArguments(const int argc, char** argv, BenchmarkConfig& config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        bool valid = true;
+        if (argument == "--scenario" && hasValue)
+        {
+            const std::string_view name = argv[++i];
+            if      (name == "pile") config.scenarios.push_back(BenchmarkScenario::PILE);
+            else if (name == "disk") config.scenarios.push_back(BenchmarkScenario::DISK);
+            else if (name == "gas")  config.scenarios.push_back(BenchmarkScenario::GAS);
+            else                     valid = false;
+        }
+        else if (argument == "--steps" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.steps) && config.steps > 0;
+        }
+        else if (argument == "--bodies" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.bodies);
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.threads);
+        }
+        else if (argument == "--simd" && hasValue)
+        {
+            const std::string_view name = argv[++i];
+            if      (name == "scalar") config.simdLevel = SimdLevel::SCALAR;
+            else if (name == "sse")    config.simdLevel = SimdLevel::SSE;
+            else if (name == "avx2")   config.simdLevel = SimdLevel::AVX2;
+            else                       valid = false;
+        }
+        else if (argument == "--no-reorder")
+        {
+            config.reorder = false;
+        }
+        else if (argument == "--verify")
+        {
+            config.verify = true;
+        }
+        else if (argument == "--csv" && hasValue)
+        {
+            config.csvPath = argv[++i];
+        }
+        else
+        {
+            LOG(LogLevel::ERROR, "Unknown argument {}. Usage: [--scenario pile|disk|gas]... [--steps N] [--bodies N] [--threads N] "
+                "[--simd scalar|sse|avx2] [--no-reorder] [--verify] [--csv PATH]", argument);
+            return false;
+        }
+
+        if (!valid)
+        {
+            LOG(LogLevel::ERROR, "Invalid value {} for {}", std::string_view(argv[i]), argument);
+            return false;
+        }
+    }
+    return true;
+}
+
+//===============================================================
+// Scenarios
+//===============================================================
+
+// A block of bodies above a floor of static bodies that spans the world, pulled down by a uniform field
+static void BuildPile(BodyStore& bodies, Simulation& simulation, const size_t count, std::mt19937& random)
+{
+    // The block is up to 1.6 wide and tall, with a small gap between neighbours so nothing starts overlapping
+    const float radius = std::min(BODY_DEFAULT_RADIUS, 1.6f / (2.1f * std::sqrt(static_cast<float>(std::max<size_t>(count, 1)))));
+    const float spacing = 2.1f * radius;
+    const size_t columns = std::max<size_t>(static_cast<size_t>(1.6f / spacing), 1);
+    std::uniform_real_distribution<float> jitter(-0.02f * radius, 0.02f * radius);
+
+    const size_t floorCount = static_cast<size_t>(WORLD_SIZE / (2.0f * radius));
+    const float floorY = WORLD_MIN + 0.05f;
+    for (size_t i = 0; i < floorCount; ++i)
+    {
+        bodies.Add(WORLD_MIN + (static_cast<float>(i) + 0.5f) * (WORLD_SIZE / floorCount), floorY, 0.0f, 0.0f, 0.0f, BODY_FLAG_STATIC, radius);
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float x = -0.8f + (static_cast<float>(i % columns) + 0.5f) * spacing + jitter(random);
+        const float y = floorY + 4.0f * radius + static_cast<float>(i / columns) * spacing;
+        bodies.Add(x, y, 0.0f, 0.0f, 1.0f, BODY_FLAG_NONE, radius);
+    }
+
+    ForceField forces;
+    forces.gravityY = -2.0f;
+    simulation.SetForceField(forces);
+    simulation.EnableContacts();
+}
+
+// A uniform disk, every body on a circular orbit around the mass inside it
+static void BuildDisk(BodyStore& bodies, Simulation& simulation, const size_t count, std::mt19937& random)
+{
+    const GravitySettings gravity;
+    const float diskRadius = 0.8f;
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // The square root spreads the bodies evenly over the area
+        const float distance = diskRadius * std::sqrt(unit(random));
+        const float angle = 2.0f * PI * unit(random);
+        const float enclosedMass = static_cast<float>(count) * (distance * distance) / (diskRadius * diskRadius);
+        const float speed = std::sqrt(gravity.gravitationalConstant * enclosedMass / std::max(distance, gravity.softening));
+        const float directionX = std::cos(angle);
+        const float directionY = std::sin(angle);
+        bodies.Add(distance * directionX, distance * directionY, -speed * directionY, speed * directionX);
+    }
+    simulation.EnableGravity(gravity);
+}
+
+// Fast bodies over the whole world, shrunk to cover about a third of it so each touches a few others
+static void BuildGas(BodyStore& bodies, Simulation& simulation, const size_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+    std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+    const float radius = std::min(BODY_DEFAULT_RADIUS, std::sqrt(WORLD_SIZE * WORLD_SIZE / (3.0f * PI * std::max<size_t>(count, 1))));
+    for (size_t i = 0; i < count; ++i)
+    {
+        bodies.Add(position(random), position(random), velocity(random), velocity(random), 1.0f, BODY_FLAG_NONE, radius);
+    }
+    simulation.EnableContacts();
+}
+
+BenchmarkResult RunBenchmarkScenario(const BenchmarkScenario scenario, const BenchmarkConfig& config, const unsigned int threads)
+{
+    size_t count = config.bodies;
+    if (count == 0)
+    {
+        count = (scenario == BenchmarkScenario::PILE) ? PILE_BODIES : (scenario == BenchmarkScenario::DISK) ? DISK_BODIES : GAS_BODIES;
+    }
+
+    BodyStore bodies(count);
+    JobSystem jobs(threads);
+    Simulation simulation(bodies, IntegratorType::SEMI_IMPLICIT_EULER, config.simdLevel);
+    simulation.SetJobSystem(&jobs);
+    if (config.reorder)
+    {
+        simulation.EnableReordering();
+    }
+
+    std::mt19937 random(12345);
+    switch (scenario)
+    {
+        case BenchmarkScenario::PILE: BuildPile(bodies, simulation, count, random); break;
+        case BenchmarkScenario::DISK: BuildDisk(bodies, simulation, count, random); break;
+        case BenchmarkScenario::GAS:  BuildGas(bodies, simulation, count, random);  break;
+    }
+
+    Timer runTimer{false};
+    runTimer.Start();
+    for (size_t step = 0; step < config.steps; ++step)
+    {
+        simulation.Step(BENCHMARK_DT);
+    }
+    const std::chrono::microseconds runTime = runTimer.Stop();
+
+    BenchmarkResult result;
+    result.scenario = scenario;
+    result.bodies = bodies.Size();
+    result.steps = config.steps;
+    result.seconds = std::max(static_cast<double>(runTime.count()) * 1e-6, 1e-9);
+    result.stepsPerSecond = static_cast<double>(result.steps) / result.seconds;
+    result.nsPerBodyStep = result.seconds * 1e9 / std::max(static_cast<double>(result.steps * result.bodies), 1.0);
+    result.peakRssBytes = GetPeakResidentBytes();
+    result.checksum = BodyStateChecksum(bodies);
+    return result;
+}
+
+int RunBenchmarks(const BenchmarkConfig& config)
+{
+    std::vector<BenchmarkScenario> scenarios = config.scenarios;
+    if (scenarios.empty())
+    {
+        scenarios.assign(std::begin(ALL_SCENARIOS), std::end(ALL_SCENARIOS));
+    }
+
+    const unsigned int threads = (config.threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : config.threads;
+    const SimdLevel simdLevel = Integrator(IntegratorType::SEMI_IMPLICIT_EULER, config.simdLevel).GetSimdLevel();
+    LOG(LogLevel::INFO, "Benchmark: {} steps per scenario at {} Hz, {} threads, {}, reordering {}", config.steps,
+        std::lround(1.0f / BENCHMARK_DT), threads, SimdLevelToString(simdLevel), config.reorder ? "on" : "off");
+
+    int exitCode = 0;
+    std::vector<BenchmarkResult> results;
+    for (const BenchmarkScenario scenario : scenarios)
+    {
+        const BenchmarkResult result = RunBenchmarkScenario(scenario, config, threads);
+        LOG(LogLevel::INFO, "{:<4}: {:>8} bodies, {:.3f}s, {:9.1f} steps/s, {:8.2f} ns per body step, peak RSS {:.1f} MiB, checksum {:016x}",
+            BenchmarkScenarioToString(scenario), result.bodies, result.seconds, result.stepsPerSecond, result.nsPerBodyStep,
+            static_cast<double>(result.peakRssBytes) / (1024.0 * 1024.0), result.checksum);
+        results.push_back(result);
+
+        if (config.verify)
+        {
+            const BenchmarkResult serial = RunBenchmarkScenario(scenario, config, 1);
+            if (serial.checksum != result.checksum)
+            {
+                LOG(LogLevel::ERROR, "{}: checksum {:016x} on {} threads but {:016x} on one thread, the simulation is not deterministic",
+                    BenchmarkScenarioToString(scenario), result.checksum, threads, serial.checksum);
+                exitCode = 1;
+            }
+            else
+            {
+                LOG(LogLevel::INFO, "{}: checksum matches on one thread", BenchmarkScenarioToString(scenario));
+            }
+        }
+    }
+
+    if (!config.csvPath.empty())
+    {
+        std::ofstream csv(config.csvPath);
+        csv << "scenario,bodies,steps,threads,seconds,steps_per_second,ns_per_body_step,peak_rss_bytes,checksum\n";
+        for (const BenchmarkResult& result : results)
+        {
+            csv << std::format("{},{},{},{},{:.6f},{:.3f},{:.3f},{},{:016x}\n", BenchmarkScenarioToString(result.scenario), result.bodies,
+                               result.steps, threads, result.seconds, result.stepsPerSecond, result.nsPerBodyStep, result.peakRssBytes,
+                               result.checksum);
+        }
+        if (!csv)
+        {
+            LOG(LogLevel::ERROR, "Failed to write the results to {}", config.csvPath);
+            exitCode = 1;
+        }
+    }
+    return exitCode;
+}
+
+uint64_t BodyStateChecksum(const BodyStore& bodies)
+{
+    // Each body hashes to one value and the values are summed, which doesn't depend on their order
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < bodies.Size(); ++i)
+    {
+        const BodyHandle handle = bodies.HandleAt(i);
+        uint64_t hash = Mix(handle.slot | (static_cast<uint64_t>(handle.generation) << 32));
+        hash = Mix(hash ^ (std::bit_cast<uint32_t>(bodies.X()[i]) | (static_cast<uint64_t>(std::bit_cast<uint32_t>(bodies.Y()[i])) << 32)));
+        hash = Mix(hash ^ (std::bit_cast<uint32_t>(bodies.VX()[i]) | (static_cast<uint64_t>(std::bit_cast<uint32_t>(bodies.VY()[i])) << 32)));
+        checksum += hash;
+    }
+    return checksum;
+}
@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+// Benchmark.h
+// This file contains the headless benchmark scenarios run by PhysicsSimBench.
+// Every scenario builds its bodies from a fixed seed, runs a fixed number of steps and
+// reports steps per second, nanoseconds per body step, the peak resident memory of the
+// process and a checksum of the final state. Only the simulation core is used, no window
+// or OpenGL, so the benchmark runs on machines without a GPU.
+// The checksum covers every body's position and velocity bits under its handle, so it
+// doesn't depend on the order of the arrays and any change to the results (a new SIMD
+// path, a reordered sum, a race) changes it. With --verify every scenario is run again
+// on a single thread and the two checksums must match. The random scenes come from the
+// standard library's distributions, so checksums are only compared between builds made
+// with the same standard library.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BodyStore.h"
+#include "Integrator.h"
+
+enum class BenchmarkScenario
+{
+    PILE, // Bodies falling onto a static floor and settling into a pile, contacts only
+    DISK, // A rotating disk held together by Barnes-Hut gravity, no contacts
+    GAS   // Fast bodies spread over the whole world, bouncing off each other
+};
+
+const char* BenchmarkScenarioToString(BenchmarkScenario scenario);
+
+struct BenchmarkConfig
+{
+    std::vector<BenchmarkScenario> scenarios; // Empty runs every scenario
+    size_t       steps     = 300;   // Steps per scenario
+    size_t       bodies    = 0;     // Bodies per scenario, 0 for each scenario's own count
+    unsigned int threads   = 0;     // Threads running physics jobs, 0 for every hardware thread
+    SimdLevel    simdLevel = SimdLevel::AVX2;
+    bool         reorder   = true;  // Keep the bodies sorted by Morton code
+    bool         verify    = false; // Run every scenario again on one thread and compare the checksums
+    std::string  csvPath;           // Also write the results to this file if not empty
+};
+
+struct BenchmarkResult
+{
+    BenchmarkScenario scenario = BenchmarkScenario::PILE;
+    size_t   bodies          = 0;
+    size_t   steps           = 0;
+    double   seconds         = 0.0; // Time spent stepping, without the setup
+    double   stepsPerSecond  = 0.0;
+    double   nsPerBodyStep   = 0.0;
+    size_t   peakRssBytes    = 0;   // Of the whole process so far, 0 if unknown
+    uint64_t checksum        = 0;
+};
+
+// Parse the program arguments into config. Returns false (after logging why) if they are invalid.
+// Supported: --scenario <pile|disk|gas> (repeatable), --steps <n>, --bodies <n>, --threads <n>,
+// --simd <scalar|sse|avx2>, --no-reorder, --verify, --csv <path>
+bool ParseBenchmarkArguments(int argc, char** argv, BenchmarkConfig& config);
+
+// Run one scenario, threads 1 runs it on the calling thread only
+BenchmarkResult RunBenchmarkScenario(BenchmarkScenario scenario, const BenchmarkConfig& config, unsigned int threads);
+
+// Run the configured scenarios and log the results. Returns the process exit code,
+// non-zero if a checksum didn't match with --verify or the CSV file couldn't be written.
+int RunBenchmarks(const BenchmarkConfig& config);
+
+// Order independent checksum of every body's handle, position and velocity bits
+uint64_t BodyStateChecksum(const BodyStore& bodies);
+
+#endif // !BENCHMARK_H
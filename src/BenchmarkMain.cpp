@@ -0,0 +1,19 @@
+// Project includes
+#include "Logger.h"
+#include "Benchmark.h"
+
+// PhysicsSimBench runs the benchmark scenarios without a window. It is built from the same
+// core library as PhysicsSim, without OpenGL, GLFW or GLEW, so it runs on machines without a GPU.
+int main(int argc, char** argv)
+{
+    // Create the logger object, the results are logged
+    Logger logger;
+    loggerPtr = &logger;
+
+    BenchmarkConfig config;
+    if (!ParseBenchmarkArguments(argc, argv, config))
+    {
+        return -1;
+    }
+    return RunBenchmarks(config);
+}
@@ -0,0 +1,174 @@
+#include "BodyRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include "Simulation.h"
+
+// Bodies per job when packing the styles
+static constexpr size_t STYLE_GRAIN = 16384;
+
+// Instances the streaming buffers have room for before they first grow
+static constexpr unsigned int INITIAL_INSTANCES = 1024;
+
+// Speed at which a body's color is halfway from slow to fast
+static constexpr float HALF_COLOR_SPEED = 0.5f;
+
+static constexpr float QUAD_CORNERS[] = {-1.0f, -1.0f,
+                                          1.0f, -1.0f,
+                                          1.0f,  1.0f,
+                                         -1.0f,  1.0f};
+
+static constexpr unsigned int QUAD_INDICES[] = {0, 1, 2,
+                                                2, 3, 0};
+
+BodyRenderer::BodyRenderer(const std::string& shaderPath, const bool allowPersistent)
+    : m_quad(QUAD_CORNERS, sizeof(QUAD_CORNERS)),
+      m_ib(QUAD_INDICES, sizeof(QUAD_INDICES) / sizeof(QUAD_INDICES[0])),
+      m_positions(INITIAL_INSTANCES * 2 * sizeof(float), allowPersistent),
+      m_styles(INITIAL_INSTANCES * sizeof(BodyStyle), allowPersistent),
+      m_shader(shaderPath)
+{
+    // Locations 0 to 3 in the order the shader declares them: corner, then position, radius and color per instance
+    VertexBufferLayout quadLayout;
+    quadLayout.Push<float>(2);
+    m_quadLayout = quadLayout.Share();
+
+    VertexBufferLayout positionLayout;
+    positionLayout.Push<float>(2, 1);
+    m_positionLayout = positionLayout.Share();
+
+    VertexBufferLayout styleLayout;
+    styleLayout.Push<float>(1, 1);
+    styleLayout.Push<unsigned char>(4, 1);
+    m_styleLayout = styleLayout.Share();
+}
+
+void BodyRenderer::Update(const BodyStore& bodies, const Simulation& simulation, const float alpha, JobSystem* jobs)
+{
+    PROFILE_SCOPE("BodyRendererUpdate");
+
+    // Both buffers are written in place, in mapped memory the GPU reads from
+    const size_t count = bodies.Size();
+    float* const positions = static_cast<float*>(m_positions.Map(static_cast<unsigned int>(2 * count * sizeof(float))));
+    if (positions != nullptr)
+    {
+        simulation.InterpolatePositions(alpha, positions);
+    }
+    m_positions.Unmap();
+
+    BodyStyle* const styles = static_cast<BodyStyle*>(m_styles.Map(static_cast<unsigned int>(count * sizeof(BodyStyle))));
+    const float* const radius = bodies.Radius();
+    const float* const vx = bodies.VX();
+    const float* const vy = bodies.VY();
+    const uint32_t* const flags = bodies.Flags();
+    const auto pack = [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            BodyStyle style;
+            style.radius = radius[i];
+            if ((flags[i] & BODY_FLAG_STATIC) != 0)
+            {
+                style.color[0] = 150;
+                style.color[1] = 150;
+                style.color[2] = 150;
+            }
+            else
+            {
+                // Blue when slow, orange when fast
+                const float speed = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+                const float t = speed / (speed + HALF_COLOR_SPEED);
+                style.color[0] = static_cast<uint8_t>(60.0f + t * (255.0f - 60.0f));
+                style.color[1] = static_cast<uint8_t>(110.0f + t * (140.0f - 110.0f));
+                style.color[2] = static_cast<uint8_t>(255.0f + t * (40.0f - 255.0f));
+            }
+            style.color[3] = 255;
+
+            // Whole structs only, the mapped memory may be write-combined
+            styles[i] = style;
+        }
+    };
+    if (styles != nullptr && jobs != nullptr)
+    {
+        jobs->ParallelFor(count, STYLE_GRAIN, pack);
+    }
+    else if (styles != nullptr)
+    {
+        pack(0, count);
+    }
+    m_styles.Unmap();
+
+    if (positions == nullptr || styles == nullptr)
+    {
+        LOG(LogLevel::ERROR, "Failed to map the instance buffers, the bodies are not drawn");
+        m_instanceCount = 0;
+        return;
+    }
+
+    // A grown buffer has a new ID, which a deleted one's VAOs could be mistaken for later
+    if (m_positions.GetRendererId() != m_positionsId || m_styles.GetRendererId() != m_stylesId)
+    {
+        m_vertexArrays.Clear();
+        m_positionsId = m_positions.GetRendererId();
+        m_stylesId = m_styles.GetRendererId();
+    }
+
+    // The instance attributes read from the regions just written, through the VAO recorded for them
+    const VertexBufferBinding bindings[] = {{m_quad.GetRendererId(), 0, m_quadLayout},
+                                            {m_positionsId, m_positions.GetOffset(), m_positionLayout},
+                                            {m_stylesId, m_styles.GetOffset(), m_styleLayout}};
+    m_va = &m_vertexArrays.Get(bindings, 3, m_ib.GetRendererId());
+    m_instanceCount = static_cast<unsigned int>(count);
+}
+
+void BodyRenderer::SetViewport(const int width, const int height)
+{
+    // Clip space is 2 units across either way, so a pixel is 2 / size
+    const float pixelsWide = static_cast<float>(std::max(width, 1));
+    const float pixelsHigh = static_cast<float>(std::max(height, 1));
+    m_radiusScaleX = pixelsHigh / pixelsWide;
+    m_minHalfWidth = 2.0f / pixelsWide;
+    m_minHalfHeight = 2.0f / pixelsHigh;
+}
+
+void BodyRenderer::Draw(Renderer& renderer)
+{
+    PROFILE_SCOPE("BodyRendererDraw");
+
+    if (m_instanceCount == 0 || m_va == nullptr)
+    {
+        return;
+    }
+
+    // The uniforms are the shader's own, so they can be set now for the draw issued later
+    m_shader.Bind();
+    m_shader.SetUniform2f("u_RadiusScale", m_radiusScaleX, 1.0f);
+    m_shader.SetUniform2f("u_MinHalfSize", m_minHalfWidth, m_minHalfHeight);
+
+    DrawCommand command;
+    command.key = MakeDrawKey(m_shader.GetRendererId(), m_va->GetRendererId(), 0, 0);
+    command.shader = &m_shader;
+    command.vertexArray = m_va;
+    command.indexBuffer = &m_ib;
+    command.indexCount = m_ib.GetCount();
+    command.instanceCount = m_instanceCount;
+    renderer.Submit(command);
+    m_submitted = true;
+}
+
+void BodyRenderer::EndFrame()
+{
+    if (!m_submitted)
+    {
+        return;
+    }
+
+    // The regions may be written again once the GPU has passed this point
+    m_positions.Fence();
+    m_styles.Fence();
+    m_submitted = false;
+}
@@ -0,0 +1,92 @@
+#ifndef BODY_RENDERER_H
+#define BODY_RENDERER_H
+// BodyRenderer.h
+// This file contains the instanced renderer that draws every body in one draw call.
+// One quad is stored once, and each body is an instance of it: per-instance attributes
+// (divisor 1) give its position, radius and color, and the vertex shader places and
+// scales the quad while the fragment shader rounds it off into a circle. Positions come
+// from Simulation::InterpolatePositions and go in their own buffer, radii and colors
+// (by speed, static bodies grey) are packed from the BodyStore into a second one, both
+// rebuilt whenever the bodies moved. Both are StreamingVertexBuffers, so the data is
+// written straight into mapped memory without a staging copy. Uploading 16 bytes per
+// body and drawing a single instanced quad keeps the CPU and driver cost flat from
+// thousands to millions of bodies, including on software rasterizers such as Mesa's
+// llvmpipe.
+// The vertex state is recorded once per ring region in a VertexArrayCache, so a frame only
+// binds the VAO of the regions just written instead of re-pointing the attributes.
+// The draw goes through the Renderer's DrawQueue, so EndFrame fences the regions once
+// Renderer::Flush has actually issued it.
+
+// C++ Standard Library includes
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Project includes
+#include "BodyStore.h"
+#include "IndexBuffer.h"
+#include "Renderer.h"
+#include "Shader.h"
+#include "StreamingVertexBuffer.h"
+#include "VertexArray.h"
+#include "VertexArrayCache.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+class JobSystem;
+class Simulation;
+
+// Radius and color of one body, as the instance attributes read them
+struct BodyStyle
+{
+    float   radius;
+    uint8_t color[4]; // RGBA
+};
+
+class BodyRenderer
+{
+public:
+    // Needs a current OpenGL 3.3 context. The instance buffers are mapped persistently if allowPersistent
+    // and the context supports it.
+    explicit BodyRenderer(const std::string& shaderPath = "res/shaders/Instanced.shader", bool allowPersistent = true);
+
+    // Fill the instance buffers with the bodies interpolated by alpha (FixedStepClock::Alpha()).
+    // The styles are packed on jobs if there are any.
+    void Update(const BodyStore& bodies, const Simulation& simulation, float alpha, JobSystem* jobs = nullptr);
+
+    // Size of the framebuffer in pixels, for the aspect ratio and the smallest body drawn
+    void SetViewport(int width, int height);
+
+    // Submit the draw of every body from the last Update to the renderer's queue
+    void Draw(Renderer& renderer);
+
+    // Call after Renderer::Flush has issued the draw, the regions it reads may be written again after that
+    void EndFrame();
+
+    // Statistics of the last Draw
+    unsigned int GetInstanceCount() const { return m_instanceCount; }
+    uint64_t     GetWaitCount()     const { return m_positions.GetWaitCount() + m_styles.GetWaitCount(); } // Waits for the GPU
+    bool         IsPersistent()     const { return m_positions.IsPersistent(); }
+    uint64_t     GetVertexArrayBuilds() const { return m_vertexArrays.GetBuildCount(); } // VAOs recorded so far
+
+private:
+    std::shared_ptr<const VertexBufferLayout> m_quadLayout;     // Corner per vertex
+    std::shared_ptr<const VertexBufferLayout> m_positionLayout; // Position per instance
+    std::shared_ptr<const VertexBufferLayout> m_styleLayout;    // Radius and color per instance
+    VertexArrayCache        m_vertexArrays;
+    const VertexArray*      m_va = nullptr; // Reading the regions of the last Update
+    unsigned int            m_positionsId = 0; // Buffer IDs the cached VAOs read from
+    unsigned int            m_stylesId = 0;
+    VertexBuffer            m_quad;      // Corners of the quad, per vertex
+    IndexBuffer             m_ib;
+    StreamingVertexBuffer   m_positions; // Interleaved x,y per instance
+    StreamingVertexBuffer   m_styles;    // BodyStyle per instance
+    Shader                  m_shader;
+    unsigned int            m_instanceCount = 0;
+    bool                    m_submitted = false; // Drawn since the last EndFrame
+    float                   m_radiusScaleX = 1.0f;
+    float                   m_minHalfWidth = 0.0f;
+    float                   m_minHalfHeight = 0.0f;
+};
+
+#endif // !BODY_RENDERER_H
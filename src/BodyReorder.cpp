@@ -0,0 +1,94 @@
+#include "BodyReorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// Bodies per job when measuring the disorder
+static constexpr size_t MEASURE_GRAIN = 16384;
+
+// Bodies per coarse cell the disorder is measured with. A cell's positions span a few kilobytes, which stay
+// in the L1 and L2 caches together, so bodies that merely move to a neighbouring cell aren't counted.
+static constexpr size_t BODIES_PER_CELL = 256;
+
+BodyReorder::BodyReorder(const ReorderSettings& settings)
+    : m_settings(settings)
+{
+}
+
+bool BodyReorder::Update(BodyStore& bodies, JobSystem* jobs)
+{
+    if (m_stepsUntilCheck > 0)
+    {
+        --m_stepsUntilCheck;
+        return false;
+    }
+
+    PROFILE_SCOPE("ReorderCheck");
+    m_lastDisorder = MeasureDisorder(bodies, jobs);
+    const bool reorder = m_lastDisorder > m_settings.maxDisorder;
+    if (reorder)
+    {
+        // Already past the threshold, so the check came late
+        m_checkInterval = std::max(m_checkInterval / 2, 1u);
+        Reorder(bodies, jobs);
+    }
+    else if (m_lastDisorder < 0.5f * m_settings.maxDisorder)
+    {
+        m_checkInterval = std::min(m_checkInterval * 2, m_settings.maxCheckInterval);
+    }
+    m_stepsUntilCheck = m_checkInterval - 1;
+    return reorder;
+}
+
+void BodyReorder::Reorder(BodyStore& bodies, JobSystem* jobs)
+{
+    PROFILE_SCOPE("Reorder");
+    m_order.Sort(bodies.X(), bodies.Y(), bodies.Size(), jobs);
+    bodies.Permute(m_order.GetOrder().data());
+    ++m_reorderCount;
+}
+
+float BodyReorder::MeasureDisorder(const BodyStore& bodies, JobSystem* jobs)
+{
+    const size_t count = bodies.Size();
+    if (count < 2)
+    {
+        return 0.0f;
+    }
+
+    // Enough levels that a cell holds about BODIES_PER_CELL bodies on average. Bodies within a cell are
+    // close in memory anyway, so their order doesn't count.
+    const uint32_t cells = static_cast<uint32_t>(std::min<size_t>(count / BODIES_PER_CELL, size_t{1} << (2 * MORTON_BITS - 2)));
+    const uint32_t levels = std::clamp((static_cast<uint32_t>(std::bit_width(cells)) + 1) / 2, 1u, MORTON_BITS);
+    const uint32_t shift = 2 * (MORTON_BITS - levels);
+
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    std::atomic<size_t> backwards{0};
+    const auto measure = [&](const size_t begin, const size_t end)
+    {
+        size_t localBackwards = 0;
+        uint32_t previous = MortonCode(x[begin], y[begin]) >> shift;
+        for (size_t i = begin + 1; i < std::min(end + 1, count); ++i)
+        {
+            const uint32_t cell = MortonCode(x[i], y[i]) >> shift;
+            localBackwards += (cell < previous) ? 1 : 0;
+            previous = cell;
+        }
+        backwards.fetch_add(localBackwards, std::memory_order_relaxed);
+    };
+
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(count, MEASURE_GRAIN, measure);
+    }
+    else
+    {
+        measure(0, count);
+    }
+    return static_cast<float>(backwards.load(std::memory_order_relaxed)) / static_cast<float>(count - 1);
+}
@@ -0,0 +1,66 @@
+#ifndef BODY_REORDER_H
+#define BODY_REORDER_H
+// BodyReorder.h
+// This file contains the periodic reordering of the BodyStore along the Z-order curve.
+// Bodies that are close in space are used together (the broadphase tests neighbours,
+// the contact solver and gravity work on nearby bodies), but as they move they drift
+// apart in memory and every such pass takes more cache misses. Sorting the store by
+// Morton code puts neighbours back next to each other.
+// Sorting every step would waste time while the order is still good, so the order is
+// checked now and then instead: the disorder is the fraction of consecutive bodies
+// whose coarse Morton cell (sized to hold a few hundred bodies) goes backwards
+// along the curve, 0 right after a sort and about 0.5 for a random order. The store is
+// sorted when the disorder passes a threshold. The time between checks adapts: it halves
+// when a check finds the order already too degraded, and doubles when it is still far
+// from it. BodyStore::Permute keeps every handle valid through the slot indirection.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BodyStore.h"
+#include "Morton.h"
+
+class JobSystem;
+
+struct ReorderSettings
+{
+    float    maxDisorder      = 0.1f; // Disorder at which the bodies are sorted again
+    uint32_t maxCheckInterval = 128;  // Most steps between two checks
+};
+
+class BodyReorder
+{
+public:
+    explicit BodyReorder(const ReorderSettings& settings = {});
+
+    // Call once per step. Checks the order when a check is due and sorts the bodies if it has degraded.
+    // Returns true if the bodies were moved, GetOrder() then holds the permutation given to BodyStore::Permute.
+    bool Update(BodyStore& bodies, JobSystem* jobs = nullptr);
+
+    // Sort the bodies by Morton code now
+    void Reorder(BodyStore& bodies, JobSystem* jobs = nullptr);
+
+    // Fraction of consecutive bodies that go backwards along the Z-order curve
+    static float MeasureDisorder(const BodyStore& bodies, JobSystem* jobs = nullptr);
+
+    const std::vector<uint32_t>& GetOrder() const { return m_order.GetOrder(); }
+
+    const ReorderSettings& GetSettings() const { return m_settings; }
+    void SetSettings(const ReorderSettings& settings) { m_settings = settings; }
+
+    // Statistics
+    uint64_t GetReorderCount()   const { return m_reorderCount; }
+    float    GetLastDisorder()   const { return m_lastDisorder; }  // At the last check
+    uint32_t GetCheckInterval()  const { return m_checkInterval; } // Steps between checks
+
+private:
+    ReorderSettings m_settings;
+    MortonOrder     m_order;
+    uint32_t        m_checkInterval = 1;
+    uint32_t        m_stepsUntilCheck = 0;
+    uint64_t        m_reorderCount = 0;
+    float           m_lastDisorder = 0.0f;
+};
+
+#endif // !BODY_REORDER_H
@@ -0,0 +1,172 @@
+#include "BodyStore.h"
+
+BodyStore::BodyStore(const size_t initialCapacity)
+{
+    Grow(initialCapacity > 0 ? initialCapacity : 1);
+}
+
+void BodyStore::Grow(const size_t capacity)
+{
+    m_x.reserve(capacity, m_size);
+    m_y.reserve(capacity, m_size);
+    m_vx.reserve(capacity, m_size);
+    m_vy.reserve(capacity, m_size);
+    m_mass.reserve(capacity, m_size);
+    m_radius.reserve(capacity, m_size);
+    m_flags.reserve(capacity, m_size);
+    m_denseToSlot.reserve(capacity);
+}
+
+void BodyStore::Reserve(const size_t capacity)
+{
+    if (capacity > Capacity())
+    {
+        Grow(capacity);
+    }
+}
+
+BodyHandle BodyStore::Add(const float x, const float y, const float vx, const float vy, const float mass, const uint32_t flags,
+                          const float radius)
+{
+    if (m_size == Capacity())
+    {
+        Grow(Capacity() * 2);
+    }
+
+    // Reuse a free slot if there is one, its generation was already bumped on removal
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(m_slotToDense.size());
+        m_slotToDense.push_back(0);
+        m_slotGenerations.push_back(0);
+    }
+
+    const size_t index = m_size++;
+    m_x[index]      = x;
+    m_y[index]      = y;
+    m_vx[index]     = vx;
+    m_vy[index]     = vy;
+    m_mass[index]   = mass;
+    m_radius[index] = radius;
+    m_flags[index]  = flags;
+    m_denseToSlot.push_back(slot);
+    m_slotToDense[slot] = static_cast<uint32_t>(index);
+
+    return BodyHandle{slot, m_slotGenerations[slot]};
+}
+
+bool BodyStore::Remove(const BodyHandle handle)
+{
+    const size_t index = IndexOf(handle);
+    if (index == INVALID_INDEX)
+    {
+        return false;
+    }
+
+    // Move the last body into the hole so the arrays stay dense
+    const size_t last = m_size - 1;
+    if (index != last)
+    {
+        m_x[index]      = m_x[last];
+        m_y[index]      = m_y[last];
+        m_vx[index]     = m_vx[last];
+        m_vy[index]     = m_vy[last];
+        m_mass[index]   = m_mass[last];
+        m_radius[index] = m_radius[last];
+        m_flags[index]  = m_flags[last];
+
+        const uint32_t movedSlot = m_denseToSlot[last];
+        m_denseToSlot[index] = movedSlot;
+        m_slotToDense[movedSlot] = static_cast<uint32_t>(index);
+    }
+    m_denseToSlot.pop_back();
+    --m_size;
+
+    // Invalidate every outstanding handle to the removed body
+    ++m_slotGenerations[handle.slot];
+    m_freeSlots.push_back(handle.slot);
+    return true;
+}
+
+void BodyStore::Clear()
+{
+    for (size_t index = 0; index < m_size; ++index)
+    {
+        const uint32_t slot = m_denseToSlot[index];
+        ++m_slotGenerations[slot];
+        m_freeSlots.push_back(slot);
+    }
+    m_denseToSlot.clear();
+    m_size = 0;
+}
+
+bool BodyStore::IsValid(const BodyHandle handle) const
+{
+    // Removing a body bumps its slot's generation, so only handles to live bodies match
+    return handle.slot < m_slotGenerations.size() && m_slotGenerations[handle.slot] == handle.generation;
+}
+
+size_t BodyStore::IndexOf(const BodyHandle handle) const
+{
+    return IsValid(handle) ? m_slotToDense[handle.slot] : INVALID_INDEX;
+}
+
+BodyHandle BodyStore::HandleAt(const size_t index) const
+{
+    if (index >= m_size)
+    {
+        return BodyHandle{};
+    }
+    const uint32_t slot = m_denseToSlot[index];
+    return BodyHandle{slot, m_slotGenerations[slot]};
+}
+
+void BodyStore::Permute(const uint32_t* order)
+{
+    const auto gather = [&](AlignedArray<float>& values)
+    {
+        m_scratch.reserve(Capacity(), 0);
+        for (size_t index = 0; index < m_size; ++index)
+        {
+            m_scratch[index] = values[order[index]];
+        }
+        values.swap(m_scratch);
+    };
+    gather(m_x);
+    gather(m_y);
+    gather(m_vx);
+    gather(m_vy);
+    gather(m_mass);
+    gather(m_radius);
+
+    m_scratchFlags.reserve(Capacity(), 0);
+    for (size_t index = 0; index < m_size; ++index)
+    {
+        m_scratchFlags[index] = m_flags[order[index]];
+    }
+    m_flags.swap(m_scratchFlags);
+
+    // Handles go through the slots, which only need to learn the new indices
+    m_scratchSlots.resize(m_size);
+    for (size_t index = 0; index < m_size; ++index)
+    {
+        m_scratchSlots[index] = m_denseToSlot[order[index]];
+        m_slotToDense[m_scratchSlots[index]] = static_cast<uint32_t>(index);
+    }
+    m_denseToSlot.swap(m_scratchSlots);
+}
+
+void BodyStore::CopyPositionsInterleaved(float* out) const
+{
+    for (size_t index = 0; index < m_size; ++index)
+    {
+        out[2 * index]     = m_x[index];
+        out[2 * index + 1] = m_y[index];
+    }
+}
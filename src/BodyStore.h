@@ -0,0 +1,202 @@
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+// BodyStore.h
+// This file contains the definition of the BodyStore class.
+// The BodyStore owns every simulated body as a structure of arrays: positions,
+// velocities, masses, radii and flags each live in their own 64-byte aligned array, so a
+// loop that only touches positions streams through contiguous memory and can be
+// vectorized. The arrays are dense: removing a body moves the last body into its
+// place. Bodies are referred to from outside with BodyHandles, which stay valid
+// while bodies around them are added, removed or moved, and are detected as stale
+// once their body has been removed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Alignment of every array in the store, one cache line (and one AVX-512 register)
+inline constexpr size_t BODY_STORE_ALIGNMENT = 64;
+
+// Radius of bodies that are added without one
+inline constexpr float BODY_DEFAULT_RADIUS = 0.01f;
+
+// Bit flags stored per body
+enum BodyFlags : uint32_t
+{
+    BODY_FLAG_NONE   = 0,
+    BODY_FLAG_STATIC = 1u << 0, // Never moved by the integrator
+};
+
+// Stable reference to a body. The slot is reused after the body is removed, the generation tells the uses apart.
+struct BodyHandle
+{
+    static constexpr uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+    uint32_t slot       = INVALID_SLOT;
+    uint32_t generation = 0;
+
+    bool operator==(const BodyHandle&) const = default;
+};
+
+//===============================================================
+// AlignedArray<T>
+// Heap array of trivially copyable elements aligned to
+// BODY_STORE_ALIGNMENT. The capacity is always a whole number of
+// 64-byte blocks, so SIMD loops may read and write the padding
+// past the last element instead of handling a scalar tail.
+//===============================================================
+template <typename T>
+class AlignedArray
+{
+    static_assert(std::is_trivially_copyable_v<T>, "AlignedArray only holds trivially copyable types");
+
+    public:
+        static constexpr size_t ELEMENTS_PER_BLOCK = BODY_STORE_ALIGNMENT / sizeof(T);
+
+        AlignedArray() = default;
+
+        ~AlignedArray()
+        {
+            Free();
+        }
+
+        AlignedArray(const AlignedArray&) = delete;
+        AlignedArray& operator=(const AlignedArray&) = delete;
+
+        T*       data()       { return m_Data; }
+        const T* data() const { return m_Data; }
+
+        T&       operator[](const size_t idx)       { return m_Data[idx]; }
+        const T& operator[](const size_t idx) const { return m_Data[idx]; }
+
+        size_t capacity() const { return m_Capacity; }
+
+        void swap(AlignedArray& other) noexcept
+        {
+            std::swap(m_Data, other.m_Data);
+            std::swap(m_Capacity, other.m_Capacity);
+        }
+
+        // Grow to at least newCapacity elements, keeping the first count elements. New elements are zeroed.
+        void reserve(size_t newCapacity, const size_t count)
+        {
+            if (newCapacity <= m_Capacity)
+            {
+                return;
+            }
+
+            newCapacity = (newCapacity + ELEMENTS_PER_BLOCK - 1) / ELEMENTS_PER_BLOCK * ELEMENTS_PER_BLOCK;
+            T* newData = static_cast<T*>(::operator new(newCapacity * sizeof(T), std::align_val_t{BODY_STORE_ALIGNMENT}));
+            std::memset(newData, 0, newCapacity * sizeof(T));
+            if (m_Data != nullptr)
+            {
+                std::memcpy(newData, m_Data, count * sizeof(T));
+            }
+
+            Free();
+            m_Data = newData;
+            m_Capacity = newCapacity;
+        }
+
+    private:
+        T*     m_Data = nullptr;
+        size_t m_Capacity = 0;
+
+        void Free()
+        {
+            if (m_Data != nullptr)
+            {
+                ::operator delete(m_Data, std::align_val_t{BODY_STORE_ALIGNMENT});
+                m_Data = nullptr;
+            }
+        }
+};
+
+class BodyStore
+{
+public:
+    static constexpr size_t INVALID_INDEX = std::numeric_limits<size_t>::max();
+
+    explicit BodyStore(size_t initialCapacity = 1024);
+
+    // Add a body and return its handle
+    BodyHandle Add(float x, float y, float vx = 0.0f, float vy = 0.0f, float mass = 1.0f, uint32_t flags = BODY_FLAG_NONE,
+                   float radius = BODY_DEFAULT_RADIUS);
+
+    // Remove a body by moving the last body into its place. Returns false if the handle is stale.
+    bool Remove(BodyHandle handle);
+
+    // Remove every body. Every handle handed out so far becomes stale.
+    void Clear();
+
+    // Make room for capacity bodies without reallocating
+    void Reserve(size_t capacity);
+
+    // True if the handle refers to a body that hasn't been removed
+    bool IsValid(BodyHandle handle) const;
+
+    // Current position of the body in the arrays, or INVALID_INDEX if the handle is stale.
+    // Only valid until the next Remove.
+    size_t IndexOf(BodyHandle handle) const;
+
+    // Handle of the body at an array index
+    BodyHandle HandleAt(size_t index) const;
+
+    // Move the body at array index order[i] to index i, for every i. order must hold every index below Size()
+    // exactly once. Handles stay valid, array indices kept from before don't.
+    void Permute(const uint32_t* order);
+
+    // Write the positions as interleaved x,y pairs (2 * Size() floats), the layout the vertex buffer expects
+    void CopyPositionsInterleaved(float* out) const;
+
+    size_t Size()     const { return m_size; }
+    size_t Capacity() const { return m_x.capacity(); }
+    bool   Empty()    const { return m_size == 0; }
+
+    // Arrays of Size() elements, each padded to a whole number of 64-byte blocks
+    float*          X()      { return m_x.data(); }
+    float*          Y()      { return m_y.data(); }
+    float*          VX()     { return m_vx.data(); }
+    float*          VY()     { return m_vy.data(); }
+    float*          Mass()   { return m_mass.data(); }
+    float*          Radius() { return m_radius.data(); }
+    uint32_t*       Flags()  { return m_flags.data(); }
+    const float*    X()      const { return m_x.data(); }
+    const float*    Y()      const { return m_y.data(); }
+    const float*    VX()     const { return m_vx.data(); }
+    const float*    VY()     const { return m_vy.data(); }
+    const float*    Mass()   const { return m_mass.data(); }
+    const float*    Radius() const { return m_radius.data(); }
+    const uint32_t* Flags()  const { return m_flags.data(); }
+
+private:
+    size_t                  m_size = 0;
+    AlignedArray<float>     m_x;
+    AlignedArray<float>     m_y;
+    AlignedArray<float>     m_vx;
+    AlignedArray<float>     m_vy;
+    AlignedArray<float>     m_mass;
+    AlignedArray<float>     m_radius;
+    AlignedArray<uint32_t>  m_flags;
+
+    // Handle bookkeeping
+    std::vector<uint32_t>   m_denseToSlot;      // Slot of the body at each array index
+    std::vector<uint32_t>   m_slotToDense;      // Array index of the body in each slot
+    std::vector<uint32_t>   m_slotGenerations;  // Bumped whenever a slot's body is removed
+    std::vector<uint32_t>   m_freeSlots;        // Slots available for reuse
+
+    // Permute gathers every array into these and swaps them in
+    AlignedArray<float>     m_scratch;
+    AlignedArray<uint32_t>  m_scratchFlags;
+    std::vector<uint32_t>   m_scratchSlots;
+
+    // Grow every array to hold at least capacity bodies
+    void Grow(size_t capacity);
+};
+
+#endif // !BODY_STORE_H
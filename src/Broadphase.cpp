@@ -0,0 +1,322 @@
+#include "Broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Integrator.h"
+#include "Profiler.h"
+
+//===============================================================
+// UniformGridBroadphase
+//===============================================================
+UniformGridBroadphase::UniformGridBroadphase(const float minCellSize)
+    : m_minCellSize(minCellSize)
+{
+}
+
+void UniformGridBroadphase::Update(const BodyStore& bodies)
+{
+    PROFILE_SCOPE("Broadphase");
+
+    const size_t count = bodies.Size();
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    const float* const radius = bodies.Radius();
+    m_pairs.clear();
+
+    // Cells must be at least as wide as the largest body so overlaps never skip a cell.
+    // More cells than bodies only costs time, and fewer than 3 per side would make a cell its own neighbour.
+    float maxRadius = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        maxRadius = std::max(maxRadius, radius[i]);
+    }
+    const float cellSize = std::max(m_minCellSize, 2.0f * maxRadius);
+    const double fitCells = cellSize > 0.0f ? std::floor(WORLD_SIZE / cellSize) : MAX_CELLS_PER_SIDE;
+    const double bodyCells = std::ceil(std::sqrt(static_cast<double>(count)));
+    m_cellsPerSide = static_cast<uint32_t>(std::clamp(std::min(fitCells, bodyCells), 1.0, static_cast<double>(MAX_CELLS_PER_SIDE)));
+    if (m_cellsPerSide < 3)
+    {
+        m_cellsPerSide = 1;
+    }
+
+    const uint32_t numCells = m_cellsPerSide * m_cellsPerSide;
+    const float cellsPerUnit = m_cellsPerSide / WORLD_SIZE;
+    const float lastCell = static_cast<float>(m_cellsPerSide - 1);
+
+    // Count the bodies in every cell
+    m_cellStart.assign(numCells + 1, 0);
+    m_bodyCell.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Bodies slightly outside the world (not wrapped yet) go to the edge cells
+        const uint32_t cx = static_cast<uint32_t>(std::clamp((x[i] - WORLD_MIN) * cellsPerUnit, 0.0f, lastCell));
+        const uint32_t cy = static_cast<uint32_t>(std::clamp((y[i] - WORLD_MIN) * cellsPerUnit, 0.0f, lastCell));
+        const uint32_t cell = cy * m_cellsPerSide + cx;
+        m_bodyCell[i] = cell;
+        ++m_cellStart[cell];
+    }
+
+    // Turn the counts into the end of every cell, then place the bodies back to front,
+    // which leaves m_cellStart at the start of every cell and keeps bodies in array order
+    for (uint32_t cell = 1; cell < numCells; ++cell)
+    {
+        m_cellStart[cell] += m_cellStart[cell - 1];
+    }
+    m_cellStart[numCells] = static_cast<uint32_t>(count);
+
+    m_sortedBodies.resize(count);
+    m_sortedX.resize(count);
+    m_sortedY.resize(count);
+    m_sortedRadius.resize(count);
+    for (size_t i = count; i-- > 0;)
+    {
+        const uint32_t slot = --m_cellStart[m_bodyCell[i]];
+        m_sortedBodies[slot] = static_cast<uint32_t>(i);
+        m_sortedX[slot]      = x[i];
+        m_sortedY[slot]      = y[i];
+        m_sortedRadius[slot] = radius[i];
+    }
+
+    // Test every cell against itself and half of its neighbours (east, north-east, north and
+    // north-west), so every pair of neighbouring cells is tested exactly once
+    for (uint32_t cy = 0; cy < m_cellsPerSide; ++cy)
+    {
+        const uint32_t north = (cy + 1 == m_cellsPerSide) ? 0 : cy + 1;
+        for (uint32_t cx = 0; cx < m_cellsPerSide; ++cx)
+        {
+            const uint32_t cell = cy * m_cellsPerSide + cx;
+            if (m_cellStart[cell] == m_cellStart[cell + 1])
+            {
+                continue;
+            }
+
+            TestCells(cell, cell);
+            if (m_cellsPerSide >= 3)
+            {
+                const uint32_t east = (cx + 1 == m_cellsPerSide) ? 0 : cx + 1;
+                const uint32_t west = (cx == 0) ? m_cellsPerSide - 1 : cx - 1;
+                TestCells(cell, cy * m_cellsPerSide + east);
+                TestCells(cell, north * m_cellsPerSide + east);
+                TestCells(cell, north * m_cellsPerSide + cx);
+                TestCells(cell, north * m_cellsPerSide + west);
+            }
+        }
+    }
+}
+
+void UniformGridBroadphase::TestCells(const uint32_t cell, const uint32_t otherCell)
+{
+    const uint32_t end = m_cellStart[cell + 1];
+    const uint32_t otherEnd = m_cellStart[otherCell + 1];
+
+    for (uint32_t i = m_cellStart[cell]; i < end; ++i)
+    {
+        const float xi = m_sortedX[i];
+        const float yi = m_sortedY[i];
+        const float ri = m_sortedRadius[i];
+
+        for (uint32_t j = (cell == otherCell) ? i + 1 : m_cellStart[otherCell]; j < otherEnd; ++j)
+        {
+            const float reach = ri + m_sortedRadius[j];
+            if (std::abs(WrappedDelta(xi, m_sortedX[j])) < reach && std::abs(WrappedDelta(yi, m_sortedY[j])) < reach)
+            {
+                const uint32_t a = m_sortedBodies[i];
+                const uint32_t b = m_sortedBodies[j];
+                m_pairs.push_back(a < b ? BodyPair{a, b} : BodyPair{b, a});
+            }
+        }
+    }
+}
+
+//===============================================================
+// AabbTreeBroadphase
+//===============================================================
+AabbTreeBroadphase::AabbTreeBroadphase(const float margin, const float predictUpdates)
+    : m_margin(margin), m_predictUpdates(predictUpdates)
+{
+}
+
+template <typename Callback>
+void AabbTreeBroadphase::QueryWrapped(const AABB& box, const bool includeBox, Callback&& callback) const
+{
+    // Also look at the box's images on the far side of every edge that a fat box could reach across
+    float shiftsX[2] = {0.0f, 0.0f};
+    float shiftsY[2] = {0.0f, 0.0f};
+    const int numShiftsX = 1 + (box.maxX > WORLD_MAX - m_maxExtent || box.minX < WORLD_MIN + m_maxExtent);
+    const int numShiftsY = 1 + (box.maxY > WORLD_MAX - m_maxExtent || box.minY < WORLD_MIN + m_maxExtent);
+    shiftsX[1] = (box.maxX > WORLD_MAX - m_maxExtent) ? -WORLD_SIZE : WORLD_SIZE;
+    shiftsY[1] = (box.maxY > WORLD_MAX - m_maxExtent) ? -WORLD_SIZE : WORLD_SIZE;
+
+    for (int sy = 0; sy < numShiftsY; ++sy)
+    {
+        for (int sx = 0; sx < numShiftsX; ++sx)
+        {
+            if (sx == 0 && sy == 0 && !includeBox)
+            {
+                continue;
+            }
+
+            const AABB image{box.minX + shiftsX[sx], box.minY + shiftsY[sy], box.maxX + shiftsX[sx], box.maxY + shiftsY[sy]};
+            m_tree.Query(image, [&](const int32_t proxy)
+            {
+                callback(m_tree.GetUserData(proxy));
+                return true;
+            });
+        }
+    }
+}
+
+void AabbTreeBroadphase::Update(const BodyStore& bodies)
+{
+    PROFILE_SCOPE("Broadphase");
+
+    const size_t count = bodies.Size();
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    const float* const radius = bodies.Radius();
+    m_pairs.clear();
+    m_movedCount = 0;
+    ++m_updateStamp;
+
+    m_x.assign(x, x + count);
+    m_y.assign(y, y + count);
+    m_radius.assign(radius, radius + count);
+
+    // Bring every body's leaf up to date. Leaves are tracked by the body's slot, which unlike its array index
+    // doesn't change when other bodies are removed.
+    float maxRadius = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const BodyHandle handle = bodies.HandleAt(i);
+        if (handle.slot >= m_slotProxies.size())
+        {
+            m_slotProxies.resize(handle.slot + 1);
+        }
+
+        SlotProxy& slotProxy = m_slotProxies[handle.slot];
+        if (slotProxy.proxy != DynamicAabbTree::NULL_NODE && slotProxy.generation != handle.generation)
+        {
+            // The slot was reused by a new body since the last update
+            m_tree.DestroyProxy(slotProxy.proxy);
+            slotProxy.proxy = DynamicAabbTree::NULL_NODE;
+        }
+
+        const AABB box{x[i] - radius[i], y[i] - radius[i], x[i] + radius[i], y[i] + radius[i]};
+        if (slotProxy.proxy == DynamicAabbTree::NULL_NODE)
+        {
+            slotProxy.proxy = m_tree.CreateProxy(box, m_margin, static_cast<uint32_t>(i));
+            slotProxy.generation = handle.generation;
+        }
+        else
+        {
+            const float displacementX = m_predictUpdates * WrappedDelta(slotProxy.lastX, x[i]);
+            const float displacementY = m_predictUpdates * WrappedDelta(slotProxy.lastY, y[i]);
+            m_tree.SetUserData(slotProxy.proxy, static_cast<uint32_t>(i));
+            if (m_tree.MoveProxy(slotProxy.proxy, box, m_margin, displacementX, displacementY))
+            {
+                ++m_movedCount;
+            }
+        }
+        slotProxy.updateStamp = m_updateStamp;
+        slotProxy.lastX = x[i];
+        slotProxy.lastY = y[i];
+        maxRadius = std::max(maxRadius, radius[i]);
+    }
+    m_maxExtent = maxRadius + m_margin;
+
+    // Drop the leaves of bodies that were removed
+    for (SlotProxy& slotProxy : m_slotProxies)
+    {
+        if (slotProxy.proxy != DynamicAabbTree::NULL_NODE && slotProxy.updateStamp != m_updateStamp)
+        {
+            m_tree.DestroyProxy(slotProxy.proxy);
+            slotProxy.proxy = DynamicAabbTree::NULL_NODE;
+        }
+    }
+
+    // Pairs inside the world come from walking the tree against itself
+    const auto testPair = [&](const uint32_t a, const uint32_t b)
+    {
+        const float reach = m_radius[a] + m_radius[b];
+        if (std::abs(WrappedDelta(m_x[a], m_x[b])) < reach && std::abs(WrappedDelta(m_y[a], m_y[b])) < reach)
+        {
+            m_pairs.push_back(a < b ? BodyPair{a, b} : BodyPair{b, a});
+        }
+    };
+    m_tree.QueryOverlappingPairs([&](const int32_t proxyA, const int32_t proxyB)
+    {
+        testPair(m_tree.GetUserData(proxyA), m_tree.GetUserData(proxyB));
+    });
+
+    // Pairs across the world's edges come from querying the images of the bodies near an edge.
+    // Both bodies of such a pair are near an edge, keep the pair from the lower index.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float r = m_radius[i];
+        const AABB box{m_x[i] - r, m_y[i] - r, m_x[i] + r, m_y[i] + r};
+        if (box.minX >= WORLD_MIN + m_maxExtent && box.maxX <= WORLD_MAX - m_maxExtent &&
+            box.minY >= WORLD_MIN + m_maxExtent && box.maxY <= WORLD_MAX - m_maxExtent)
+        {
+            continue;
+        }
+
+        QueryWrapped(box, false, [&](const uint32_t j)
+        {
+            if (j > i)
+            {
+                testPair(static_cast<uint32_t>(i), j);
+            }
+        });
+    }
+}
+
+void AabbTreeBroadphase::QueryBox(const AABB& box, std::vector<uint32_t>& bodies) const
+{
+    QueryWrapped(box, true, [&](const uint32_t index)
+    {
+        // Compare centers, so a body on the other side of an edge is measured across it
+        const float dx = WrappedDelta(0.5f * (box.minX + box.maxX), m_x[index]);
+        const float dy = WrappedDelta(0.5f * (box.minY + box.maxY), m_y[index]);
+        if (std::abs(dx) <= 0.5f * (box.maxX - box.minX) + m_radius[index] &&
+            std::abs(dy) <= 0.5f * (box.maxY - box.minY) + m_radius[index])
+        {
+            bodies.push_back(index);
+        }
+    });
+}
+
+size_t AabbTreeBroadphase::RayCast(const float originX, const float originY, const float dirX, const float dirY, const float maxDistance, float* hitDistance) const
+{
+    size_t closest = BodyStore::INVALID_INDEX;
+    float closestDistance = maxDistance;
+    m_tree.RayCast(originX, originY, dirX, dirY, maxDistance, [&](const int32_t proxy, const float distance)
+    {
+        // Ray against the body's circle: solve |origin + t * dir - center| = radius for the first t >= 0
+        const uint32_t index = m_tree.GetUserData(proxy);
+        const float mx = originX - m_x[index];
+        const float my = originY - m_y[index];
+        const float b = mx * dirX + my * dirY;
+        const float c = mx * mx + my * my - m_radius[index] * m_radius[index];
+        const float discriminant = b * b - c;
+        if ((c > 0.0f && b > 0.0f) || discriminant < 0.0f)
+        {
+            return distance;
+        }
+
+        const float t = std::max(0.0f, -b - std::sqrt(discriminant));
+        if (t < distance)
+        {
+            closest = index;
+            closestDistance = t;
+            return t;
+        }
+        return distance;
+    });
+
+    if (hitDistance != nullptr && closest != BodyStore::INVALID_INDEX)
+    {
+        *hitDistance = closestDistance;
+    }
+    return closest;
+}
@@ -0,0 +1,131 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+// Broadphase.h
+// This file contains the collision broadphase, which finds the pairs of bodies that
+// may be touching so that only those have to be tested exactly.
+// A pair is reported when the bodies' bounding boxes (position +- radius) overlap,
+// measured across the world's wrap-around edges. The pairs are rebuilt from scratch
+// on every Update and stored in one contiguous buffer that is reused between updates.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BodyStore.h"
+#include "DynamicAabbTree.h"
+
+// Two bodies whose bounding boxes overlap, as array indices into the BodyStore with a < b
+struct BodyPair
+{
+    uint32_t a;
+    uint32_t b;
+
+    bool operator==(const BodyPair&) const = default;
+};
+
+// Interface for every broadphase
+class Broadphase
+{
+public:
+    virtual ~Broadphase() = default;
+
+    // Find every overlapping pair among the bodies' current positions.
+    // The pairs refer to array indices, so they are only valid until bodies are added or removed.
+    virtual void Update(const BodyStore& bodies) = 0;
+
+    const std::vector<BodyPair>& GetPairs() const { return m_pairs; }
+
+protected:
+    std::vector<BodyPair> m_pairs;
+};
+
+// Bins the bodies into a uniform grid of square cells with a counting sort, then tests each
+// body against the bodies in its own cell and in the neighbouring cells. Cells are at least as
+// large as the largest body, so every overlapping pair is in the same or neighbouring cells.
+// The grid wraps around like the world, cells on one edge neighbour the cells on the opposite edge.
+// Rebuilding is O(bodies + cells) and allocates nothing once the buffers have grown.
+class UniformGridBroadphase : public Broadphase
+{
+public:
+    static constexpr uint32_t MAX_CELLS_PER_SIDE = 1024;
+
+    // Cells are never smaller than minCellSize. By default they are sized to fit the largest body,
+    // with at most about one cell per body.
+    explicit UniformGridBroadphase(float minCellSize = 0.0f);
+
+    void Update(const BodyStore& bodies) override;
+
+    uint32_t GetCellsPerSide() const { return m_cellsPerSide; }
+
+private:
+    float    m_minCellSize;
+    uint32_t m_cellsPerSide = 1;
+
+    // Bodies sorted by cell. The bodies of cell c are [m_cellStart[c], m_cellStart[c + 1]).
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_bodyCell;     // Cell of every body, by array index
+    std::vector<uint32_t> m_sortedBodies; // Array index of every body, by cell
+    std::vector<float>    m_sortedX;      // Copies of the bodies' position and radius in sorted order,
+    std::vector<float>    m_sortedY;      // so testing a cell reads contiguous memory
+    std::vector<float>    m_sortedRadius;
+
+    // Test every body in cell against every body in otherCell (only the later ones if they are the same cell)
+    void TestCells(uint32_t cell, uint32_t otherCell);
+};
+
+// Keeps a fattened box for every body in a DynamicAabbTree and finds the pairs by walking the tree
+// against itself. Unlike the grid it doesn't care how much the bodies' sizes vary.
+// Between updates only the bodies that left their fat boxes are moved in the tree, bodies that
+// were added or removed get or lose their leaf. The same tree answers box and ray queries.
+class AabbTreeBroadphase : public Broadphase
+{
+public:
+    // Fat boxes are grown by margin on every side, and stretched by how far the body moved
+    // since the last update times predictUpdates in the direction it is moving
+    explicit AabbTreeBroadphase(float margin = 0.25f * BODY_DEFAULT_RADIUS, float predictUpdates = 2.0f);
+
+    void Update(const BodyStore& bodies) override;
+
+    // Append the array index of every body whose box overlaps the box, across the world's edges
+    void QueryBox(const AABB& box, std::vector<uint32_t>& bodies) const;
+
+    // Array index of the first body the ray from (originX, originY) along the unit direction
+    // (dirX, dirY) hits within maxDistance, or BodyStore::INVALID_INDEX. Rays don't wrap around.
+    size_t RayCast(float originX, float originY, float dirX, float dirY, float maxDistance, float* hitDistance = nullptr) const;
+
+    const DynamicAabbTree& GetTree() const { return m_tree; }
+
+    // Leaves reinserted by the last Update
+    size_t GetMovedCount() const { return m_movedCount; }
+
+private:
+    // Tree leaf of every BodyStore slot
+    struct SlotProxy
+    {
+        int32_t  proxy = DynamicAabbTree::NULL_NODE;
+        uint32_t generation = 0;
+        uint32_t updateStamp = 0; // Last Update that found the body, leaves of bodies that are gone are destroyed
+        float    lastX = 0.0f;    // Position at the last Update
+        float    lastY = 0.0f;
+    };
+
+    DynamicAabbTree        m_tree;
+    float                  m_margin;
+    float                  m_predictUpdates;
+    std::vector<SlotProxy> m_slotProxies;
+    uint32_t               m_updateStamp = 0;
+    size_t                 m_movedCount = 0;
+    float                  m_maxExtent = 0.0f; // Largest radius plus the margin, how far a fat box can stick out of the world
+
+    // Copies of the bodies from the last Update, for the queries
+    std::vector<float>     m_x;
+    std::vector<float>     m_y;
+    std::vector<float>     m_radius;
+
+    // Call callback(index) for every body whose fat box overlaps one of box's images across the world's edges,
+    // and box itself if includeBox is set
+    template <typename Callback>
+    void QueryWrapped(const AABB& box, bool includeBox, Callback&& callback) const;
+};
+
+#endif // !BROADPHASE_H
@@ -3,8 +3,37 @@
 
 #include <vector>
 #include <format>
+#include <algorithm>
+#include <string_view>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
 
 #include "LoggerHelper.h"
+#include "ThreadUtils.h"
+
+// What a bounded buffer does with a new element when it is full
+enum class OverflowPolicy
+{
+    BLOCK,            // Wait for space (the buffer refuses the element and the caller waits and retries)
+    DROP_NEWEST,      // Discard the new element
+    OVERWRITE_OLDEST, // Discard the oldest element to make room
+    GROW              // Grow the buffer until it reaches its maximum capacity, then discard the new element
+};
+
+// Convert OverflowPolicy to string
+constexpr inline std::string_view OverflowPolicyToString(const OverflowPolicy policy)
+{
+    switch (policy)
+    {
+        case OverflowPolicy::BLOCK:            return "BLOCK";
+        case OverflowPolicy::DROP_NEWEST:      return "DROP_NEWEST";
+        case OverflowPolicy::OVERWRITE_OLDEST: return "OVERWRITE_OLDEST";
+        case OverflowPolicy::GROW:             return "GROW";
+        default:                               return "UNKNOWN";
+    }
+}
 
 template <typename T>
 class CircularBuffer
@@ -14,6 +43,10 @@ class CircularBuffer
         size_t m_ReadIdx; // Points to the oldest element
         size_t m_WriteIdx; // Points to the next insertion point
         bool m_Full;
+        OverflowPolicy m_Policy;
+        size_t m_MaxCapacity; // Largest size the buffer may grow to with OverflowPolicy::GROW
+        size_t m_Dropped = 0; // Elements refused or discarded because the buffer was full
+        size_t m_Overwritten = 0; // Oldest elements discarded to make room
 
         inline void IncrementReadIdx()
         {
@@ -39,20 +72,23 @@ class CircularBuffer
             }
         }
 
-        inline void ExtendBuffer()
+        // Double the buffer size, up to m_MaxCapacity. Returns false if it is already at its maximum.
+        inline bool ExtendBuffer()
         {
             const size_t oldCapacity = m_Buffer.capacity();
+            if (oldCapacity >= m_MaxCapacity)
+            {
+                return false;
+            }
 
             size_t newCapacity = oldCapacity * 2;
             if (newCapacity == 0)
             {
                 newCapacity = 1; // Start with a capacity of 1 if the buffer was empty
             }
-            else if (newCapacity > m_Buffer.max_size())
+            else if (newCapacity > m_MaxCapacity)
             {
-                PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__, 
-                    std::format("Cannot resize circular buffer beyond its max size of {} elements", m_Buffer.max_size()));
-                return;
+                newCapacity = m_MaxCapacity;
             }
             
             // Make a new buffer with double the size
@@ -71,10 +107,15 @@ class CircularBuffer
             m_ReadIdx = 0;
             m_WriteIdx = currentSize;
             m_Full = false;
+            return true;
         }
 
     public:
-        CircularBuffer(size_t size = 4096) // Default size is 4096
+        // Default size is 4096. With OverflowPolicy::GROW the buffer may grow up to maxCapacity elements.
+        CircularBuffer(size_t size = 4096, 
+                       const OverflowPolicy policy = OverflowPolicy::GROW, 
+                       const size_t maxCapacity = 1024 * 1024)
+            : m_Policy(policy)
         {
             if (size > m_Buffer.max_size())
             {
@@ -91,6 +132,7 @@ class CircularBuffer
             m_ReadIdx = 0;
             m_WriteIdx = 0;
             m_Full = false;
+            m_MaxCapacity = std::min(std::max(maxCapacity, m_Buffer.capacity()), m_Buffer.max_size());
         }
 
         ~CircularBuffer()
@@ -104,17 +146,15 @@ class CircularBuffer
 
         size_t size() const
         {
-            int size = m_WriteIdx - m_ReadIdx;
-            if (size < 0)
+            if (m_Full)
             {
-                size += m_Buffer.capacity();
+                return m_Buffer.capacity();
             }
-            else if (m_Full && size == 0)
+            if (m_WriteIdx >= m_ReadIdx)
             {
-                size = static_cast<int>(m_Buffer.capacity());
+                return m_WriteIdx - m_ReadIdx;
             }
-
-            return static_cast<size_t>(size);
+            return m_Buffer.capacity() - m_ReadIdx + m_WriteIdx;
         }
 
         T front()
@@ -134,26 +174,34 @@ class CircularBuffer
             m_Full = false;
         }
 
+        // Add an element. Returns false if the element was not added because the buffer is full
+        // and the policy is BLOCK, DROP_NEWEST or GROW at its maximum capacity.
+        // Nothing is printed here, overflows are only counted (see dropped() and overwritten()).
         template <typename... Args>
-        void emplace(Args&&... args)
+        bool emplace(Args&&... args)
         {
-            const bool overwriteOldest = false; // Change to true to allow overwriting the oldest data for performance
-
             if (m_Full)
             {
-                // Log immediately using the Logger class's formatting and bypass the queue
-                PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__, 
-                    std::format("Attempted to emplace into a full circular buffer. Current Buffer Size: {}", m_Buffer.capacity()));
-                
-                if (!overwriteOldest)
-                {
-                    // In the case of not overwriting, extend buffer size
-                    ExtendBuffer();
-                }
-                else
+                switch (m_Policy)
                 {
-                    // Move read index forward to overwrite the oldest data
-                    IncrementReadIdx();
+                    case OverflowPolicy::OVERWRITE_OLDEST:
+                        // Move read index forward to overwrite the oldest data
+                        IncrementReadIdx();
+                        ++m_Overwritten;
+                        break;
+
+                    case OverflowPolicy::GROW:
+                        if (ExtendBuffer())
+                        {
+                            break;
+                        }
+                        [[fallthrough]]; // At the maximum capacity, drop like DROP_NEWEST
+
+                    case OverflowPolicy::BLOCK:
+                    case OverflowPolicy::DROP_NEWEST:
+                    default:
+                        ++m_Dropped;
+                        return false;
                 }
             }
 
@@ -162,6 +210,188 @@ class CircularBuffer
             m_Buffer[m_WriteIdx] = std::move(T(std::forward<Args>(args)...));
             IncrementWriteIdx(); // Move write index forward
             m_Full = (m_ReadIdx == m_WriteIdx);
+            return true;
+        }
+
+        bool full() const { return m_Full; }
+
+        size_t capacity() const { return m_Buffer.capacity(); }
+
+        OverflowPolicy policy() const { return m_Policy; }
+
+        // Number of elements that were refused or discarded because the buffer was full
+        size_t dropped() const { return m_Dropped; }
+
+        // Number of oldest elements discarded to make room (OverflowPolicy::OVERWRITE_OLDEST)
+        size_t overwritten() const { return m_Overwritten; }
+};
+
+// How a FixedCircularBuffer may be shared between threads
+enum class BufferThreading
+{
+    SINGLE_THREADED, // Only ever used from one thread, indices are never synchronized
+    SPSC             // One producer thread and one consumer thread, wait-free on both sides
+};
+
+//===============================================================
+// FixedCircularBuffer<T, Capacity, Threading>
+// Fixed-capacity ring buffer. The capacity is a power of two known
+// at compile time, so wrapping an index is a mask instead of a
+// modulo, and the indices run freely (size is write - read).
+// Elements are constructed in place in uninitialized storage and
+// destroyed when they are popped. The read and write indices sit
+// on their own cache lines, and each side keeps a cached copy of
+// the other side's index so it only touches the shared line when
+// the buffer looks full (or empty). With BufferThreading::SPSC the
+// indices are published with acquire/release, so one thread may
+// push while another pops.
+// Producer side: emplace, push_n. Consumer side: front, pop, pop_n.
+//===============================================================
+template <typename T, size_t Capacity, BufferThreading Threading = BufferThreading::SINGLE_THREADED>
+class FixedCircularBuffer
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "FixedCircularBuffer capacity must be a power of two");
+
+    private:
+        static constexpr size_t MASK = Capacity - 1;
+
+        // Single threaded buffers only need relaxed (plain) loads and stores
+        static constexpr std::memory_order ACQUIRE = Threading == BufferThreading::SPSC ? std::memory_order_acquire : std::memory_order_relaxed;
+        static constexpr std::memory_order RELEASE = Threading == BufferThreading::SPSC ? std::memory_order_release : std::memory_order_relaxed;
+
+        struct alignas(T) Storage
+        {
+            std::byte bytes[sizeof(T)];
+        };
+
+        // Producer's cache line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_WriteIdx{0};
+        size_t                                       m_CachedReadIdx = 0;
+
+        // Consumer's cache line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_ReadIdx{0};
+        size_t                                       m_CachedWriteIdx = 0;
+
+        alignas(CACHE_LINE_SIZE) Storage m_Slots[Capacity];
+
+        T* Slot(const size_t idx) { return std::launder(reinterpret_cast<T*>(&m_Slots[idx & MASK])); }
+
+        // Producer side: number of free slots, refreshing the cached read index only when needed
+        size_t FreeSlots(const size_t writeIdx, const size_t wanted)
+        {
+            size_t freeSlots = Capacity - (writeIdx - m_CachedReadIdx);
+            if (freeSlots < wanted)
+            {
+                m_CachedReadIdx = m_ReadIdx.load(ACQUIRE);
+                freeSlots = Capacity - (writeIdx - m_CachedReadIdx);
+            }
+            return freeSlots;
+        }
+
+        // Consumer side: number of queued elements, refreshing the cached write index only when needed
+        size_t QueuedSlots(const size_t readIdx, const size_t wanted)
+        {
+            size_t queued = m_CachedWriteIdx - readIdx;
+            if (queued < wanted)
+            {
+                m_CachedWriteIdx = m_WriteIdx.load(ACQUIRE);
+                queued = m_CachedWriteIdx - readIdx;
+            }
+            return queued;
+        }
+
+    public:
+        FixedCircularBuffer() = default;
+
+        ~FixedCircularBuffer()
+        {
+            // Destroy anything that was never consumed
+            const size_t writeIdx = m_WriteIdx.load(std::memory_order_acquire);
+            for (size_t idx = m_ReadIdx.load(std::memory_order_relaxed); idx != writeIdx; ++idx)
+            {
+                Slot(idx)->~T();
+            }
+        }
+
+        FixedCircularBuffer(const FixedCircularBuffer&) = delete;
+        FixedCircularBuffer& operator=(const FixedCircularBuffer&) = delete;
+
+        static constexpr size_t capacity() { return Capacity; }
+
+        // Number of queued elements, approximate while the other side is active
+        size_t size() const
+        {
+            return m_WriteIdx.load(ACQUIRE) - m_ReadIdx.load(ACQUIRE);
+        }
+
+        bool empty() const { return size() == 0; }
+
+        bool full() const { return size() == Capacity; }
+
+        // Producer side: construct an element in place. Returns false (and leaves args untouched) if the buffer is full.
+        template <typename... Args>
+        bool emplace(Args&&... args)
+        {
+            const size_t writeIdx = m_WriteIdx.load(std::memory_order_relaxed);
+            if (FreeSlots(writeIdx, 1) == 0)
+            {
+                return false;
+            }
+
+            new (Slot(writeIdx)) T(std::forward<Args>(args)...);
+            m_WriteIdx.store(writeIdx + 1, RELEASE);
+            return true;
+        }
+
+        // Producer side: copy up to count elements and publish them all at once.
+        // Returns the number of elements added.
+        size_t push_n(const T* items, const size_t count)
+        {
+            const size_t writeIdx = m_WriteIdx.load(std::memory_order_relaxed);
+            const size_t freeSlots = FreeSlots(writeIdx, count);
+            const size_t pushed = count < freeSlots ? count : freeSlots;
+            for (size_t i = 0; i < pushed; ++i)
+            {
+                new (Slot(writeIdx + i)) T(items[i]);
+            }
+            m_WriteIdx.store(writeIdx + pushed, RELEASE);
+            return pushed;
+        }
+
+        // Consumer side: oldest element, or nullptr if the buffer is empty
+        T* front()
+        {
+            const size_t readIdx = m_ReadIdx.load(std::memory_order_relaxed);
+            if (QueuedSlots(readIdx, 1) == 0)
+            {
+                return nullptr;
+            }
+            return Slot(readIdx);
+        }
+
+        // Consumer side: destroy the oldest element. Only valid after front() returned an element.
+        void pop()
+        {
+            const size_t readIdx = m_ReadIdx.load(std::memory_order_relaxed);
+            Slot(readIdx)->~T();
+            m_ReadIdx.store(readIdx + 1, RELEASE);
+        }
+
+        // Consumer side: move up to maxCount elements into out in FIFO order and free their slots at once.
+        // Returns the number of elements removed.
+        size_t pop_n(T* out, const size_t maxCount)
+        {
+            const size_t readIdx = m_ReadIdx.load(std::memory_order_relaxed);
+            const size_t queued = QueuedSlots(readIdx, maxCount);
+            const size_t popped = maxCount < queued ? maxCount : queued;
+            for (size_t i = 0; i < popped; ++i)
+            {
+                T* element = Slot(readIdx + i);
+                out[i] = std::move(*element);
+                element->~T();
+            }
+            m_ReadIdx.store(readIdx + popped, RELEASE);
+            return popped;
         }
 };
 
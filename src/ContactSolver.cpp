@@ -0,0 +1,407 @@
+#include "ContactSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#include "Integrator.h"
+#include "Profiler.h"
+
+// Blocks (or bodies, or pairs) handed to a thread at a time. Small enough to balance the
+// colors with few contacts, large enough that claiming a chunk costs nothing next to solving it.
+static constexpr size_t BLOCK_GRAIN = 16;
+static constexpr size_t ITEM_GRAIN  = 2048;
+
+// Call function(begin, end) over [0, count), on the job system if there is one
+template <typename Function>
+static void ParallelRange(JobSystem* jobs, const size_t count, const size_t grainSize, Function&& function)
+{
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(count, grainSize, function);
+    }
+    else if (count > 0)
+    {
+        function(size_t{0}, count);
+    }
+}
+
+//===============================================================
+// ImpulseCache
+//===============================================================
+void ContactSolver::ImpulseCache::Reset(const size_t count, JobSystem* jobs)
+{
+    const size_t capacity = std::bit_ceil(std::max<size_t>(2 * count, 16));
+    m_shift = 64 - static_cast<unsigned int>(std::countr_zero(capacity));
+
+    m_entries.resize(capacity);
+    ParallelRange(jobs, capacity, ITEM_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        std::fill(m_entries.begin() + begin, m_entries.begin() + end, Entry{});
+    });
+}
+
+uint32_t ContactSolver::ImpulseCache::Insert(const uint64_t key, const uint32_t generations)
+{
+    // Claim the first empty entry. Only the thread that claimed it writes the rest of the entry.
+    const size_t mask = m_entries.size() - 1;
+    for (size_t entry = Home(key);; entry = (entry + 1) & mask)
+    {
+        std::atomic_ref<uint64_t> entryKey(m_entries[entry].key);
+        uint64_t expected = EMPTY_KEY;
+        if (entryKey.load(std::memory_order_relaxed) == EMPTY_KEY && entryKey.compare_exchange_strong(expected, key, std::memory_order_relaxed))
+        {
+            m_entries[entry].generations = generations;
+            return static_cast<uint32_t>(entry);
+        }
+    }
+}
+
+float ContactSolver::ImpulseCache::Find(const uint64_t key, const uint32_t generations) const
+{
+    if (m_entries.empty())
+    {
+        return 0.0f;
+    }
+
+    const size_t mask = m_entries.size() - 1;
+    for (size_t entry = Home(key); m_entries[entry].key != EMPTY_KEY; entry = (entry + 1) & mask)
+    {
+        if (m_entries[entry].key == key)
+        {
+            return m_entries[entry].generations == generations ? m_entries[entry].impulse : 0.0f;
+        }
+    }
+    return 0.0f;
+}
+
+//===============================================================
+// ContactSolver
+//===============================================================
+ContactSolver::ContactSolver(const ContactSolverSettings& settings)
+    : m_settings(settings), m_colorBlockStart(MAX_COLORS + 1, 0), m_colorSizes(MAX_COLORS, 0)
+{
+}
+
+void ContactSolver::ClearWarmStart()
+{
+    m_previousImpulses.Reset(0, nullptr);
+}
+
+void ContactSolver::Solve(BodyStore& bodies, const std::vector<BodyPair>& pairs, const float dt, JobSystem* jobs)
+{
+    PROFILE_SCOPE("ContactSolver");
+
+    const size_t size = bodies.Size();
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    const float* const radius = bodies.Radius();
+    const float* const mass = bodies.Mass();
+    const uint32_t* const flags = bodies.Flags();
+    float* const vx = bodies.VX();
+    float* const vy = bodies.VY();
+
+    m_invMass.resize(size);
+    m_bodyColors.resize(size);
+    ParallelRange(jobs, size, ITEM_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_invMass[i] = ((flags[i] & BODY_FLAG_STATIC) != 0 || mass[i] <= 0.0f) ? 0.0f : 1.0f / mass[i];
+            m_bodyColors[i] = 0;
+        }
+    });
+
+    // Narrowphase: exact circle tests
+    m_contacts.resize(pairs.size());
+    ParallelRange(jobs, pairs.size(), ITEM_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const BodyPair pair = pairs[i];
+            Contact& contact = m_contacts[i];
+
+            const float dx = WrappedDelta(x[pair.a], x[pair.b]);
+            const float dy = WrappedDelta(y[pair.a], y[pair.b]);
+            const float distanceSquared = dx * dx + dy * dy;
+            const float radiusSum = radius[pair.a] + radius[pair.b];
+            if (distanceSquared >= radiusSum * radiusSum || m_invMass[pair.a] + m_invMass[pair.b] == 0.0f)
+            {
+                contact.penetration = -1.0f;
+                continue;
+            }
+
+            // Concentric circles have no normal, push them apart along x
+            const float distance = std::sqrt(distanceSquared);
+            contact.normalX = (distance > 0.0f) ? dx / distance : 1.0f;
+            contact.normalY = (distance > 0.0f) ? dy / distance : 0.0f;
+            contact.penetration = radiusSum - distance;
+        }
+    });
+
+    {
+        PROFILE_SCOPE("ContactColoring");
+        m_contactCount = ColorContacts(pairs);
+        LayoutBlocks();
+    }
+
+    // Fill in the lane of every contact, with the impulse the pair ended the last step with.
+    // Different contacts write different lanes and cache entries, so this runs in any order.
+    m_currentImpulses.Reset(m_contactCount, jobs);
+    const bool warmStarting = m_settings.warmStarting;
+    const float biasRate = m_settings.baumgarte / dt;
+    const float linearSlop = m_settings.linearSlop;
+    const float maxPushSpeed = m_settings.maxPushSpeed;
+    std::atomic<size_t> warmStartedCount{0};
+    ParallelRange(jobs, pairs.size(), ITEM_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        size_t warmStarted = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Contact& contact = m_contacts[i];
+            if (contact.penetration < 0.0f)
+            {
+                continue;
+            }
+
+            // The key is ordered by slot, array indices change when other bodies are removed
+            const uint32_t a = pairs[i].a;
+            const uint32_t b = pairs[i].b;
+            BodyHandle first = bodies.HandleAt(a);
+            BodyHandle second = bodies.HandleAt(b);
+            if (second.slot < first.slot)
+            {
+                std::swap(first, second);
+            }
+            const uint64_t key = (static_cast<uint64_t>(first.slot) << 32) | second.slot;
+            const uint32_t generations = first.generation * 0x9E3779B1u ^ second.generation;
+            const float cachedImpulse = warmStarting ? m_previousImpulses.Find(key, generations) : 0.0f;
+            warmStarted += (cachedImpulse > 0.0f) ? 1 : 0;
+
+            const bool overflow = contact.color == OVERFLOW_COLOR;
+            ContactBlock& block = m_blocks[m_colorBlockStart[contact.color] + (overflow ? contact.rank : contact.rank / LANES)];
+            const size_t lane = overflow ? 0 : contact.rank % LANES;
+            block.normalX[lane] = contact.normalX;
+            block.normalY[lane] = contact.normalY;
+            block.invMassA[lane] = m_invMass[a];
+            block.invMassB[lane] = m_invMass[b];
+            block.effectiveMass[lane] = 1.0f / (m_invMass[a] + m_invMass[b]);
+            block.bias[lane] = std::min(biasRate * std::max(contact.penetration - linearSlop, 0.0f), maxPushSpeed);
+            block.impulse[lane] = cachedImpulse;
+            block.bodyA[lane] = a;
+            block.bodyB[lane] = b;
+            block.cacheEntry[lane] = m_currentImpulses.Insert(key, generations);
+        }
+        warmStartedCount.fetch_add(warmStarted, std::memory_order_relaxed);
+    });
+    m_warmStartedCount = warmStartedCount.load(std::memory_order_relaxed);
+
+    {
+        PROFILE_SCOPE("ContactIterations");
+        if (warmStarting)
+        {
+            ForEachBlockByColor(jobs, [&](const ContactBlock& block) { ApplyImpulses(block, vx, vy); });
+        }
+        for (unsigned int iteration = 0; iteration < m_settings.iterations; ++iteration)
+        {
+            ForEachBlockByColor(jobs, [&](ContactBlock& block) { SolveBlock(block, vx, vy); });
+        }
+    }
+
+    // Keep the impulses for the next step
+    ParallelRange(jobs, m_blocks.size(), BLOCK_GRAIN, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const ContactBlock& block = m_blocks[i];
+            for (uint32_t lane = 0; lane < block.count; ++lane)
+            {
+                m_currentImpulses[block.cacheEntry[lane]].impulse = block.impulse[lane];
+            }
+        }
+    });
+    std::swap(m_previousImpulses, m_currentImpulses);
+}
+
+size_t ContactSolver::ColorContacts(const std::vector<BodyPair>& pairs)
+{
+    // Greedy coloring: every contact takes the lowest color neither of its dynamic bodies has used yet.
+    // This is the only part of the solver that runs in order, so it does nothing else. The broadphase
+    // reports neighbouring bodies together, so the masks being read are mostly in cache.
+    std::fill(m_colorSizes.begin(), m_colorSizes.end(), 0);
+
+    size_t contactCount = 0;
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        Contact& contact = m_contacts[i];
+        if (contact.penetration < 0.0f)
+        {
+            continue;
+        }
+
+        const uint32_t a = pairs[i].a;
+        const uint32_t b = pairs[i].b;
+        const bool dynamicA = m_invMass[a] > 0.0f;
+        const bool dynamicB = m_invMass[b] > 0.0f;
+        const uint64_t used = (dynamicA ? m_bodyColors[a] : 0) | (dynamicB ? m_bodyColors[b] : 0);
+
+        // The overflow color's bit is never set, so a body with every other color taken lands there
+        const uint32_t color = static_cast<uint32_t>(std::countr_one(used));
+        if (color != OVERFLOW_COLOR)
+        {
+            const uint64_t bit = uint64_t{1} << color;
+            m_bodyColors[a] |= dynamicA ? bit : 0;
+            m_bodyColors[b] |= dynamicB ? bit : 0;
+        }
+
+        contact.color = color;
+        contact.rank = static_cast<uint32_t>(m_colorSizes[color]++);
+        ++contactCount;
+    }
+    return contactCount;
+}
+
+void ContactSolver::LayoutBlocks()
+{
+    // Overflow contacts may share bodies, so they get a block each
+    m_colorCount = 0;
+    m_colorBlockStart[0] = 0;
+    for (uint32_t color = 0; color < MAX_COLORS; ++color)
+    {
+        const size_t colorSize = m_colorSizes[color];
+        const size_t blockCount = (color == OVERFLOW_COLOR) ? colorSize : (colorSize + LANES - 1) / LANES;
+        m_colorBlockStart[color + 1] = m_colorBlockStart[color] + static_cast<uint32_t>(blockCount);
+        m_colorCount = (colorSize > 0) ? color + 1 : m_colorCount;
+    }
+    m_blocks.resize(m_colorBlockStart[MAX_COLORS]);
+
+    for (uint32_t color = 0; color < MAX_COLORS; ++color)
+    {
+        const uint32_t begin = m_colorBlockStart[color];
+        const uint32_t end = m_colorBlockStart[color + 1];
+        if (begin == end)
+        {
+            continue;
+        }
+
+        // Padding lanes push nothing: zero mass and impulse
+        const size_t lanes = (color == OVERFLOW_COLOR) ? 1 : LANES;
+        for (uint32_t index = begin; index < end; ++index)
+        {
+            ContactBlock& block = m_blocks[index];
+            block.count = static_cast<uint32_t>(std::min(lanes, m_colorSizes[color] - (index - begin) * lanes));
+            for (size_t lane = block.count; lane < LANES; ++lane)
+            {
+                block.normalX[lane] = 0.0f;
+                block.normalY[lane] = 0.0f;
+                block.invMassA[lane] = 0.0f;
+                block.invMassB[lane] = 0.0f;
+                block.effectiveMass[lane] = 0.0f;
+                block.bias[lane] = 0.0f;
+                block.impulse[lane] = 0.0f;
+                block.bodyA[lane] = 0;
+                block.bodyB[lane] = 0;
+                block.cacheEntry[lane] = 0;
+            }
+        }
+    }
+}
+
+template <typename Function>
+void ContactSolver::ForEachBlockByColor(JobSystem* jobs, Function&& function)
+{
+    for (uint32_t color = 0; color < m_colorCount; ++color)
+    {
+        ContactBlock* const blocks = m_blocks.data() + m_colorBlockStart[color];
+        const size_t blockCount = m_colorBlockStart[color + 1] - m_colorBlockStart[color];
+        const auto solveRange = [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                function(blocks[i]);
+            }
+        };
+
+        // The overflow contacts depend on each other, so they run in order on this thread
+        if (color == OVERFLOW_COLOR)
+        {
+            solveRange(0, blockCount);
+        }
+        else
+        {
+            ParallelRange(jobs, blockCount, BLOCK_GRAIN, solveRange);
+        }
+    }
+}
+
+void ContactSolver::ApplyImpulses(const ContactBlock& block, float* vx, float* vy)
+{
+    // Static bodies are shared between lanes and threads, so they are never written even though their change is zero
+    for (uint32_t lane = 0; lane < block.count; ++lane)
+    {
+        const float impulseX = block.impulse[lane] * block.normalX[lane];
+        const float impulseY = block.impulse[lane] * block.normalY[lane];
+        if (block.invMassA[lane] > 0.0f)
+        {
+            vx[block.bodyA[lane]] -= block.invMassA[lane] * impulseX;
+            vy[block.bodyA[lane]] -= block.invMassA[lane] * impulseY;
+        }
+        if (block.invMassB[lane] > 0.0f)
+        {
+            vx[block.bodyB[lane]] += block.invMassB[lane] * impulseX;
+            vy[block.bodyB[lane]] += block.invMassB[lane] * impulseY;
+        }
+    }
+}
+
+void ContactSolver::SolveBlock(ContactBlock& block, float* vx, float* vy)
+{
+    // Gather every lane. Padding lanes compute a zero impulse from the bodies of the first lane, which no
+    // other block of the color writes (reading any other body could race with the thread solving it).
+    alignas(32) float velocityAX[LANES];
+    alignas(32) float velocityAY[LANES];
+    alignas(32) float velocityBX[LANES];
+    alignas(32) float velocityBY[LANES];
+    for (size_t lane = 0; lane < LANES; ++lane)
+    {
+        const size_t source = (lane < block.count) ? lane : 0;
+        velocityAX[lane] = vx[block.bodyA[source]];
+        velocityAY[lane] = vy[block.bodyA[source]];
+        velocityBX[lane] = vx[block.bodyB[source]];
+        velocityBY[lane] = vy[block.bodyB[source]];
+    }
+
+    // Branch free over a fixed number of lanes, so the compiler turns each line into SIMD instructions
+    for (size_t lane = 0; lane < LANES; ++lane)
+    {
+        const float normalSpeed = (velocityBX[lane] - velocityAX[lane]) * block.normalX[lane] +
+                                  (velocityBY[lane] - velocityAY[lane]) * block.normalY[lane];
+        const float lambda = block.effectiveMass[lane] * (block.bias[lane] - normalSpeed);
+
+        // The accumulated impulse may only push, so clamp it rather than the change
+        const float impulse = std::max(block.impulse[lane] + lambda, 0.0f);
+        const float change = impulse - block.impulse[lane];
+        block.impulse[lane] = impulse;
+
+        velocityAX[lane] -= block.invMassA[lane] * change * block.normalX[lane];
+        velocityAY[lane] -= block.invMassA[lane] * change * block.normalY[lane];
+        velocityBX[lane] += block.invMassB[lane] * change * block.normalX[lane];
+        velocityBY[lane] += block.invMassB[lane] * change * block.normalY[lane];
+    }
+
+    for (uint32_t lane = 0; lane < block.count; ++lane)
+    {
+        if (block.invMassA[lane] > 0.0f)
+        {
+            vx[block.bodyA[lane]] = velocityAX[lane];
+            vy[block.bodyA[lane]] = velocityAY[lane];
+        }
+        if (block.invMassB[lane] > 0.0f)
+        {
+            vx[block.bodyB[lane]] = velocityBX[lane];
+            vy[block.bodyB[lane]] = velocityBY[lane];
+        }
+    }
+}
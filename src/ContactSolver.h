@@ -0,0 +1,152 @@
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+// ContactSolver.h
+// This file contains the contact solver, which stops overlapping bodies from moving into
+// each other and pushes them apart.
+// Every broadphase pair whose circles overlap becomes a contact, and a sequential impulse
+// (projected Gauss-Seidel) solver repeatedly applies impulses along the contact normals.
+// Solved one after another, each contact reads the velocities the previous one wrote, so
+// the contacts are graph colored first: within one color no dynamic body appears twice
+// (static bodies are never written, so they don't count). All the contacts of a color can
+// then be solved at once, spread over a JobSystem and several per SIMD register, with the
+// same result as solving them in order. The colors themselves are solved one after another.
+// The impulse each contact ends a step with is cached under its pair of bodies and applied
+// again at the start of the next step (warm starting), so resting piles stay at rest with
+// only a few iterations.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "JobSystem.h"
+
+struct ContactSolverSettings
+{
+    unsigned int iterations   = 8;    // Passes over every color per step
+    float        baumgarte    = 0.2f; // Fraction of the penetration removed per step
+    float        linearSlop   = 0.1f * BODY_DEFAULT_RADIUS; // Penetration left alone, so resting contacts don't jitter
+    float        maxPushSpeed = 1.0f; // Fastest the penetration correction separates two bodies
+    bool         warmStarting = true;
+};
+
+class ContactSolver
+{
+public:
+    // Contacts solved together, one per SIMD lane
+    static constexpr size_t LANES = 8;
+
+    // Colors are tracked per body in a 64 bit mask. Contacts that find every color of their
+    // bodies taken go to the last color, which is solved one contact at a time.
+    static constexpr uint32_t MAX_COLORS     = 64;
+    static constexpr uint32_t OVERFLOW_COLOR = MAX_COLORS - 1;
+
+    explicit ContactSolver(const ContactSolverSettings& settings = {});
+
+    // Find the contacts among the pairs and change the bodies' velocities so they separate.
+    // Runs on the calling thread if jobs is nullptr.
+    void Solve(BodyStore& bodies, const std::vector<BodyPair>& pairs, float dt, JobSystem* jobs = nullptr);
+
+    // Forget the cached impulses
+    void ClearWarmStart();
+
+    const ContactSolverSettings& GetSettings() const { return m_settings; }
+    void SetSettings(const ContactSolverSettings& settings) { m_settings = settings; }
+
+    // Statistics of the last Solve
+    size_t   GetContactCount()     const { return m_contactCount; }
+    size_t   GetWarmStartedCount() const { return m_warmStartedCount; } // Contacts that found a cached impulse
+    uint32_t GetColorCount()       const { return m_colorCount; }       // Colors used, including the overflow color
+    size_t   GetColorSize(const uint32_t color) const { return m_colorSizes[color]; }
+
+private:
+    // Narrowphase result for one broadphase pair
+    struct Contact
+    {
+        float    normalX = 0.0f;     // Unit vector from body a to body b
+        float    normalY = 0.0f;
+        float    penetration = 0.0f; // Negative if the circles don't touch
+        uint32_t color = 0;
+        uint32_t rank = 0;           // Position among the contacts of the same color
+    };
+
+    // LANES contacts of one color as a structure of arrays, so each field loads into one SIMD register
+    struct alignas(64) ContactBlock
+    {
+        float    normalX[LANES];
+        float    normalY[LANES];
+        float    invMassA[LANES];
+        float    invMassB[LANES];
+        float    effectiveMass[LANES];
+        float    bias[LANES];        // Separating speed the contact aims for
+        float    impulse[LANES];     // Accumulated this step, never negative
+        uint32_t bodyA[LANES];
+        uint32_t bodyB[LANES];
+        uint32_t cacheEntry[LANES];
+        uint32_t count;              // Lanes in use, the rest have no effect
+    };
+
+    // Open addressing hash table of the impulses of the last step, by body pair
+    class ImpulseCache
+    {
+    public:
+        struct Entry
+        {
+            uint64_t key = EMPTY_KEY;
+            uint32_t generations = 0;
+            float    impulse = 0.0f;
+        };
+
+        static constexpr uint64_t EMPTY_KEY = ~uint64_t{0};
+
+        // Empty the table and size it for count entries, clearing it on jobs
+        void Reset(size_t count, JobSystem* jobs);
+
+        // Index of the new entry for key, which must not be in the table yet. Safe to call from several threads at once.
+        uint32_t Insert(uint64_t key, uint32_t generations);
+
+        // Impulse stored for key, or 0 if it isn't there or belongs to bodies that reused the slots
+        float Find(uint64_t key, uint32_t generations) const;
+
+        Entry& operator[](const uint32_t entry) { return m_entries[entry]; }
+
+    private:
+        std::vector<Entry> m_entries; // Power of two size, at most half full
+        unsigned int       m_shift = 64;
+
+        // Fibonacci hashing, the top bits of the product are the best mixed. Keys made of neighbouring
+        // slots have to be scattered, or the entries of a crowded area pile up into long probe runs.
+        size_t Home(const uint64_t key) const { return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> m_shift); }
+    };
+
+    ContactSolverSettings     m_settings;
+    std::vector<float>        m_invMass;     // By array index, 0 for static bodies
+    std::vector<uint64_t>     m_bodyColors;  // Colors already used by each body's contacts
+    std::vector<Contact>      m_contacts;    // One per broadphase pair
+    std::vector<ContactBlock> m_blocks;      // Blocks of color c are [m_colorBlockStart[c], m_colorBlockStart[c + 1])
+    std::vector<uint32_t>     m_colorBlockStart;
+    std::vector<size_t>       m_colorSizes;
+    ImpulseCache              m_previousImpulses;
+    ImpulseCache              m_currentImpulses;
+
+    size_t   m_contactCount = 0;
+    size_t   m_warmStartedCount = 0;
+    uint32_t m_colorCount = 0;
+
+    // Assign every touching contact a color and its rank within it. Returns the number of contacts.
+    size_t ColorContacts(const std::vector<BodyPair>& pairs);
+
+    // Lay out the blocks of every color and fill in their padding lanes
+    void LayoutBlocks();
+
+    // Apply the impulses of the blocks to the velocities, lanes of one block must not share a dynamic body
+    static void ApplyImpulses(const ContactBlock& block, float* vx, float* vy);
+    static void SolveBlock(ContactBlock& block, float* vx, float* vy);
+
+    // Call function(block) for every block of every color, one color after another
+    template <typename Function>
+    void ForEachBlockByColor(JobSystem* jobs, Function&& function);
+};
+
+#endif // !CONTACT_SOLVER_H
@@ -0,0 +1,190 @@
+#include "DrawQueue.h"
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+// The buffer the calling thread last recorded into, and the queue it belongs to
+struct DrawQueueThreadBuffer
+{
+    uint64_t queueId = 0;
+    void*    commands = nullptr; // DrawQueue::ThreadCommands
+};
+
+static thread_local DrawQueueThreadBuffer t_drawQueueBuffer;
+static std::atomic<uint64_t> s_nextQueueId{1};
+
+// Bytes of the sort key: the 4 of the first instance, less significant, then the 8 of the key
+static constexpr uint32_t SORT_DIGITS = 12;
+
+DrawQueue::DrawQueue()
+    : m_queueId(s_nextQueueId.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+DrawQueue::ThreadCommands& DrawQueue::ThreadBuffer()
+{
+    if (t_drawQueueBuffer.queueId == m_queueId)
+    {
+        return *static_cast<ThreadCommands*>(t_drawQueueBuffer.commands);
+    }
+
+    // The first command of this thread, or it recorded into another queue since
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    const std::thread::id thread = std::this_thread::get_id();
+    ThreadCommands* buffer = nullptr;
+    for (const std::unique_ptr<ThreadCommands>& threadCommands : m_threads)
+    {
+        if (threadCommands->thread == thread)
+        {
+            buffer = threadCommands.get();
+            break;
+        }
+    }
+    if (buffer == nullptr)
+    {
+        m_threads.push_back(std::make_unique<ThreadCommands>());
+        buffer = m_threads.back().get();
+        buffer->thread = thread;
+    }
+    t_drawQueueBuffer = DrawQueueThreadBuffer{m_queueId, buffer};
+    return *buffer;
+}
+
+void DrawQueue::Record(const DrawCommand& command)
+{
+    ThreadBuffer().commands.push_back(command);
+}
+
+const std::vector<DrawBatch>& DrawQueue::Build()
+{
+    m_commands.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_threadsMutex);
+        for (const std::unique_ptr<ThreadCommands>& threadCommands : m_threads)
+        {
+            m_commands.insert(m_commands.end(), threadCommands->commands.begin(), threadCommands->commands.end());
+            threadCommands->commands.clear();
+        }
+    }
+
+    Sort();
+    Merge();
+
+    m_stats.commands = m_commands.size();
+    m_stats.batches = m_batches.size();
+    return m_batches;
+}
+
+uint32_t DrawQueue::SortDigit(const SortEntry& entry, const uint32_t digit)
+{
+    return (digit < 4) ? (entry.firstInstance >> (8 * digit)) & 0xFF
+                       : static_cast<uint32_t>(entry.key >> (8 * (digit - 4))) & 0xFF;
+}
+
+void DrawQueue::Sort()
+{
+    const size_t count = m_commands.size();
+    m_sortEntries.resize(count);
+    m_scratchEntries.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_sortEntries[i] = SortEntry{m_commands[i].key, m_commands[i].firstInstance, static_cast<uint32_t>(i)};
+    }
+
+    // Least significant digit radix sort, 8 bits per pass, by key and then by first instance so the
+    // instances that continue one another end up in order. Every histogram is counted in one read.
+    std::array<std::array<uint32_t, 256>, SORT_DIGITS> counts = {};
+    for (const SortEntry& entry : m_sortEntries)
+    {
+        for (uint32_t digit = 0; digit < 4; ++digit)
+        {
+            ++counts[digit][(entry.firstInstance >> (8 * digit)) & 0xFF];
+        }
+        for (uint32_t digit = 0; digit < 8; ++digit)
+        {
+            ++counts[4 + digit][(entry.key >> (8 * digit)) & 0xFF];
+        }
+    }
+
+    for (uint32_t digit = 0; digit < SORT_DIGITS; ++digit)
+    {
+        // A digit every command shares doesn't change the order, which is most of them with few shaders and arrays
+        if (count == 0 || counts[digit][SortDigit(m_sortEntries[0], digit)] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& digitCount : counts[digit])
+        {
+            const uint32_t digitStart = offset;
+            offset += digitCount;
+            digitCount = digitStart;
+        }
+
+        for (const SortEntry& entry : m_sortEntries)
+        {
+            m_scratchEntries[counts[digit][SortDigit(entry, digit)]++] = entry;
+        }
+        std::swap(m_sortEntries, m_scratchEntries);
+    }
+}
+
+void DrawQueue::Merge()
+{
+    m_batches.clear();
+    m_multiDrawCounts.clear();
+    m_multiDrawOffsets.clear();
+
+    const auto rangeOffset = [](const unsigned int firstIndex)
+    {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(firstIndex) * sizeof(unsigned int));
+    };
+
+    uint64_t batchKey = 0;
+    for (const SortEntry& entry : m_sortEntries)
+    {
+        const DrawCommand& command = m_commands[entry.index];
+        DrawBatch* const last = m_batches.empty() ? nullptr : &m_batches.back();
+
+        // Only commands with the same state merge, the depth may differ
+        const bool sameState = last != nullptr && ((batchKey ^ command.key) >> 16) == 0 && last->shader == command.shader &&
+                               last->vertexArray == command.vertexArray && last->indexBuffer == command.indexBuffer;
+        if (sameState && last->multiDrawCount == 0 && last->indexCount == command.indexCount &&
+            last->firstIndex == command.firstIndex && last->firstInstance + last->instanceCount == command.firstInstance)
+        {
+            // The instances continue the batch's
+            last->instanceCount += command.instanceCount;
+            continue;
+        }
+
+        const bool plain = command.instanceCount == 1 && command.firstInstance == 0;
+        if (sameState && plain && (last->multiDrawCount > 0 || (last->instanceCount == 1 && last->firstInstance == 0)))
+        {
+            // Another index range of plain draws, the batch becomes a multi draw if it isn't already
+            if (last->multiDrawCount == 0)
+            {
+                last->multiDrawFirst = m_multiDrawCounts.size();
+                last->multiDrawCount = 1;
+                m_multiDrawCounts.push_back(static_cast<int>(last->indexCount));
+                m_multiDrawOffsets.push_back(rangeOffset(last->firstIndex));
+            }
+            ++last->multiDrawCount;
+            m_multiDrawCounts.push_back(static_cast<int>(command.indexCount));
+            m_multiDrawOffsets.push_back(rangeOffset(command.firstIndex));
+            continue;
+        }
+
+        DrawBatch batch;
+        batch.shader = command.shader;
+        batch.vertexArray = command.vertexArray;
+        batch.indexBuffer = command.indexBuffer;
+        batch.indexCount = command.indexCount;
+        batch.firstIndex = command.firstIndex;
+        batch.instanceCount = command.instanceCount;
+        batch.firstInstance = command.firstInstance;
+        m_batches.push_back(batch);
+        batchKey = command.key;
+    }
+}
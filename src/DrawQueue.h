@@ -0,0 +1,131 @@
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+// DrawQueue.h
+// This file contains the per-frame queue of draw commands the Renderer issues in one go.
+// Drawing straight away issues the draws in whatever order the code reaches them, so the
+// shader and vertex array change back and forth as soon as there is more than one kind of
+// object. Instead each draw is recorded as a DrawCommand with a 64-bit sort key, and once a
+// frame the queue radix sorts the commands by key: draws with the same shader, then the same
+// vertex array and texture, end up next to each other, front to back by depth within that.
+// Neighbouring commands with the same state are then merged. Instances that continue one
+// another become one instanced draw, and plain draws of different index ranges become one
+// glMultiDrawElements call. The result is a list of DrawBatches, one per OpenGL draw call.
+// Commands can be recorded from any thread, job threads included: every thread appends to
+// its own buffer, so recording only takes a lock the first time a thread records into a
+// queue. Build runs on the GL thread once no thread is recording, and empties the buffers for
+// the next frame. The queue itself makes no OpenGL calls, see Renderer::Flush for that.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class IndexBuffer;
+class Shader;
+class VertexArray;
+
+// Sort key of a draw: shader, vertex array and texture IDs (their low 16 bits) from the most
+// significant bits down, then the depth, smaller first. Pass texture 0 for untextured draws.
+inline uint64_t MakeDrawKey(const unsigned int shader, const unsigned int vertexArray, const unsigned int texture, const uint16_t depth)
+{
+    return (static_cast<uint64_t>(shader & 0xFFFF) << 48) | (static_cast<uint64_t>(vertexArray & 0xFFFF) << 32) |
+           (static_cast<uint64_t>(texture & 0xFFFF) << 16) | depth;
+}
+
+// One indexed draw of triangles, as recorded
+struct DrawCommand
+{
+    uint64_t           key = 0; // From MakeDrawKey
+    const Shader*      shader = nullptr;
+    const VertexArray* vertexArray = nullptr;
+    const IndexBuffer* indexBuffer = nullptr;
+    unsigned int       indexCount = 0;
+    unsigned int       firstIndex = 0;
+    unsigned int       instanceCount = 1;
+    unsigned int       firstInstance = 0; // Above 0 needs GL 4.2 or ARB_base_instance
+};
+
+// One OpenGL draw call made of one or more commands with the same state
+struct DrawBatch
+{
+    const Shader*      shader = nullptr;
+    const VertexArray* vertexArray = nullptr;
+    const IndexBuffer* indexBuffer = nullptr;
+    unsigned int       indexCount = 0;
+    unsigned int       firstIndex = 0;
+    unsigned int       instanceCount = 1;
+    unsigned int       firstInstance = 0;
+    size_t             multiDrawFirst = 0; // The batch's ranges in GetMultiDrawCounts and GetMultiDrawOffsets
+    size_t             multiDrawCount = 0; // 0 for an instanced draw of the range above, else a multi draw of that many ranges
+};
+
+struct DrawQueueStats
+{
+    size_t commands = 0; // Recorded
+    size_t batches  = 0; // OpenGL draw calls they were merged into
+};
+
+class DrawQueue
+{
+public:
+    DrawQueue();
+
+    DrawQueue(const DrawQueue&) = delete;
+    DrawQueue& operator=(const DrawQueue&) = delete;
+
+    // Append a command to the calling thread's buffer. Safe to call from several threads at once.
+    void Record(const DrawCommand& command);
+
+    // Sort every recorded command by key and merge them into batches, then empty the buffers.
+    // Call while no thread is recording. The batches stay valid until the next Build.
+    const std::vector<DrawBatch>& Build();
+
+    // Index counts and offsets (in bytes, into the index buffer) of the multi draw ranges of the last Build
+    const std::vector<int>&         GetMultiDrawCounts()  const { return m_multiDrawCounts; }
+    const std::vector<const void*>& GetMultiDrawOffsets() const { return m_multiDrawOffsets; }
+
+    // Statistics of the last Build
+    const DrawQueueStats& GetStats() const { return m_stats; }
+
+private:
+    // The commands one thread has recorded
+    struct ThreadCommands
+    {
+        std::thread::id          thread;
+        std::vector<DrawCommand> commands;
+    };
+
+    // Key and first instance of a command and where it is in m_commands, what the radix sort moves
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t firstInstance;
+        uint32_t index;
+    };
+
+    const uint64_t                               m_queueId; // Tells queues apart in the threads' thread_local buffer
+    std::mutex                                   m_threadsMutex;
+    std::vector<std::unique_ptr<ThreadCommands>> m_threads;
+
+    // Reused from frame to frame
+    std::vector<DrawCommand>  m_commands;
+    std::vector<SortEntry>    m_sortEntries;
+    std::vector<SortEntry>    m_scratchEntries;
+    std::vector<DrawBatch>    m_batches;
+    std::vector<int>          m_multiDrawCounts;
+    std::vector<const void*>  m_multiDrawOffsets;
+    DrawQueueStats            m_stats;
+
+    // The calling thread's buffer, registered on first use
+    ThreadCommands& ThreadBuffer();
+
+    // Byte digit of the sort key, from the least significant
+    static uint32_t SortDigit(const SortEntry& entry, uint32_t digit);
+
+    void Sort();
+    void Merge();
+};
+
+#endif // !DRAW_QUEUE_H
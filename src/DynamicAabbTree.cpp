@@ -0,0 +1,324 @@
+#include "DynamicAabbTree.h"
+
+// Grow box by margin on every side
+static inline AABB Fatten(const AABB& box, const float margin)
+{
+    return AABB{box.minX - margin, box.minY - margin, box.maxX + margin, box.maxY + margin};
+}
+
+DynamicAabbTree::DynamicAabbTree()
+{
+    m_nodes.reserve(64);
+}
+
+int32_t DynamicAabbTree::AllocateNode()
+{
+    // The vector is the pool, it only grows when every node is in use
+    if (m_freeList == NULL_NODE)
+    {
+        m_nodes.emplace_back();
+        return static_cast<int32_t>(m_nodes.size() - 1);
+    }
+
+    const int32_t node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+    return node;
+}
+
+void DynamicAabbTree::FreeNode(const int32_t node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].child1 = NULL_NODE;
+    m_nodes[node].child2 = NULL_NODE;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int32_t DynamicAabbTree::CreateProxy(const AABB& box, const float margin, const uint32_t userData)
+{
+    const int32_t proxy = AllocateNode();
+    m_nodes[proxy].box = Fatten(box, margin);
+    m_nodes[proxy].userData = userData;
+    InsertLeaf(proxy);
+    ++m_leafCount;
+    return proxy;
+}
+
+void DynamicAabbTree::DestroyProxy(const int32_t proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --m_leafCount;
+}
+
+bool DynamicAabbTree::MoveProxy(const int32_t proxy, const AABB& box, const float margin, const float displacementX, const float displacementY)
+{
+    if (m_nodes[proxy].box.Contains(box))
+    {
+        return false;
+    }
+
+    AABB fatBox = Fatten(box, margin);
+    if (displacementX < 0.0f)
+    {
+        fatBox.minX += displacementX;
+    }
+    else
+    {
+        fatBox.maxX += displacementX;
+    }
+    if (displacementY < 0.0f)
+    {
+        fatBox.minY += displacementY;
+    }
+    else
+    {
+        fatBox.maxY += displacementY;
+    }
+
+    RemoveLeaf(proxy);
+    m_nodes[proxy].box = fatBox;
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicAabbTree::InsertLeaf(const int32_t leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that makes the tree's total perimeter grow the least.
+    // Every node on the way grows to hold the leaf (the inheritance cost), so stop once
+    // pairing the leaf with the current node is cheaper than going further down.
+    const AABB leafBox = m_nodes[leaf].box;
+    int32_t index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        const Node& node = m_nodes[index];
+        const float area = node.box.Perimeter();
+        const float combinedArea = AABB::Union(node.box, leafBox).Perimeter();
+        const float cost = 2.0f * combinedArea;
+        const float inheritance = 2.0f * (combinedArea - area);
+
+        const auto descendCost = [&](const int32_t child)
+        {
+            const Node& childNode = m_nodes[child];
+            const float childCombined = AABB::Union(childNode.box, leafBox).Perimeter();
+            return (childNode.IsLeaf() ? childCombined : childCombined - childNode.box.Perimeter()) + inheritance;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2)
+        {
+            break;
+        }
+        index = (cost1 < cost2) ? node.child1 : node.child2;
+    }
+
+    // Pair the leaf with the sibling under a new parent
+    const int32_t sibling = index;
+    const int32_t oldParent = m_nodes[sibling].parent;
+    const int32_t newParent = AllocateNode();
+    Node& parent = m_nodes[newParent];
+    parent.parent = oldParent;
+    parent.box = AABB::Union(leafBox, m_nodes[sibling].box);
+    parent.height = m_nodes[sibling].height + 1;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+
+    if (oldParent == NULL_NODE)
+    {
+        m_root = newParent;
+    }
+    else if (m_nodes[oldParent].child1 == sibling)
+    {
+        m_nodes[oldParent].child1 = newParent;
+    }
+    else
+    {
+        m_nodes[oldParent].child2 = newParent;
+    }
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    RefitAncestors(oldParent);
+}
+
+void DynamicAabbTree::RemoveLeaf(const int32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    // The leaf's sibling takes the place of their parent
+    const int32_t parent = m_nodes[leaf].parent;
+    const int32_t grandParent = m_nodes[parent].parent;
+    const int32_t sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    m_nodes[sibling].parent = grandParent;
+    if (grandParent == NULL_NODE)
+    {
+        m_root = sibling;
+    }
+    else if (m_nodes[grandParent].child1 == parent)
+    {
+        m_nodes[grandParent].child1 = sibling;
+    }
+    else
+    {
+        m_nodes[grandParent].child2 = sibling;
+    }
+    FreeNode(parent);
+
+    RefitAncestors(grandParent);
+}
+
+void DynamicAabbTree::RefitAncestors(int32_t node)
+{
+    while (node != NULL_NODE)
+    {
+        Rotate(node);
+
+        Node& current = m_nodes[node];
+        const Node& child1 = m_nodes[current.child1];
+        const Node& child2 = m_nodes[current.child2];
+        current.box = AABB::Union(child1.box, child2.box);
+        current.height = 1 + std::max(child1.height, child2.height);
+        node = current.parent;
+    }
+}
+
+void DynamicAabbTree::Rotate(const int32_t a)
+{
+    // Swapping a child of a with a grandchild on the other side only changes the box of the
+    // other child, so the swap that shrinks that box's perimeter the most shrinks the tree the most
+    const Node& nodeA = m_nodes[a];
+    if (nodeA.height < 2)
+    {
+        return;
+    }
+
+    const int32_t b = nodeA.child1;
+    const int32_t c = nodeA.child2;
+    const Node& nodeB = m_nodes[b];
+    const Node& nodeC = m_nodes[c];
+
+    float bestGain = 0.0f;
+    int32_t child = NULL_NODE;      // Child of a that moves down
+    int32_t otherChild = NULL_NODE; // Child of a whose child moves up
+    int32_t grandchild = NULL_NODE; // Child of otherChild that moves up
+    int32_t keptGrandchild = NULL_NODE;
+
+    const auto consider = [&](const int32_t down, const int32_t other, const int32_t up, const int32_t kept)
+    {
+        const float gain = m_nodes[other].box.Perimeter() - AABB::Union(m_nodes[down].box, m_nodes[kept].box).Perimeter();
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            child = down;
+            otherChild = other;
+            grandchild = up;
+            keptGrandchild = kept;
+        }
+    };
+
+    if (!nodeC.IsLeaf())
+    {
+        consider(b, c, nodeC.child1, nodeC.child2);
+        consider(b, c, nodeC.child2, nodeC.child1);
+    }
+    if (!nodeB.IsLeaf())
+    {
+        consider(c, b, nodeB.child1, nodeB.child2);
+        consider(c, b, nodeB.child2, nodeB.child1);
+    }
+    if (child == NULL_NODE)
+    {
+        return;
+    }
+
+    // child and grandchild trade places
+    Node& parentA = m_nodes[a];
+    if (parentA.child1 == child)
+    {
+        parentA.child1 = grandchild;
+    }
+    else
+    {
+        parentA.child2 = grandchild;
+    }
+    m_nodes[grandchild].parent = a;
+
+    Node& other = m_nodes[otherChild];
+    if (other.child1 == grandchild)
+    {
+        other.child1 = child;
+    }
+    else
+    {
+        other.child2 = child;
+    }
+    m_nodes[child].parent = otherChild;
+
+    other.box = AABB::Union(m_nodes[child].box, m_nodes[keptGrandchild].box);
+    other.height = 1 + std::max(m_nodes[child].height, m_nodes[keptGrandchild].height);
+    parentA.height = 1 + std::max(m_nodes[grandchild].height, other.height);
+}
+
+float DynamicAabbTree::GetAreaRatio() const
+{
+    if (m_root == NULL_NODE)
+    {
+        return 0.0f;
+    }
+
+    float totalArea = 0.0f;
+    for (const Node& node : m_nodes)
+    {
+        if (node.height >= 0)
+        {
+            totalArea += node.box.Perimeter();
+        }
+    }
+    return totalArea / m_nodes[m_root].box.Perimeter();
+}
+
+bool DynamicAabbTree::Validate() const
+{
+    size_t freeCount = 0;
+    for (int32_t node = m_freeList; node != NULL_NODE; node = m_nodes[node].parent)
+    {
+        ++freeCount;
+    }
+
+    // Every node is either free or in the tree, and a tree of n leaves has n - 1 internal nodes
+    const size_t treeNodes = (m_leafCount == 0) ? 0 : 2 * m_leafCount - 1;
+    return freeCount + treeNodes == m_nodes.size() && (m_root == NULL_NODE || ValidateNode(m_root, NULL_NODE));
+}
+
+bool DynamicAabbTree::ValidateNode(const int32_t node, const int32_t parent) const
+{
+    const Node& current = m_nodes[node];
+    if (current.parent != parent)
+    {
+        return false;
+    }
+    if (current.IsLeaf())
+    {
+        return current.height == 0;
+    }
+
+    const Node& child1 = m_nodes[current.child1];
+    const Node& child2 = m_nodes[current.child2];
+    return current.height == 1 + std::max(child1.height, child2.height) &&
+           current.box.Contains(child1.box) && current.box.Contains(child2.box) &&
+           ValidateNode(current.child1, node) && ValidateNode(current.child2, node);
+}
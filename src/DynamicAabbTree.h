@@ -0,0 +1,311 @@
+#ifndef DYNAMIC_AABB_TREE_H
+#define DYNAMIC_AABB_TREE_H
+// DynamicAabbTree.h
+// This file contains a dynamic bounding volume hierarchy of axis aligned boxes.
+// Every leaf (a proxy) holds a fattened box around one object, so small movements
+// don't touch the tree at all; only an object that leaves its fat box is removed and
+// reinserted. Insertion walks down to the sibling that adds the least perimeter (the
+// 2D surface area heuristic), and on the way back up every node tries the rotation
+// that shrinks its children the most, which keeps the tree shallow without a rebuild.
+// Nodes live in one pool with a free list and are referred to by index, so creating
+// and destroying proxies never allocates once the pool has grown.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Axis aligned bounding box
+struct AABB
+{
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+
+    float Perimeter() const { return 2.0f * ((maxX - minX) + (maxY - minY)); }
+
+    bool Contains(const AABB& other) const
+    {
+        return minX <= other.minX && minY <= other.minY && other.maxX <= maxX && other.maxY <= maxY;
+    }
+
+    bool Overlaps(const AABB& other) const
+    {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+
+    static AABB Union(const AABB& a, const AABB& b)
+    {
+        return AABB{std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+    }
+};
+
+class DynamicAabbTree
+{
+public:
+    static constexpr int32_t NULL_NODE = -1;
+
+    DynamicAabbTree();
+
+    // Add a leaf for box grown by margin on every side, and return its proxy id
+    int32_t CreateProxy(const AABB& box, float margin, uint32_t userData);
+
+    void DestroyProxy(int32_t proxy);
+
+    // Update a proxy for its object's new box. The leaf is only reinserted if box has left its fat box, and then
+    // the fat box is also stretched by displacement (how far the object is expected to move) so a steadily
+    // moving object doesn't have to be reinserted every time. Returns true if it was reinserted.
+    bool MoveProxy(int32_t proxy, const AABB& box, float margin, float displacementX = 0.0f, float displacementY = 0.0f);
+
+    const AABB& GetFatAABB(const int32_t proxy)  const { return m_nodes[proxy].box; }
+    uint32_t    GetUserData(const int32_t proxy) const { return m_nodes[proxy].userData; }
+    void        SetUserData(const int32_t proxy, const uint32_t userData) { m_nodes[proxy].userData = userData; }
+
+    // Call callback(proxy) for every leaf whose fat box overlaps box. Returning false from the callback stops the query.
+    // The callbacks of both queries must not change the tree.
+    template <typename Callback>
+    void Query(const AABB& box, Callback&& callback) const;
+
+    // Call callback(proxyA, proxyB) once for every pair of leaves whose fat boxes overlap, by walking the tree
+    // against itself. Much cheaper than querying every leaf's box, which visits every pair twice from the root.
+    template <typename Callback>
+    void QueryOverlappingPairs(Callback&& callback) const;
+
+    // Call callback(proxy, maxDistance) for every leaf whose fat box the ray from (originX, originY) along the unit
+    // direction (dirX, dirY) enters within maxDistance. The callback returns the new maxDistance (e.g. the distance
+    // of an exact hit, to only look for closer ones), or a negative value to stop.
+    template <typename Callback>
+    void RayCast(float originX, float originY, float dirX, float dirY, float maxDistance, Callback&& callback) const;
+
+    int32_t GetHeight()    const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+    size_t  GetLeafCount() const { return m_leafCount; }
+
+    // Sum of the perimeters of all nodes over the root's, a measure of the tree's quality (lower is better)
+    float GetAreaRatio() const;
+
+    // Check parent links, heights and that every node's box contains its children's. For tests.
+    bool Validate() const;
+
+private:
+    struct Node
+    {
+        AABB     box;
+        int32_t  parent = NULL_NODE; // Next free node while the node is in the free list
+        int32_t  child1 = NULL_NODE;
+        int32_t  child2 = NULL_NODE;
+        int32_t  height = 0;         // 0 for leaves, -1 for free nodes
+        uint32_t userData = 0;
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<Node> m_nodes;
+    int32_t           m_root = NULL_NODE;
+    int32_t           m_freeList = NULL_NODE;
+    size_t            m_leafCount = 0;
+
+    int32_t AllocateNode();
+    void    FreeNode(int32_t node);
+
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+
+    // Refit the boxes and heights from node up to the root, rotating every node on the way
+    void RefitAncestors(int32_t node);
+    void Rotate(int32_t node);
+
+    bool ValidateNode(int32_t node, int32_t parent) const;
+
+    // Traversal stack that lives on the call stack unless the tree is unusually deep
+    template <typename T>
+    class TraversalStack
+    {
+    public:
+        void Push(const T node)
+        {
+            if (m_size < INLINE_CAPACITY)
+            {
+                m_inline[m_size] = node;
+            }
+            else
+            {
+                m_overflow.push_back(node);
+            }
+            ++m_size;
+        }
+
+        T Pop()
+        {
+            --m_size;
+            if (m_size < INLINE_CAPACITY)
+            {
+                return m_inline[m_size];
+            }
+            const T node = m_overflow.back();
+            m_overflow.pop_back();
+            return node;
+        }
+
+        bool Empty() const { return m_size == 0; }
+
+    private:
+        static constexpr size_t INLINE_CAPACITY = 256;
+
+        T              m_inline[INLINE_CAPACITY];
+        std::vector<T> m_overflow; // Entries past INLINE_CAPACITY
+        size_t         m_size = 0;
+    };
+};
+
+template <typename Callback>
+void DynamicAabbTree::Query(const AABB& box, Callback&& callback) const
+{
+    TraversalStack<int32_t> stack;
+    if (m_root != NULL_NODE)
+    {
+        stack.Push(m_root);
+    }
+
+    while (!stack.Empty())
+    {
+        const int32_t index = stack.Pop();
+        const Node& node = m_nodes[index];
+        if (!node.box.Overlaps(box))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            if (!callback(index))
+            {
+                return;
+            }
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicAabbTree::QueryOverlappingPairs(Callback&& callback) const
+{
+    // A pair of equal nodes stands for every pair inside that subtree
+    struct NodePair
+    {
+        int32_t a;
+        int32_t b;
+    };
+
+    TraversalStack<NodePair> stack;
+    if (m_root != NULL_NODE)
+    {
+        stack.Push(NodePair{m_root, m_root});
+    }
+
+    while (!stack.Empty())
+    {
+        const NodePair pair = stack.Pop();
+        const Node& a = m_nodes[pair.a];
+
+        if (pair.a == pair.b)
+        {
+            if (!a.IsLeaf())
+            {
+                stack.Push(NodePair{a.child1, a.child1});
+                stack.Push(NodePair{a.child2, a.child2});
+                stack.Push(NodePair{a.child1, a.child2});
+            }
+            continue;
+        }
+
+        const Node& b = m_nodes[pair.b];
+        if (!a.box.Overlaps(b.box))
+        {
+            continue;
+        }
+
+        // Descend into the larger node, which splits the overlap the most
+        if (a.IsLeaf() && b.IsLeaf())
+        {
+            callback(pair.a, pair.b);
+        }
+        else if (b.IsLeaf() || (!a.IsLeaf() && a.box.Perimeter() >= b.box.Perimeter()))
+        {
+            stack.Push(NodePair{a.child1, pair.b});
+            stack.Push(NodePair{a.child2, pair.b});
+        }
+        else
+        {
+            stack.Push(NodePair{pair.a, b.child1});
+            stack.Push(NodePair{pair.a, b.child2});
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicAabbTree::RayCast(const float originX, const float originY, const float dirX, const float dirY, float maxDistance, Callback&& callback) const
+{
+    // Slab test. A zero direction component is handled on its own: 1 / 0 is infinite, and an origin
+    // exactly on a face would give 0 * infinity = NaN and cull the node and everything below it.
+    const float invDirX = (dirX != 0.0f) ? 1.0f / dirX : 0.0f;
+    const float invDirY = (dirY != 0.0f) ? 1.0f / dirY : 0.0f;
+
+    // Narrow [tEnter, tExit] to the slab of one axis. Returns false if the ray misses the slab.
+    const auto clipSlab = [](const float origin, const float dir, const float invDir, const float min, const float max,
+                             float& tEnter, float& tExit)
+    {
+        if (dir == 0.0f)
+        {
+            // Parallel to the slab, inside it for every t or never
+            return origin >= min && origin <= max;
+        }
+        const float t1 = (min - origin) * invDir;
+        const float t2 = (max - origin) * invDir;
+        tEnter = std::max(tEnter, std::min(t1, t2));
+        tExit = std::min(tExit, std::max(t1, t2));
+        return true;
+    };
+
+    TraversalStack<int32_t> stack;
+    if (m_root != NULL_NODE)
+    {
+        stack.Push(m_root);
+    }
+
+    while (!stack.Empty())
+    {
+        const int32_t index = stack.Pop();
+        const Node& node = m_nodes[index];
+
+        float tEnter = -std::numeric_limits<float>::infinity();
+        float tExit = std::numeric_limits<float>::infinity();
+        if (!clipSlab(originX, dirX, invDirX, node.box.minX, node.box.maxX, tEnter, tExit) ||
+            !clipSlab(originY, dirY, invDirY, node.box.minY, node.box.maxY, tEnter, tExit) ||
+            !(tEnter <= tExit) || tExit < 0.0f || tEnter > maxDistance)
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            maxDistance = callback(index, maxDistance);
+            if (maxDistance < 0.0f)
+            {
+                return;
+            }
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+#endif // !DYNAMIC_AABB_TREE_H
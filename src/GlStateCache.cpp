@@ -0,0 +1,154 @@
+#include "GlStateCache.h"
+
+#include <cstring>
+
+#include "OpenGlUtils.h"
+
+static thread_local GlStateCache* s_currentCache = nullptr;
+
+GlStateCache& CurrentGlState()
+{
+    static thread_local GlStateCache passThrough(false);
+    return (s_currentCache != nullptr) ? *s_currentCache : passThrough;
+}
+
+void SetCurrentGlState(GlStateCache* cache)
+{
+    s_currentCache = cache;
+}
+
+GlStateCache::GlStateCache(const bool enabled)
+    : m_enabled(enabled)
+{
+}
+
+bool GlStateCache::Change(unsigned int& current, const unsigned int value)
+{
+    if (m_enabled && current == value)
+    {
+        ++m_stats.skipped;
+        return false;
+    }
+    ++m_stats.issued;
+    current = m_enabled ? value : UNKNOWN;
+    return true;
+}
+
+void GlStateCache::UseProgram(const unsigned int program)
+{
+    if (Change(m_program, program))
+    {
+        GL_CALL(glUseProgram(program));
+    }
+}
+
+void GlStateCache::BindVertexArray(const unsigned int vertexArray)
+{
+    if (Change(m_vertexArray, vertexArray))
+    {
+        GL_CALL(glBindVertexArray(vertexArray));
+    }
+}
+
+void GlStateCache::BindBuffer(const unsigned int target, const unsigned int buffer)
+{
+    if (target == GL_ARRAY_BUFFER)
+    {
+        if (Change(m_arrayBuffer, buffer))
+        {
+            GL_CALL(glBindBuffer(target, buffer));
+        }
+        return;
+    }
+
+    if (target == GL_ELEMENT_ARRAY_BUFFER && m_vertexArray != UNKNOWN)
+    {
+        // Only known for the vertex arrays it was bound with through the cache
+        auto [it, inserted] = m_elementBuffers.try_emplace(m_vertexArray, UNKNOWN);
+        if (Change(it->second, buffer))
+        {
+            GL_CALL(glBindBuffer(target, buffer));
+        }
+        return;
+    }
+
+    // Other targets aren't cached, nor the element buffer while the vertex array is unknown
+    ++m_stats.issued;
+    GL_CALL(glBindBuffer(target, buffer));
+}
+
+void GlStateCache::SetUniform(const int location, const float* values, const unsigned int count)
+{
+    ASSERT(count >= 1 && count <= 4);
+
+    std::array<float, 4> value{};
+    std::memcpy(value.data(), values, count * sizeof(float));
+    if (m_enabled && m_program != UNKNOWN)
+    {
+        // Compared bit by bit, so a NaN matches itself and -0 differs from 0
+        const uint64_t key = (static_cast<uint64_t>(m_program) << 32) | static_cast<uint32_t>(location);
+        auto [it, inserted] = m_uniforms.try_emplace(key, value);
+        if (!inserted && std::memcmp(it->second.data(), value.data(), sizeof(value)) == 0)
+        {
+            ++m_stats.skipped;
+            return;
+        }
+        it->second = value;
+    }
+
+    ++m_stats.issued;
+    switch (count)
+    {
+        case 1: GL_CALL(glUniform1f(location, value[0])); break;
+        case 2: GL_CALL(glUniform2f(location, value[0], value[1])); break;
+        case 3: GL_CALL(glUniform3f(location, value[0], value[1], value[2])); break;
+        default: GL_CALL(glUniform4f(location, value[0], value[1], value[2], value[3])); break;
+    }
+}
+
+void GlStateCache::DeleteProgram(const unsigned int program)
+{
+    GL_CALL(glDeleteProgram(program));
+    if (m_program == program)
+    {
+        // Stays in use until another program is, whatever gets its name next isn't
+        m_program = UNKNOWN;
+    }
+    std::erase_if(m_uniforms, [program](const auto& entry) { return (entry.first >> 32) == program; });
+}
+
+void GlStateCache::DeleteVertexArray(const unsigned int vertexArray)
+{
+    GL_CALL(glDeleteVertexArrays(1, &vertexArray));
+    if (m_vertexArray == vertexArray)
+    {
+        m_vertexArray = 0; // Deleting the bound vertex array binds the default one
+    }
+    m_elementBuffers.erase(vertexArray);
+}
+
+void GlStateCache::DeleteBuffer(const unsigned int buffer)
+{
+    GL_CALL(glDeleteBuffers(1, &buffer));
+    if (m_arrayBuffer == buffer)
+    {
+        m_arrayBuffer = 0;
+    }
+    // Vertex arrays other than the bound one keep the buffer alive under its old name, so forget it everywhere
+    std::erase_if(m_elementBuffers, [buffer](const auto& entry) { return entry.second == buffer; });
+}
+
+void GlStateCache::Invalidate()
+{
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    m_arrayBuffer = UNKNOWN;
+    m_elementBuffers.clear();
+    m_uniforms.clear();
+}
+
+void GlStateCache::SetEnabled(const bool enabled)
+{
+    m_enabled = enabled;
+    Invalidate();
+}
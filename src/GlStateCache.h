@@ -0,0 +1,77 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+// GlStateCache.h
+// This file contains the cache of OpenGL bindings and uniform values that skips redundant calls.
+// Every draw binds its shader, vertex array and index buffer and sets its uniforms, but from
+// one draw to the next most of them are already what they should be. Each call still costs a
+// trip through the driver, which validates it and marks state dirty, and on software GL such
+// as llvmpipe that is a noticeable part of a frame with many draws. The cache remembers the
+// program in use, the bound vertex array, the buffer bound to each target (the element buffer
+// per vertex array, since that binding is part of the VAO) and the last value of every
+// uniform per program, and only calls OpenGL when something actually changes.
+// The Renderer owns the cache and makes it the current one of its thread (OpenGL contexts are
+// per thread), and the GL wrapper classes bind, set uniforms and delete through
+// CurrentGlState(). Without a Renderer the calls pass straight through. Anything that changes
+// these bindings without going through the cache must call Invalidate afterwards.
+
+// C++ Standard Library includes
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+struct GlStateStats
+{
+    uint64_t issued  = 0; // Calls that changed the state and went to OpenGL
+    uint64_t skipped = 0; // Calls that would have set the state to what it already was
+};
+
+class GlStateCache
+{
+public:
+    // A disabled cache passes every call through, but still counts them
+    explicit GlStateCache(bool enabled = true);
+
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vertexArray);
+    void BindBuffer(unsigned int target, unsigned int buffer);
+
+    // Set the uniform at location of the program in use to count (1 to 4) floats
+    void SetUniform(int location, const float* values, unsigned int count);
+
+    // Delete the object and forget it, OpenGL may give its name to a new one
+    void DeleteProgram(unsigned int program);
+    void DeleteVertexArray(unsigned int vertexArray);
+    void DeleteBuffer(unsigned int buffer);
+
+    // Forget every binding and value, the next call of each kind goes to OpenGL
+    void Invalidate();
+
+    bool IsEnabled() const { return m_enabled; }
+    void SetEnabled(bool enabled);
+
+    // Statistics since the start
+    const GlStateStats& GetStats() const { return m_stats; }
+
+private:
+    // A binding that isn't known, for example before the first call
+    static constexpr unsigned int UNKNOWN = ~0u;
+
+    bool          m_enabled;
+    unsigned int  m_program = UNKNOWN;
+    unsigned int  m_vertexArray = UNKNOWN;
+    unsigned int  m_arrayBuffer = UNKNOWN;
+    std::unordered_map<unsigned int, unsigned int> m_elementBuffers;       // By vertex array
+    std::unordered_map<uint64_t, std::array<float, 4>> m_uniforms;        // By program << 32 | location
+    GlStateStats  m_stats;
+
+    // Count the call and return true if it has to go to OpenGL
+    bool Change(unsigned int& current, unsigned int value);
+};
+
+// The cache of the Renderer on this thread, or a disabled one passing the calls through if there is none
+GlStateCache& CurrentGlState();
+
+// Make cache the current one of this thread, nullptr for none
+void SetCurrentGlState(GlStateCache* cache);
+
+#endif // !GL_STATE_CACHE_H
@@ -16,6 +16,7 @@ public:
     void Unbind() const;
 
     inline unsigned int GetCount() const { return m_Count; } // Get the number of indices in the buffer
+    inline unsigned int GetRendererId() const { return m_RendererId; }
 };
 
 #endif // !INDEX_BUFFER_H
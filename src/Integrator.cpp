@@ -0,0 +1,84 @@
+#include "Integrator.h"
+#include "IntegratorKernels.h"
+
+#if INTEGRATOR_X86 && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+const char* IntegratorTypeToString(const IntegratorType type)
+{
+    switch (type)
+    {
+        case IntegratorType::SEMI_IMPLICIT_EULER: return "SEMI_IMPLICIT_EULER";
+        case IntegratorType::VELOCITY_VERLET:     return "VELOCITY_VERLET";
+        case IntegratorType::RK4:                 return "RK4";
+        default:                                  return "UNKNOWN";
+    }
+}
+
+const char* SimdLevelToString(const SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SCALAR: return "SCALAR";
+        case SimdLevel::SSE:    return "SSE";
+        case SimdLevel::AVX2:   return "AVX2";
+        default:                return "UNKNOWN";
+    }
+}
+
+SimdLevel DetectSimdLevel()
+{
+#if INTEGRATOR_X86 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE;
+#elif INTEGRATOR_X86 && defined(_MSC_VER)
+    // AVX2 is leaf 7 EBX bit 5, and the OS has to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return (osSavesYmm && (info[1] & (1 << 5)) != 0) ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+IntegratorKernel GetScalarIntegratorKernel(const IntegratorType type)
+{
+    return SelectKernel<ScalarVec>(type);
+}
+
+Integrator::Integrator(const IntegratorType type, const SimdLevel simdLevel)
+    : m_type(type), m_simdLevel(SimdLevel::SCALAR), m_kernel(GetScalarIntegratorKernel(type))
+{
+    // Take the widest instruction set that was asked for, is supported by the CPU and was compiled in
+    const SimdLevel supported = DetectSimdLevel();
+    const SimdLevel wanted = simdLevel < supported ? simdLevel : supported;
+
+    IntegratorKernel kernel = nullptr;
+    if (wanted >= SimdLevel::AVX2 && (kernel = GetAvx2IntegratorKernel(type)) != nullptr)
+    {
+        m_simdLevel = SimdLevel::AVX2;
+        m_kernel = kernel;
+    }
+    else if (wanted >= SimdLevel::SSE && (kernel = GetSseIntegratorKernel(type)) != nullptr)
+    {
+        m_simdLevel = SimdLevel::SSE;
+        m_kernel = kernel;
+    }
+}
+
+void Integrator::Step(BodyStore& bodies, const float dt, const ForceField& forces, const float* ax, const float* ay) const
+{
+    IntegratorArrays arrays;
+    arrays.x     = bodies.X();
+    arrays.y     = bodies.Y();
+    arrays.vx    = bodies.VX();
+    arrays.vy    = bodies.VY();
+    arrays.ax    = ax;
+    arrays.ay    = ay;
+    arrays.flags = bodies.Flags();
+    arrays.count = bodies.Size();
+    m_kernel(arrays, dt, forces);
+}
@@ -0,0 +1,122 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+// Integrator.h
+// This file contains the integrators that advance the bodies' positions and velocities.
+// Every integrator (semi-implicit Euler, velocity Verlet and RK4) is written once over a
+// SIMD vector type in IntegratorKernels.h and compiled for AVX2, SSE and plain scalar
+// code. The Integrator picks the widest version the CPU supports when it is created.
+// After each step bodies that left the world are wrapped around to the opposite side.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BodyStore.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define INTEGRATOR_X86 1
+#else
+    #define INTEGRATOR_X86 0
+#endif
+
+// Bodies live on a torus: leaving one side of the world enters it from the opposite side
+inline constexpr float WORLD_MIN  = -1.0f;
+inline constexpr float WORLD_MAX  =  1.0f;
+inline constexpr float WORLD_SIZE = WORLD_MAX - WORLD_MIN;
+
+// Wrap a coordinate back into [WORLD_MIN, WORLD_MAX)
+inline float WrapCoordinate(float value)
+{
+    if (value >= WORLD_MAX)
+    {
+        value -= WORLD_SIZE;
+    }
+    else if (value < WORLD_MIN)
+    {
+        value += WORLD_SIZE;
+    }
+    return value;
+}
+
+// Shortest distance from a to b along one axis of the wrapped world
+inline float WrappedDelta(const float a, const float b)
+{
+    float delta = b - a;
+    if (delta > 0.5f * WORLD_SIZE)
+    {
+        delta -= WORLD_SIZE;
+    }
+    else if (delta < -0.5f * WORLD_SIZE)
+    {
+        delta += WORLD_SIZE;
+    }
+    return delta;
+}
+
+enum class IntegratorType
+{
+    SEMI_IMPLICIT_EULER,
+    VELOCITY_VERLET,
+    RK4
+};
+
+const char* IntegratorTypeToString(IntegratorType type);
+
+// Instruction sets the integrators are compiled for, from narrowest to widest
+enum class SimdLevel
+{
+    SCALAR,
+    SSE,
+    AVX2
+};
+
+const char* SimdLevelToString(SimdLevel level);
+
+// Widest instruction set this CPU supports
+SimdLevel DetectSimdLevel();
+
+// Forces acting on every body: a = gravity - damping * v (+ any per-body acceleration)
+struct ForceField
+{
+    float gravityX = 0.0f;
+    float gravityY = 0.0f;
+    float damping  = 0.0f; // Linear drag, per second
+};
+
+// The arrays an integrator works on. Every array must be padded to a multiple of
+// 8 elements past count (AlignedArray always is), the SIMD versions step through the padding.
+struct IntegratorArrays
+{
+    float*          x     = nullptr;
+    float*          y     = nullptr;
+    float*          vx    = nullptr;
+    float*          vy    = nullptr;
+    const float*    ax    = nullptr; // Per-body acceleration, held constant over the step. May be null.
+    const float*    ay    = nullptr;
+    const uint32_t* flags = nullptr; // BODY_FLAG_STATIC bodies are left untouched
+    size_t          count = 0;
+};
+
+using IntegratorKernel = void (*)(const IntegratorArrays& arrays, float dt, const ForceField& forces);
+
+class Integrator
+{
+public:
+    // Use the given integrator, compiled for the widest instruction set up to simdLevel that the CPU supports
+    explicit Integrator(IntegratorType type = IntegratorType::SEMI_IMPLICIT_EULER, SimdLevel simdLevel = SimdLevel::AVX2);
+
+    // Advance every body in the store by dt seconds
+    void Step(BodyStore& bodies, float dt, const ForceField& forces = {}, const float* ax = nullptr, const float* ay = nullptr) const;
+
+    // Advance the bodies in arrays by dt seconds
+    void Step(const IntegratorArrays& arrays, float dt, const ForceField& forces = {}) const { m_kernel(arrays, dt, forces); }
+
+    IntegratorType GetType()      const { return m_type; }
+    SimdLevel      GetSimdLevel() const { return m_simdLevel; }
+
+private:
+    IntegratorType   m_type;
+    SimdLevel        m_simdLevel;
+    IntegratorKernel m_kernel;
+};
+
+#endif // !INTEGRATOR_H
@@ -0,0 +1,60 @@
+#include "IntegratorKernels.h"
+
+// The integrators compiled for AVX2. CMake builds only this file with AVX2 enabled, and
+// the Integrator only calls into it after checking that the CPU supports AVX2.
+
+#if INTEGRATOR_X86 && defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+    struct Avx2Vec
+    {
+        using Mask = __m256;
+        static constexpr size_t WIDTH = 8;
+
+        __m256 v;
+
+        static Avx2Vec Load(const float* p)        { return {_mm256_load_ps(p)}; }
+        static void    Store(float* p, Avx2Vec a)  { _mm256_store_ps(p, a.v); }
+        static Avx2Vec Set1(const float f)         { return {_mm256_set1_ps(f)}; }
+
+        friend Avx2Vec operator+(Avx2Vec a, Avx2Vec b) { return {_mm256_add_ps(a.v, b.v)}; }
+        friend Avx2Vec operator-(Avx2Vec a, Avx2Vec b) { return {_mm256_sub_ps(a.v, b.v)}; }
+        friend Avx2Vec operator*(Avx2Vec a, Avx2Vec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+
+        static Mask Movable(const uint32_t* flags)
+        {
+            const __m256i staticBits = _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(flags)), _mm256_set1_epi32(BODY_FLAG_STATIC));
+            return _mm256_castsi256_ps(_mm256_cmpeq_epi32(staticBits, _mm256_setzero_si256()));
+        }
+
+        static Avx2Vec Select(Mask mask, Avx2Vec a, Avx2Vec b)
+        {
+            return {_mm256_blendv_ps(b.v, a.v, mask)};
+        }
+
+        static Avx2Vec Wrap(Avx2Vec a)
+        {
+            const __m256 size = _mm256_set1_ps(WORLD_SIZE);
+            const __m256 above = _mm256_and_ps(_mm256_cmp_ps(a.v, _mm256_set1_ps(WORLD_MAX), _CMP_GE_OQ), size);
+            const __m256 below = _mm256_and_ps(_mm256_cmp_ps(a.v, _mm256_set1_ps(WORLD_MIN), _CMP_LT_OQ), size);
+            return {_mm256_add_ps(_mm256_sub_ps(a.v, above), below)};
+        }
+    };
+}
+
+IntegratorKernel GetAvx2IntegratorKernel(const IntegratorType type)
+{
+    return SelectKernel<Avx2Vec>(type);
+}
+
+#else
+
+IntegratorKernel GetAvx2IntegratorKernel(const IntegratorType)
+{
+    return nullptr;
+}
+
+#endif // INTEGRATOR_X86 && __AVX2__
@@ -0,0 +1,173 @@
+#ifndef INTEGRATOR_KERNELS_H
+#define INTEGRATOR_KERNELS_H
+// IntegratorKernels.h
+// This file contains the integrators written once over a SIMD vector type V.
+// It is included by Integrator.cpp (scalar), IntegratorSse.cpp and IntegratorAvx2.cpp,
+// which are compiled with different instruction sets. Everything here has internal
+// linkage so the AVX2 copies can never be linked into code that runs on older CPUs,
+// and the kernels only work on raw arrays instead of calling inline functions from
+// other headers for the same reason.
+//
+// A vector type V provides:
+//   WIDTH                      floats per vector
+//   Mask                       result of a per-lane comparison
+//   Load(p), Store(p, v)       aligned loads and stores of WIDTH floats
+//   Set1(f)                    f in every lane
+//   operator+, -, *
+//   Movable(flags)             lanes whose body isn't BODY_FLAG_STATIC
+//   Select(mask, a, b)         a where mask is set, b elsewhere
+//   Wrap(v)                    WrapCoordinate() of every lane
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Integrator.h"
+
+// Entry points of the separately compiled instruction sets, they return null if it wasn't compiled in
+IntegratorKernel GetScalarIntegratorKernel(IntegratorType type);
+IntegratorKernel GetSseIntegratorKernel(IntegratorType type);
+IntegratorKernel GetAvx2IntegratorKernel(IntegratorType type);
+
+namespace
+{
+    // Plain float, the fallback on every CPU
+    struct ScalarVec
+    {
+        using Mask = bool;
+        static constexpr size_t WIDTH = 1;
+
+        float v;
+
+        static ScalarVec Load(const float* p)          { return {*p}; }
+        static void      Store(float* p, ScalarVec a)  { *p = a.v; }
+        static ScalarVec Set1(const float f)           { return {f}; }
+
+        friend ScalarVec operator+(ScalarVec a, ScalarVec b) { return {a.v + b.v}; }
+        friend ScalarVec operator-(ScalarVec a, ScalarVec b) { return {a.v - b.v}; }
+        friend ScalarVec operator*(ScalarVec a, ScalarVec b) { return {a.v * b.v}; }
+
+        static Mask      Movable(const uint32_t* flags)           { return (*flags & BODY_FLAG_STATIC) == 0; }
+        static ScalarVec Select(Mask mask, ScalarVec a, ScalarVec b) { return mask ? a : b; }
+
+        static ScalarVec Wrap(ScalarVec a)
+        {
+            if (a.v >= WORLD_MAX)
+            {
+                a.v -= WORLD_SIZE;
+            }
+            else if (a.v < WORLD_MIN)
+            {
+                a.v += WORLD_SIZE;
+            }
+            return a;
+        }
+    };
+
+    // Constants of one step, broadcast once
+    template <typename V>
+    struct StepConstants
+    {
+        V dt;
+        V halfDt;
+        V sixthDt;
+        V two;
+        V damping;
+    };
+
+    // a = external - damping * v, where external is gravity plus the body's own acceleration
+    template <typename V>
+    inline V Acceleration(const V external, const V velocity, const StepConstants<V>& c)
+    {
+        return external - c.damping * velocity;
+    }
+
+    // v += a(v) * dt, then x += v * dt
+    struct SemiImplicitEuler
+    {
+        template <typename V>
+        static void Advance(V& x, V& v, const V external, const StepConstants<V>& c)
+        {
+            v = v + Acceleration(external, v, c) * c.dt;
+            x = x + v * c.dt;
+        }
+    };
+
+    // Velocity Verlet. With drag the acceleration depends on the velocity, the end-of-step
+    // acceleration is taken at the half-step velocity.
+    struct VelocityVerlet
+    {
+        template <typename V>
+        static void Advance(V& x, V& v, const V external, const StepConstants<V>& c)
+        {
+            const V a0 = Acceleration(external, v, c);
+            const V halfV = v + a0 * c.halfDt;
+            x = x + halfV * c.dt;
+            v = halfV + Acceleration(external, halfV, c) * c.halfDt;
+        }
+    };
+
+    // Classic fourth order Runge-Kutta on (x, v)
+    struct RungeKutta4
+    {
+        template <typename V>
+        static void Advance(V& x, V& v, const V external, const StepConstants<V>& c)
+        {
+            const V v1 = v;
+            const V a1 = Acceleration(external, v1, c);
+            const V v2 = v + a1 * c.halfDt;
+            const V a2 = Acceleration(external, v2, c);
+            const V v3 = v + a2 * c.halfDt;
+            const V a3 = Acceleration(external, v3, c);
+            const V v4 = v + a3 * c.dt;
+            const V a4 = Acceleration(external, v4, c);
+
+            x = x + (v1 + c.two * (v2 + v3) + v4) * c.sixthDt;
+            v = v + (a1 + c.two * (a2 + a3) + a4) * c.sixthDt;
+        }
+    };
+
+    template <typename V, typename Method>
+    void IntegrateArrays(const IntegratorArrays& arrays, const float dt, const ForceField& forces)
+    {
+        const StepConstants<V> c{V::Set1(dt), V::Set1(0.5f * dt), V::Set1(dt / 6.0f), V::Set1(2.0f), V::Set1(forces.damping)};
+        const V gravityX = V::Set1(forces.gravityX);
+        const V gravityY = V::Set1(forces.gravityY);
+
+        // Vector versions run into the padding instead of handling a scalar tail
+        const size_t end = (arrays.count + V::WIDTH - 1) / V::WIDTH * V::WIDTH;
+        for (size_t i = 0; i < end; i += V::WIDTH)
+        {
+            const typename V::Mask movable = V::Movable(arrays.flags + i);
+            const V ax = arrays.ax != nullptr ? gravityX + V::Load(arrays.ax + i) : gravityX;
+            const V ay = arrays.ay != nullptr ? gravityY + V::Load(arrays.ay + i) : gravityY;
+
+            const V x0 = V::Load(arrays.x + i);
+            const V y0 = V::Load(arrays.y + i);
+            const V vx0 = V::Load(arrays.vx + i);
+            const V vy0 = V::Load(arrays.vy + i);
+
+            V x = x0, y = y0, vx = vx0, vy = vy0;
+            Method::Advance(x, vx, ax, c);
+            Method::Advance(y, vy, ay, c);
+
+            V::Store(arrays.x + i,  V::Select(movable, V::Wrap(x), x0));
+            V::Store(arrays.y + i,  V::Select(movable, V::Wrap(y), y0));
+            V::Store(arrays.vx + i, V::Select(movable, vx, vx0));
+            V::Store(arrays.vy + i, V::Select(movable, vy, vy0));
+        }
+    }
+
+    template <typename V>
+    IntegratorKernel SelectKernel(const IntegratorType type)
+    {
+        switch (type)
+        {
+            case IntegratorType::SEMI_IMPLICIT_EULER: return &IntegrateArrays<V, SemiImplicitEuler>;
+            case IntegratorType::VELOCITY_VERLET:     return &IntegrateArrays<V, VelocityVerlet>;
+            case IntegratorType::RK4:                 return &IntegrateArrays<V, RungeKutta4>;
+        }
+        return nullptr;
+    }
+}
+
+#endif // !INTEGRATOR_KERNELS_H
@@ -0,0 +1,60 @@
+#include "IntegratorKernels.h"
+
+// The integrators compiled for SSE2, which every x86-64 CPU supports.
+
+#if INTEGRATOR_X86
+
+#include <emmintrin.h>
+
+namespace
+{
+    struct SseVec
+    {
+        using Mask = __m128;
+        static constexpr size_t WIDTH = 4;
+
+        __m128 v;
+
+        static SseVec Load(const float* p)       { return {_mm_load_ps(p)}; }
+        static void   Store(float* p, SseVec a)  { _mm_store_ps(p, a.v); }
+        static SseVec Set1(const float f)        { return {_mm_set1_ps(f)}; }
+
+        friend SseVec operator+(SseVec a, SseVec b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend SseVec operator-(SseVec a, SseVec b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend SseVec operator*(SseVec a, SseVec b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+        static Mask Movable(const uint32_t* flags)
+        {
+            const __m128i staticBits = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(flags)), _mm_set1_epi32(BODY_FLAG_STATIC));
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(staticBits, _mm_setzero_si128()));
+        }
+
+        // SSE2 has no blend, combine the two sides with the mask instead
+        static SseVec Select(Mask mask, SseVec a, SseVec b)
+        {
+            return {_mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v))};
+        }
+
+        static SseVec Wrap(SseVec a)
+        {
+            const __m128 size = _mm_set1_ps(WORLD_SIZE);
+            const __m128 above = _mm_and_ps(_mm_cmpge_ps(a.v, _mm_set1_ps(WORLD_MAX)), size);
+            const __m128 below = _mm_and_ps(_mm_cmplt_ps(a.v, _mm_set1_ps(WORLD_MIN)), size);
+            return {_mm_add_ps(_mm_sub_ps(a.v, above), below)};
+        }
+    };
+}
+
+IntegratorKernel GetSseIntegratorKernel(const IntegratorType type)
+{
+    return SelectKernel<SseVec>(type);
+}
+
+#else
+
+IntegratorKernel GetSseIntegratorKernel(const IntegratorType)
+{
+    return nullptr;
+}
+
+#endif // INTEGRATOR_X86
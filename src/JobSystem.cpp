@@ -0,0 +1,397 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+// Which JobSystem the calling thread runs jobs for, and its index in it
+struct JobThreadIndex
+{
+    uint64_t systemId = 0;
+    size_t   index = 0;
+};
+
+static thread_local JobThreadIndex t_jobThread;
+static std::atomic<uint64_t> s_nextSystemId{1};
+
+//===============================================================
+// WorkStealingDeque
+// The paper's fences are folded into the neighbouring atomics
+// (a release store of bottom, sequentially consistent accesses
+// where it needs a full fence), which is what thread sanitizers
+// understand.
+//===============================================================
+bool WorkStealingDeque::Push(Job* job)
+{
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY)
+    {
+        return false;
+    }
+
+    m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+    // Claim the bottom job first, then see whether a thief got to it
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_seq_cst);
+
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // The last job, race the thieves for it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+    int64_t top = m_top.load(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+//===============================================================
+// JobSystem
+//===============================================================
+JobSystem::JobSystem(const unsigned int threadCount)
+    : m_threadCount(threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount),
+      m_threads(std::make_unique<ThreadData[]>(m_threadCount)),
+      m_systemId(s_nextSystemId.fetch_add(1, std::memory_order_relaxed)),
+      m_statsStartTicks(Timer::Ticks())
+{
+    for (unsigned int i = 0; i < m_threadCount; ++i)
+    {
+        m_threads[i].jobs = std::make_unique<Job[]>(JOBS_PER_THREAD);
+        m_threads[i].randomState = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+
+    t_jobThread = JobThreadIndex{m_systemId, 0};
+    m_workers.reserve(m_threadCount - 1);
+    for (unsigned int i = 1; i < m_threadCount; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    if (t_jobThread.systemId == m_systemId)
+    {
+        t_jobThread = JobThreadIndex{};
+    }
+}
+
+size_t JobSystem::ThreadIndex() const
+{
+    return (t_jobThread.systemId == m_systemId) ? t_jobThread.index : 0;
+}
+
+Job& JobSystem::AllocateJob()
+{
+    ThreadData& self = m_threads[ThreadIndex()];
+
+    // Jobs still in flight are skipped rather than waited for: one of them may be the job running further up
+    // this thread's stack, which can't finish before this returns. Only if the whole ring is in flight, help
+    // run jobs until one is free.
+    Backoff backoff;
+    while (true)
+    {
+        for (size_t probe = 0; probe < JOBS_PER_THREAD; ++probe)
+        {
+            Job& job = self.jobs[self.nextJob];
+            self.nextJob = (self.nextJob + 1) % JOBS_PER_THREAD;
+            if (!job.inUse.load(std::memory_order_acquire))
+            {
+                job.inUse.store(true, std::memory_order_relaxed);
+                job.dependency = nullptr;
+                return job;
+            }
+        }
+
+        if (Job* other = FindJob(self))
+        {
+            RunJobs(self, other, [] { return true; }); // Just the one, timed and counted like any other
+        }
+        else
+        {
+            backoff.Pause();
+        }
+    }
+}
+
+void JobSystem::Enqueue(Job& job)
+{
+    ThreadData& self = m_threads[ThreadIndex()];
+    if (!self.deque.Push(&job))
+    {
+        RunJobs(self, &job, [] { return true; });
+        return;
+    }
+
+    // Pairs with the sleeping worker, which counts itself before checking m_queuedJobs
+    m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+void JobSystem::EnqueueAfter(Job& job, const JobCounter& dependency)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        if (dependency.m_pending.load(std::memory_order_acquire) != 0)
+        {
+            job.dependency = &dependency;
+            m_parkedJobs.push_back(&job);
+            return;
+        }
+    }
+    Enqueue(job);
+}
+
+void JobSystem::Execute(Job& job)
+{
+    job.function(*this, job);
+
+    // The job may be reused as soon as it's marked free, so take what's still needed first
+    JobCounter& counter = *job.counter;
+    job.inUse.store(false, std::memory_order_release);
+
+    // Counting down to anything but zero doesn't need the lock
+    uint32_t pending = counter.m_pending.load(std::memory_order_relaxed);
+    while (pending > 1)
+    {
+        if (counter.m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    // This looks like the last job of the counter. Once it's zero a waiter may destroy it, so only its address is used after.
+    std::vector<Job*> released;
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            for (size_t i = 0; i < m_parkedJobs.size();)
+            {
+                if (m_parkedJobs[i]->dependency == &counter)
+                {
+                    released.push_back(m_parkedJobs[i]);
+                    m_parkedJobs[i] = m_parkedJobs.back();
+                    m_parkedJobs.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    // Outside the lock, Enqueue may run a job itself
+    for (Job* ready : released)
+    {
+        Enqueue(*ready);
+    }
+}
+
+Job* JobSystem::FindJob(ThreadData& self)
+{
+    if (Job* job = self.deque.Pop())
+    {
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    // Start at a random thread, so thieves don't all go after the same one
+    self.randomState ^= self.randomState << 13;
+    self.randomState ^= self.randomState >> 7;
+    self.randomState ^= self.randomState << 17;
+    const size_t selfIndex = static_cast<size_t>(&self - m_threads.get());
+    const size_t start = static_cast<size_t>(self.randomState % m_threadCount);
+    for (size_t i = 0; i < m_threadCount; ++i)
+    {
+        const size_t victim = (start + i) % m_threadCount;
+        if (victim == selfIndex)
+        {
+            continue;
+        }
+
+        if (Job* job = m_threads[victim].deque.Steal())
+        {
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            self.steals.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Done>
+void JobSystem::RunJobs(ThreadData& self, Job* job, Done&& done)
+{
+    // A job that waits runs jobs inside the stretch its own thread is already timing
+    if (self.busy)
+    {
+        do
+        {
+            Execute(*job);
+            self.jobsRun.fetch_add(1, std::memory_order_relaxed);
+        } while (!done() && (job = FindJob(self)) != nullptr);
+        return;
+    }
+
+    PROFILE_SCOPE("Jobs");
+    self.busy = true;
+    self.busySince.store(Timer::Ticks(), std::memory_order_relaxed);
+    uint64_t jobsRun = 0;
+    do
+    {
+        Execute(*job);
+        ++jobsRun;
+    } while (!done() && (job = FindJob(self)) != nullptr);
+
+    // GetStats may have taken the start of the stretch into its window already and moved busySince up to its end
+    const uint64_t beginTicks = self.busySince.exchange(0, std::memory_order_relaxed);
+    self.busyTicks.fetch_add(Timer::Ticks() - beginTicks, std::memory_order_relaxed);
+    self.jobsRun.fetch_add(jobsRun, std::memory_order_relaxed);
+    self.busy = false;
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    ThreadData& self = m_threads[ThreadIndex()];
+    Backoff backoff;
+    while (!counter.IsDone())
+    {
+        if (Job* job = FindJob(self))
+        {
+            RunJobs(self, job, [&] { return counter.IsDone(); });
+            backoff.Reset();
+        }
+        else if (backoff.IsSleeping())
+        {
+            // The jobs left are running on other threads, which is never long enough to sleep for
+            std::this_thread::yield();
+        }
+        else
+        {
+            backoff.Pause();
+        }
+    }
+}
+
+void JobSystem::WorkerLoop(const size_t index)
+{
+    t_jobThread = JobThreadIndex{m_systemId, index};
+    ThreadData& self = m_threads[index];
+
+    while (true)
+    {
+        // Spin and yield for a while in case more jobs follow right away, then sleep until one is queued
+        Job* job = FindJob(self);
+        Backoff backoff;
+        while (job == nullptr && !backoff.IsSleeping())
+        {
+            backoff.Pause();
+            job = FindJob(self);
+        }
+
+        if (job != nullptr)
+        {
+            RunJobs(self, job, [] { return false; });
+            continue;
+        }
+
+        m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        bool stop = false;
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [&] { return m_stop || m_queuedJobs.load(std::memory_order_seq_cst) > 0; });
+            stop = m_stop;
+        }
+        m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        if (stop)
+        {
+            return;
+        }
+    }
+}
+
+std::vector<JobThreadStats> JobSystem::GetStats()
+{
+    const uint64_t nowTicks = Timer::Ticks();
+    const double elapsedNs = Timer::TicksToNanoseconds(nowTicks - m_statsStartTicks);
+    m_statsStartTicks = nowTicks;
+
+    std::vector<JobThreadStats> stats(m_threadCount);
+    for (unsigned int i = 0; i < m_threadCount; ++i)
+    {
+        // A stretch still running counts up to now in this window, and from now in the next one
+        uint64_t openTicks = 0;
+        uint64_t since = m_threads[i].busySince.load(std::memory_order_relaxed);
+        if (since != 0 && m_threads[i].busySince.compare_exchange_strong(since, nowTicks, std::memory_order_relaxed))
+        {
+            openTicks = nowTicks - since;
+        }
+
+        // A stretch ending while this runs may still land its ticks in the next window, so keep within 100%
+        const uint64_t busyTicks = m_threads[i].busyTicks.exchange(0, std::memory_order_relaxed) + openTicks;
+        stats[i].utilization = (elapsedNs > 0.0) ? std::min(Timer::TicksToNanoseconds(busyTicks) / elapsedNs, 1.0) : 0.0;
+        stats[i].jobs = m_threads[i].jobsRun.exchange(0, std::memory_order_relaxed);
+        stats[i].steals = m_threads[i].steals.exchange(0, std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void LogJobStats(const std::vector<JobThreadStats>& stats)
+{
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        LOG(LogLevel::INFO, "Job thread {}: {:.1f}% busy, {} jobs, {} stolen", i, 100.0 * stats[i].utilization, stats[i].jobs, stats[i].steals);
+    }
+}
@@ -0,0 +1,264 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+// JobSystem.h
+// This file contains a work-stealing job system.
+// Every thread that runs jobs (the workers and the thread that created the JobSystem)
+// owns a Chase-Lev deque: it pushes and pops jobs at the bottom without contention,
+// while idle threads steal the oldest jobs from the top. Each job counts down a
+// JobCounter when it finishes. Waiting on a counter runs other jobs until it reaches
+// zero, so the main thread (or a job waiting on jobs of its own) helps instead of
+// blocking. A job can be scheduled to depend on a counter; it is parked until that
+// counter reaches zero and then pushed by the job that got it there, which is how job
+// graphs are built.
+// ParallelFor covers an index range with jobs that split themselves in half until they
+// reach the grain size, so only a handful of jobs exist at once however long the range.
+// Every thread measures the time it spends running jobs with Timer, and records each
+// busy stretch as a PROFILE_SCOPE, so utilization shows up in traces and in GetStats().
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ThreadUtils.h"
+
+class JobSystem;
+
+// Number of scheduled jobs that haven't finished yet
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending{0};
+};
+
+struct alignas(CACHE_LINE_SIZE) Job
+{
+    static constexpr size_t DATA_SIZE = 64;
+
+    void (*function)(JobSystem& jobs, Job& job) = nullptr;
+    JobCounter*       counter = nullptr;
+    const JobCounter* dependency = nullptr; // Counter the job is parked on
+    std::atomic<bool> inUse{false};         // Set from allocation until the job has run
+    alignas(std::max_align_t) unsigned char data[DATA_SIZE]; // The callable, stored in place
+};
+
+// Bounded Chase-Lev deque of jobs ("Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013).
+// Only the owning thread may Push and Pop, any thread may Steal.
+class WorkStealingDeque
+{
+public:
+    static constexpr int64_t CAPACITY = 4096;
+
+    // Returns false if the deque is full
+    bool Push(Job* job);
+
+    // Newest job, or nullptr if the deque is empty
+    Job* Pop();
+
+    // Oldest job, or nullptr if the deque is empty or another thread took it first
+    Job* Steal();
+
+    bool Empty() const { return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed); }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_bottom{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<Job*>    m_jobs[CAPACITY] = {};
+};
+
+// How one thread spent the time since the last GetStats call
+struct JobThreadStats
+{
+    double   utilization = 0.0; // Fraction of the time spent running jobs
+    uint64_t jobs = 0;
+    uint64_t steals = 0;        // Jobs taken from other threads
+};
+
+// Log one line per thread with its share of the time spent running jobs
+void LogJobStats(const std::vector<JobThreadStats>& stats);
+
+class JobSystem
+{
+public:
+    // threadCount includes the calling thread, 0 uses every hardware thread
+    explicit JobSystem(unsigned int threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Run function() as a job counted by counter. If dependency is given, the job only starts once that
+    // counter has reached zero; it must not gain new jobs until then. function is stored in the job, so it
+    // must be trivially copyable and small (capture by reference). Call from the thread that created the
+    // JobSystem or from a job.
+    template <typename Function>
+    void Schedule(JobCounter& counter, Function&& function, const JobCounter* dependency = nullptr);
+
+    // Run jobs until counter reaches zero
+    void Wait(const JobCounter& counter);
+
+    // Call function(begin, end) for chunks of at most grainSize that cover [0, count), and return when every
+    // chunk has run. Chunk boundaries are multiples of grainSize. Call from the creating thread or from a job.
+    template <typename Function>
+    void ParallelFor(size_t count, size_t grainSize, Function&& function);
+
+    // Threads that run jobs, including the creating thread
+    unsigned int GetThreadCount() const { return m_threadCount; }
+
+    // Per thread statistics since the last call (the creating thread first), and start counting again
+    std::vector<JobThreadStats> GetStats();
+
+private:
+    static constexpr size_t JOBS_PER_THREAD = 4096;
+
+    // Everything a thread owns, on its own cache lines
+    struct alignas(CACHE_LINE_SIZE) ThreadData
+    {
+        WorkStealingDeque      deque;
+        std::unique_ptr<Job[]> jobs;         // Ring of jobs this thread allocates from
+        size_t                 nextJob = 0;
+        bool                   busy = false; // In a busy stretch, so nested waits aren't timed twice
+        std::atomic<uint64_t>  busyTicks{0}; // Added to by the owner, taken by GetStats
+        std::atomic<uint64_t>  busySince{0}; // Start of the busy stretch running now, 0 when idle. GetStats moves it up.
+        std::atomic<uint64_t>  jobsRun{0};
+        std::atomic<uint64_t>  steals{0};
+        uint64_t               randomState = 0;
+    };
+
+    // A range of a ParallelFor that splits off its upper half until it is no larger than the grain
+    template <typename Function>
+    struct RangeJob
+    {
+        const Function* function;
+        size_t          begin;
+        size_t          end;
+        size_t          grainSize;
+
+        void operator()(JobSystem& jobs, JobCounter& counter) const;
+    };
+
+    unsigned int                  m_threadCount;
+    std::unique_ptr<ThreadData[]> m_threads;
+    std::vector<std::thread>      m_workers;
+    const uint64_t                m_systemId;  // Tells JobSystems apart in the threads' thread_local index
+    uint64_t                      m_statsStartTicks;
+
+    // Jobs waiting for their dependency. The only transition of a counter to zero happens under the lock,
+    // so a job is never parked on a counter that just finished, and the counter isn't touched once it's zero.
+    std::mutex                    m_parkMutex;
+    std::vector<Job*>             m_parkedJobs;
+
+    std::mutex                    m_sleepMutex;
+    std::condition_variable       m_wake;
+    bool                          m_stop = false; // Guarded by m_sleepMutex
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t>  m_queuedJobs{0};     // Jobs sitting in deques, for sleeping workers
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_sleepingWorkers{0};
+
+    // Index of the calling thread's ThreadData, 0 for the creating thread
+    size_t ThreadIndex() const;
+
+    // Take a free job from the calling thread's ring, running other jobs while every one is in use
+    Job& AllocateJob();
+
+    // Push a job that is ready to run, or run it straight away if the deque is full
+    void Enqueue(Job& job);
+
+    // Park job until dependency reaches zero, or enqueue it if it already has
+    void EnqueueAfter(Job& job, const JobCounter& dependency);
+
+    // Run a job, count down its counter and release the jobs parked on the counter if it reached zero
+    void Execute(Job& job);
+
+    // Pop a job from the calling thread's deque, or steal one from another thread
+    Job* FindJob(ThreadData& self);
+
+    // Run the jobs that can be found, until there are none or done() is true, timing it as one busy stretch
+    template <typename Done>
+    void RunJobs(ThreadData& self, Job* job, Done&& done);
+
+    void WorkerLoop(size_t index);
+};
+
+template <typename Function>
+void JobSystem::Schedule(JobCounter& counter, Function&& function, const JobCounter* dependency)
+{
+    using Stored = std::remove_cvref_t<Function>;
+    static_assert(std::is_trivially_copyable_v<Stored> && sizeof(Stored) <= Job::DATA_SIZE && alignof(Stored) <= alignof(std::max_align_t),
+                  "Jobs hold their callable in place, capture by reference");
+
+    Job& job = AllocateJob();
+    new (job.data) Stored(function);
+    job.function = [](JobSystem&, Job& self) { (*std::launder(reinterpret_cast<Stored*>(self.data)))(); };
+    job.counter = &counter;
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency != nullptr)
+    {
+        EnqueueAfter(job, *dependency);
+    }
+    else
+    {
+        Enqueue(job);
+    }
+}
+
+template <typename Function>
+void JobSystem::RangeJob<Function>::operator()(JobSystem& jobs, JobCounter& counter) const
+{
+    size_t rangeEnd = end;
+    while (rangeEnd - begin > grainSize)
+    {
+        // Split on a grain boundary, so chunks line up the same however the range was stolen
+        const size_t chunks = (rangeEnd - begin + grainSize - 1) / grainSize;
+        const size_t middle = begin + (chunks / 2) * grainSize;
+
+        Job& job = jobs.AllocateJob();
+        new (job.data) RangeJob{function, middle, rangeEnd, grainSize};
+        job.function = [](JobSystem& owner, Job& self)
+        {
+            std::launder(reinterpret_cast<RangeJob*>(self.data))->operator()(owner, *self.counter);
+        };
+        job.counter = &counter;
+        counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+        jobs.Enqueue(job);
+
+        rangeEnd = middle;
+    }
+    (*function)(begin, rangeEnd);
+}
+
+template <typename Function>
+void JobSystem::ParallelFor(const size_t count, size_t grainSize, Function&& function)
+{
+    grainSize = (grainSize == 0) ? 1 : grainSize;
+    if (count <= grainSize || m_threadCount == 1)
+    {
+        if (count > 0)
+        {
+            function(size_t{0}, count);
+        }
+        return;
+    }
+
+    using Stored = std::remove_reference_t<Function>;
+    JobCounter counter;
+    RangeJob<Stored>{&function, 0, count, grainSize}(*this, counter);
+    Wait(counter);
+}
+
+#endif // !JOB_SYSTEM_H
@@ -0,0 +1,182 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+// LogRecord.h
+// This file contains the fixed-size record that carries a log message from the
+// thread calling LOG to the logging thread.
+// A LOG call site only stores a pointer to its static LogSite (which acts as the
+// compile-time format string ID) and the raw bytes of its arguments. The logging
+// thread decodes the arguments and does all of the std::format work, so the calling
+// thread never formats and never allocates.
+// Argument types that can't be captured as raw bytes, or messages whose arguments
+// don't fit in the record, fall back to formatting on the calling thread.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "LoggerHelper.h"
+
+// Set to 0 to always format on the calling thread (useful when comparing the two modes)
+#ifndef LOG_DEFERRED_FORMATTING
+    #define LOG_DEFERRED_FORMATTING 1
+#endif
+
+// Static description of a LOG call site. Every call site owns one instance in static
+// storage, so its address identifies the format string without copying it.
+struct LogSite
+{
+    LogLevel         level;
+    unsigned int     lineNumber;
+    std::string_view sourceFile;
+    std::string_view formatString;
+};
+
+// Number of argument bytes a record can hold before falling back to formatting on the calling thread
+inline constexpr size_t LOG_RECORD_ARG_BYTES = 128;
+
+//===============================================================
+// LogArgCodec<T>
+// Describes how an argument of type T is written into a record and
+// read back on the logging thread. Arithmetic types and void
+// pointers are copied as raw bytes, strings are stored as a length
+// followed by their characters and read back as string views into
+// the record. Everything else is unsupported and gets formatted
+// on the calling thread.
+//===============================================================
+template <typename T>
+struct LogArgCodec
+{
+    static constexpr bool SUPPORTED = false;
+};
+
+template <typename T>
+    requires std::is_arithmetic_v<T> || std::is_same_v<T, void*> || std::is_same_v<T, const void*> || std::is_same_v<T, std::nullptr_t>
+struct LogArgCodec<T>
+{
+    static constexpr bool SUPPORTED = true;
+
+    static size_t Size(const T&) { return sizeof(T); }
+
+    static std::byte* Encode(std::byte* out, const T& value)
+    {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    static T Decode(const std::byte*& in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+// Shared implementation for every string-like argument
+struct LogStringArgCodec
+{
+    static constexpr bool SUPPORTED = true;
+
+    static size_t Size(const std::string_view value) { return sizeof(uint32_t) + value.size(); }
+
+    static std::byte* Encode(std::byte* out, const std::string_view value)
+    {
+        const uint32_t length = static_cast<uint32_t>(value.size());
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + sizeof(length), value.data(), length);
+        return out + sizeof(length) + length;
+    }
+
+    static std::string_view Decode(const std::byte*& in)
+    {
+        uint32_t length;
+        std::memcpy(&length, in, sizeof(length));
+        const std::string_view value(reinterpret_cast<const char*>(in + sizeof(length)), length);
+        in += sizeof(length) + length;
+        return value;
+    }
+};
+
+template <> struct LogArgCodec<const char*>      : LogStringArgCodec {};
+template <> struct LogArgCodec<char*>            : LogStringArgCodec {};
+template <> struct LogArgCodec<std::string>      : LogStringArgCodec {};
+template <> struct LogArgCodec<std::string_view> : LogStringArgCodec {};
+
+// True when every argument of a LOG call can be captured without formatting
+template <typename... Args>
+inline constexpr bool LOG_ARGS_DEFERRABLE = LOG_DEFERRED_FORMATTING && (LogArgCodec<std::decay_t<Args>>::SUPPORTED && ...);
+
+// Decode the arguments of a record and append the formatted message to out.
+// One instantiation exists per argument type list, and records point at the one they need.
+template <typename... Args>
+void FormatLogArgs(const LogSite& site, const std::byte* args, std::string& out)
+{
+    // Braced initialization guarantees the arguments are decoded left to right
+    std::tuple<decltype(LogArgCodec<Args>::Decode(args))...> values{ LogArgCodec<Args>::Decode(args)... };
+    std::apply([&](auto&... decoded)
+    {
+        std::vformat_to(std::back_inserter(out), site.formatString, std::make_format_args(decoded...));
+    }, values);
+}
+
+// Tag to select the constructor that captures raw arguments
+struct DeferredFormatTag {};
+
+// The record that travels through the logger queue
+struct LogRecord
+{
+    using FormatFunction = void (*)(const LogSite& site, const std::byte* args, std::string& out);
+
+    uint64_t        messageTime = 0;  // Timer::Ticks() when the message was logged
+    const LogSite*  site   = nullptr;
+    FormatFunction  format = nullptr; // Formats args on the logging thread, nullptr if message is already formatted
+    std::string     message;          // Only used when the message was formatted on the calling thread
+    uint32_t        argBytes = 0;
+    alignas(8) std::array<std::byte, LOG_RECORD_ARG_BYTES> args;
+
+    LogRecord() = default;
+
+    // Construct a record holding a message that was already formatted
+    LogRecord(const uint64_t time, const LogSite& logSite, std::string msg)
+        : messageTime(time), site(&logSite), message(std::move(msg))
+    {}
+
+    // Construct a record holding the raw arguments. The caller must check they fit with EncodedSize first.
+    template <typename... Args>
+    LogRecord(DeferredFormatTag, const uint64_t time, const LogSite& logSite, const Args&... values)
+        : messageTime(time), site(&logSite), format(&FormatLogArgs<std::decay_t<Args>...>)
+    {
+        std::byte* out = args.data();
+        ((out = LogArgCodec<std::decay_t<Args>>::Encode(out, values)), ...);
+        argBytes = static_cast<uint32_t>(out - args.data());
+    }
+
+    // Number of bytes the given arguments take up in a record
+    template <typename... Args>
+    static size_t EncodedSize(const Args&... values)
+    {
+        return (size_t{0} + ... + LogArgCodec<std::decay_t<Args>>::Size(values));
+    }
+
+    // Append the message text to out (formatting it now if it was deferred)
+    void AppendMessage(std::string& out) const
+    {
+        if (format != nullptr)
+        {
+            format(*site, args.data(), out);
+        }
+        else
+        {
+            out += message;
+        }
+    }
+};
+
+#endif // !LOG_RECORD_H
@@ -0,0 +1,289 @@
+#include "LogSinks.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <string>
+
+#if LOG_SINKS_POSIX
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "LoggerHelper.h"
+
+#if LOG_SINKS_POSIX
+// Write the whole buffer, retrying on partial writes and interrupts
+static void WriteAll(const LogFileHandle file, std::string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t written = ::write(file, data.data(), data.size());
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // Log immediately using the Logger class's formatting, the sink itself can't be used
+            PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+                std::format("Log sink write failed: {}", std::strerror(errno)));
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+static LogFileHandle OpenForWrite(const std::string& filepath, const bool append = true)
+{
+    const LogFileHandle file = ::open(filepath.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if (file == INVALID_LOG_FILE)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not open log file {}: {}", filepath, std::strerror(errno)));
+    }
+    return file;
+}
+
+static void CloseFile(const LogFileHandle file)
+{
+    ::close(file);
+}
+
+static size_t FileSize(const LogFileHandle file)
+{
+    struct stat fileStat;
+    return (::fstat(file, &fileStat) == 0) ? static_cast<size_t>(fileStat.st_size) : 0;
+}
+
+static LogFileHandle StandardOutput()
+{
+    return STDOUT_FILENO;
+}
+#else
+// Write the whole buffer and flush it, so a batch is out of the process like with write() on POSIX
+static void WriteAll(const LogFileHandle file, const std::string_view data)
+{
+    if (std::fwrite(data.data(), 1, data.size(), file) != data.size() || std::fflush(file) != 0)
+    {
+        // Log immediately using the Logger class's formatting, the sink itself can't be used
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Log sink write failed: {}", std::strerror(errno)));
+    }
+}
+
+static LogFileHandle OpenForWrite(const std::string& filepath, const bool append = true)
+{
+    const LogFileHandle file = std::fopen(filepath.c_str(), append ? "ab" : "wb");
+    if (file == INVALID_LOG_FILE)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not open log file {}: {}", filepath, std::strerror(errno)));
+    }
+    return file;
+}
+
+static void CloseFile(const LogFileHandle file)
+{
+    std::fclose(file);
+}
+
+static size_t FileSize(const LogFileHandle file)
+{
+    if (std::fseek(file, 0, SEEK_END) != 0)
+    {
+        return 0;
+    }
+    const long size = std::ftell(file);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+static LogFileHandle StandardOutput()
+{
+    return stdout;
+}
+#endif
+
+//===============================================================
+// ConsoleSink
+//===============================================================
+void ConsoleSink::Write(std::string_view batch)
+{
+    WriteAll(StandardOutput(), batch);
+}
+
+//===============================================================
+// FileSink
+//===============================================================
+FileSink::FileSink(const std::string& filepath, const bool append)
+    : m_file(OpenForWrite(filepath, append))
+{
+}
+
+FileSink::~FileSink()
+{
+    if (m_file != INVALID_LOG_FILE)
+    {
+        CloseFile(m_file);
+    }
+}
+
+void FileSink::Write(std::string_view batch)
+{
+    if (m_file != INVALID_LOG_FILE)
+    {
+        WriteAll(m_file, batch);
+    }
+}
+
+//===============================================================
+// RotatingFileSink
+//===============================================================
+RotatingFileSink::RotatingFileSink(const std::string& filepath, const size_t maxFileSize, const unsigned int maxFiles)
+    : m_filepath(filepath), m_maxFileSize(maxFileSize), m_maxFiles(maxFiles)
+{
+    Open();
+}
+
+RotatingFileSink::~RotatingFileSink()
+{
+    if (m_file != INVALID_LOG_FILE)
+    {
+        CloseFile(m_file);
+    }
+}
+
+void RotatingFileSink::Write(std::string_view batch)
+{
+    // Rotate between batches, so a batch is never split across two files
+    if (m_fileSize > 0 && m_fileSize + batch.size() > m_maxFileSize)
+    {
+        Rotate();
+    }
+
+    if (m_file != INVALID_LOG_FILE)
+    {
+        WriteAll(m_file, batch);
+        m_fileSize += batch.size();
+    }
+}
+
+void RotatingFileSink::Open()
+{
+    m_file = OpenForWrite(m_filepath);
+    m_fileSize = (m_file != INVALID_LOG_FILE) ? FileSize(m_file) : 0; // Continue an existing file
+}
+
+void RotatingFileSink::Rotate()
+{
+    if (m_file != INVALID_LOG_FILE)
+    {
+        CloseFile(m_file);
+    }
+
+    // Shift filepath.N-1 -> filepath.N ... filepath -> filepath.1, dropping the oldest
+    for (unsigned int i = m_maxFiles; i > 0; --i)
+    {
+        const std::string from = (i == 1) ? m_filepath : std::format("{}.{}", m_filepath, i - 1);
+        const std::string to   = std::format("{}.{}", m_filepath, i);
+        std::remove(to.c_str()); // rename won't replace an existing file everywhere
+        std::rename(from.c_str(), to.c_str()); // Missing files are expected until the rotation has filled up
+    }
+
+    Open();
+}
+
+#if LOG_SINKS_POSIX
+//===============================================================
+// MmapFileSink
+//===============================================================
+MmapFileSink::MmapFileSink(const std::string& filepath, const size_t chunkSize)
+{
+    // The mapped window has to start on a page boundary, so keep the chunk a multiple of the page size
+    const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    m_chunkSize = ((chunkSize + pageSize - 1) / pageSize) * pageSize;
+
+    m_fileDescriptor = ::open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fileDescriptor < 0)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not open log file {}: {}", filepath, std::strerror(errno)));
+        return;
+    }
+
+    MapChunk(0);
+}
+
+MmapFileSink::~MmapFileSink()
+{
+    if (m_fileDescriptor < 0)
+    {
+        return;
+    }
+
+    UnmapChunk();
+
+    // Trim the unused tail of the last chunk
+    if (::ftruncate(m_fileDescriptor, static_cast<off_t>(m_chunkOffset + m_chunkUsed)) != 0)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not trim memory mapped log file: {}", std::strerror(errno)));
+    }
+    ::close(m_fileDescriptor);
+}
+
+void MmapFileSink::Write(std::string_view batch)
+{
+    while (!batch.empty() && m_chunk != nullptr)
+    {
+        const size_t space = m_chunkSize - m_chunkUsed;
+        const size_t bytes = batch.size() < space ? batch.size() : space;
+        std::memcpy(m_chunk + m_chunkUsed, batch.data(), bytes);
+        m_chunkUsed += bytes;
+        batch.remove_prefix(bytes);
+
+        if (m_chunkUsed == m_chunkSize)
+        {
+            // Window is full, move it to the next chunk of the file
+            const uint64_t nextOffset = m_chunkOffset + m_chunkSize;
+            UnmapChunk();
+            MapChunk(nextOffset);
+        }
+    }
+}
+
+void MmapFileSink::MapChunk(const uint64_t offset)
+{
+    // Grow the file so the whole window is backed by it
+    if (::ftruncate(m_fileDescriptor, static_cast<off_t>(offset + m_chunkSize)) != 0)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not grow memory mapped log file: {}", std::strerror(errno)));
+        return;
+    }
+
+    void* mapping = ::mmap(nullptr, m_chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fileDescriptor, static_cast<off_t>(offset));
+    if (mapping == MAP_FAILED)
+    {
+        PrintMessageNow(LogLevel::ERROR, __LINE__, __FILE__,
+            std::format("Could not map log file: {}", std::strerror(errno)));
+        return;
+    }
+
+    m_chunk = static_cast<char*>(mapping);
+    m_chunkOffset = offset;
+    m_chunkUsed = 0;
+}
+
+void MmapFileSink::UnmapChunk()
+{
+    if (m_chunk != nullptr)
+    {
+        ::munmap(m_chunk, m_chunkSize);
+        m_chunk = nullptr;
+    }
+}
+#endif // LOG_SINKS_POSIX
@@ -0,0 +1,107 @@
+#ifndef LOG_SINKS_H
+#define LOG_SINKS_H
+// LogSinks.h
+// This file contains the destinations the Logger writes to.
+// The logging thread formats many messages into one contiguous batch and hands the
+// whole batch to every sink at once, so each sink issues a single write per batch
+// instead of one per message.
+// On POSIX systems the sinks write straight to file descriptors, elsewhere they go through
+// std::FILE. The memory mapped sink needs POSIX and is only available there.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define LOG_SINKS_POSIX 1
+#else
+    #define LOG_SINKS_POSIX 0
+#endif
+
+// An open log file: a file descriptor on POSIX systems, a std::FILE elsewhere
+#if LOG_SINKS_POSIX
+using LogFileHandle = int;
+inline constexpr LogFileHandle INVALID_LOG_FILE = -1;
+#else
+using LogFileHandle = std::FILE*;
+inline constexpr LogFileHandle INVALID_LOG_FILE = nullptr;
+#endif
+
+// Interface for every log destination. Only ever called from the logging thread.
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+
+    // Write a batch of complete, newline terminated messages
+    virtual void Write(std::string_view batch) = 0;
+};
+
+// Writes to stdout with one write per batch
+class ConsoleSink : public LogSink
+{
+public:
+    void Write(std::string_view batch) override;
+};
+
+// Appends to a single file with one write per batch (or starts it over when append is false)
+class FileSink : public LogSink
+{
+public:
+    FileSink(const std::string& filepath, bool append = true);
+    ~FileSink();
+
+    void Write(std::string_view batch) override;
+
+private:
+    LogFileHandle m_file = INVALID_LOG_FILE;
+};
+
+// Appends to a file and starts a new one once it grows past maxFileSize.
+// Older files are renamed filepath.1, filepath.2, ... and only maxFiles of them are kept.
+class RotatingFileSink : public LogSink
+{
+public:
+    RotatingFileSink(const std::string& filepath, size_t maxFileSize = 16 * 1024 * 1024, unsigned int maxFiles = 4);
+    ~RotatingFileSink();
+
+    void Write(std::string_view batch) override;
+
+private:
+    std::string   m_filepath;
+    size_t        m_maxFileSize;
+    unsigned int  m_maxFiles;
+    size_t        m_fileSize = 0;
+    LogFileHandle m_file = INVALID_LOG_FILE;
+
+    void Open();
+    void Rotate();
+};
+
+#if LOG_SINKS_POSIX
+// Appends to a file through a memory mapped window, so a write is a memcpy instead of a syscall.
+// The file is grown and remapped one chunk at a time, and trimmed to the bytes written when closed.
+// Meant for long simulation runs that log heavily.
+class MmapFileSink : public LogSink
+{
+public:
+    MmapFileSink(const std::string& filepath, size_t chunkSize = 16 * 1024 * 1024);
+    ~MmapFileSink();
+
+    void Write(std::string_view batch) override;
+
+private:
+    int      m_fileDescriptor = -1;
+    size_t   m_chunkSize;
+    char*    m_chunk = nullptr;  // Currently mapped window of the file
+    uint64_t m_chunkOffset = 0;  // File offset of the mapped window
+    size_t   m_chunkUsed = 0;    // Bytes written into the mapped window
+
+    void MapChunk(uint64_t offset);
+    void UnmapChunk();
+};
+#endif // LOG_SINKS_POSIX
+
+#endif // !LOG_SINKS_H
@@ -0,0 +1,229 @@
+#ifndef LOG_THREAD_BUFFER_H
+#define LOG_THREAD_BUFFER_H
+// LogThreadBuffer.h
+// This file contains the buffer each logging thread writes its records into.
+// The buffer is a chain of single-producer/single-consumer segments: the owning
+// thread pushes records and the logging thread pops them. What happens when the
+// buffer is full depends on the Logger's OverflowPolicy:
+//   DROP_NEWEST      - the new record is dropped
+//   OVERWRITE_OLDEST - the producer discards the oldest record to make room
+//   GROW             - the producer links a new segment, up to a maximum number of segments
+//   BLOCK            - TryPush fails and the Logger waits for space
+// Every overflow is counted so the logging thread can report it.
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+#include "CircularBuffer.h"
+#include "LogRecord.h"
+
+// Totals of the overflow counters of one or more buffers
+struct LogOverflowCounts
+{
+    size_t dropped     = 0; // Messages that were not logged
+    size_t overwritten = 0; // Queued messages discarded to make room for newer ones
+    size_t blocked     = 0; // Messages whose thread had to wait for space
+
+    LogOverflowCounts& operator+=(const LogOverflowCounts& other)
+    {
+        dropped     += other.dropped;
+        overwritten += other.overwritten;
+        blocked     += other.blocked;
+        return *this;
+    }
+};
+
+class LogThreadBuffer
+{
+public:
+    static constexpr size_t SEGMENT_CAPACITY = 4096; // Records per segment
+
+    LogThreadBuffer(const OverflowPolicy policy, const size_t maxSegments)
+        : m_policy(policy),
+          m_maxSegments((policy == OverflowPolicy::GROW && maxSegments > 1) ? maxSegments : 1)
+    {
+        m_writeSegment = new Segment();
+        m_readSegment = m_writeSegment;
+    }
+
+    ~LogThreadBuffer()
+    {
+        Segment* segment = m_readSegment;
+        while (segment != nullptr)
+        {
+            Segment* next = segment->next.load(std::memory_order_acquire);
+            delete segment;
+            segment = next;
+        }
+    }
+
+    LogThreadBuffer(const LogThreadBuffer&) = delete;
+    LogThreadBuffer& operator=(const LogThreadBuffer&) = delete;
+
+    //===============================================================
+    // Producer side, only called by the owning thread
+    //===============================================================
+
+    // Construct a record in the buffer, applying the overflow policy if it is full.
+    // Returns false if the record was not added.
+    template <typename... Args>
+    bool TryPush(Args&&... args)
+    {
+        // Arguments are only consumed when a record is actually constructed, so they can be forwarded again below
+        if (m_writeSegment->queue.emplace(std::forward<Args>(args)...))
+        {
+            return true;
+        }
+
+        switch (m_policy)
+        {
+            case OverflowPolicy::OVERWRITE_OLDEST:
+            {
+                // Act as the consumer for a moment to discard the oldest record. The logging thread only
+                // holds the lock while it merges one batch, so this waits at most that long.
+                std::lock_guard consumeLock(m_consumeMutex);
+                if (m_writeSegment->queue.front() != nullptr)
+                {
+                    m_writeSegment->queue.pop();
+                    Increment(m_overwrittenMessages);
+                }
+                return m_writeSegment->queue.emplace(std::forward<Args>(args)...);
+            }
+
+            case OverflowPolicy::GROW:
+                if (m_segmentCount.load(std::memory_order_relaxed) < m_maxSegments)
+                {
+                    // Fill the new segment before linking it, the logging thread switches over once the old one is empty
+                    Segment* segment = new Segment();
+                    segment->queue.emplace(std::forward<Args>(args)...);
+                    m_segmentCount.fetch_add(1, std::memory_order_relaxed);
+                    m_writeSegment->next.store(segment, std::memory_order_release);
+                    m_writeSegment = segment;
+                    return true;
+                }
+                return false;
+
+            case OverflowPolicy::BLOCK:
+            case OverflowPolicy::DROP_NEWEST:
+            default:
+                return false;
+        }
+    }
+
+    // Count a record that was not added
+    void CountDropped() { Increment(m_droppedMessages); }
+
+    // Count a record that had to wait for space (OverflowPolicy::BLOCK)
+    void CountBlocked() { Increment(m_blockedMessages); }
+
+    // Mark the buffer as abandoned by its thread. Nothing is pushed after this.
+    void Retire() { m_retired.store(true, std::memory_order_release); }
+
+    //===============================================================
+    // Consumer side, only called by the logging thread
+    //===============================================================
+
+    // Oldest record, or nullptr if the buffer is empty
+    LogRecord* Front()
+    {
+        while (true)
+        {
+            if (LogRecord* record = m_readSegment->queue.front())
+            {
+                return record;
+            }
+
+            Segment* next = m_readSegment->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                return nullptr;
+            }
+
+            // The producer has moved on to the next segment. Everything it pushed here before linking
+            // that segment is visible now, so check once more before freeing this one.
+            if (LogRecord* record = m_readSegment->queue.front())
+            {
+                return record;
+            }
+            delete m_readSegment;
+            m_readSegment = next;
+            m_segmentCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Remove the record returned by Front()
+    void Pop() { m_readSegment->queue.pop(); }
+
+    // Hold off producers that discard the oldest record while the logging thread reads from the buffer
+    void BeginConsume()
+    {
+        if (m_policy == OverflowPolicy::OVERWRITE_OLDEST)
+        {
+            m_consumeMutex.lock();
+        }
+    }
+
+    void EndConsume()
+    {
+        if (m_policy == OverflowPolicy::OVERWRITE_OLDEST)
+        {
+            m_consumeMutex.unlock();
+        }
+    }
+
+    // Number of queued records, approximate while the producer is active
+    size_t SizeApprox() const
+    {
+        size_t size = 0;
+        for (const Segment* segment = m_readSegment; segment != nullptr; segment = segment->next.load(std::memory_order_acquire))
+        {
+            size += segment->queue.size();
+        }
+        return size;
+    }
+
+    // True once the owning thread has exited. Check this before Front() so every record it pushed is visible.
+    bool IsRetired() const { return m_retired.load(std::memory_order_acquire); }
+
+    //===============================================================
+    // Counters, readable from any thread
+    //===============================================================
+    size_t GetDroppedCount()     const { return m_droppedMessages.load(std::memory_order_relaxed); }
+    size_t GetOverwrittenCount() const { return m_overwrittenMessages.load(std::memory_order_relaxed); }
+    size_t GetBlockedCount()     const { return m_blockedMessages.load(std::memory_order_relaxed); }
+
+    LogOverflowCounts GetOverflowCounts() const
+    {
+        return { GetDroppedCount(), GetOverwrittenCount(), GetBlockedCount() };
+    }
+
+private:
+    struct Segment
+    {
+        FixedCircularBuffer<LogRecord, SEGMENT_CAPACITY, BufferThreading::SPSC> queue;
+        std::atomic<Segment*> next = nullptr;
+    };
+
+    // Only the owning thread writes these counters, so a plain load and store is enough
+    static void Increment(std::atomic<size_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    const OverflowPolicy m_policy;
+    const size_t         m_maxSegments;
+
+    Segment*             m_writeSegment; // Only touched by the producer
+    Segment*             m_readSegment;  // Only touched by the consumer
+    std::atomic<size_t>  m_segmentCount = 1;
+    std::mutex           m_consumeMutex; // Only used with OverflowPolicy::OVERWRITE_OLDEST
+
+    std::atomic<size_t>  m_droppedMessages = 0;
+    std::atomic<size_t>  m_overwrittenMessages = 0;
+    std::atomic<size_t>  m_blockedMessages = 0;
+    std::atomic<bool>    m_retired = false;
+};
+
+#endif // !LOG_THREAD_BUFFER_H
@@ -1,7 +1,7 @@
 #include "Logger.h"
+#include "Profiler.h"
 
 #include <thread>
-#include <mutex>
 #include <print> 
 #include <format>
 #include <string_view>
@@ -10,9 +10,18 @@
 #include <ctime>
 #include <iomanip>
 
-Logger::Logger()
+// Source of unique logger IDs, 0 is reserved for threads that haven't registered yet
+static std::atomic<uint64_t> s_nextLoggerId = 1;
+
+Logger::Logger(const OverflowPolicy overflowPolicy, const size_t maxThreadBufferMessages)
+    : m_loggerId(s_nextLoggerId.fetch_add(1, std::memory_order_relaxed)),
+      m_overflowPolicy(overflowPolicy),
+      m_maxThreadBufferSegments((maxThreadBufferMessages + THREAD_BUFFER_CAPACITY - 1) / THREAD_BUFFER_CAPACITY)
 {
     std::ios_base::sync_with_stdio(false); // Disable synchronization with C-style I/O for performance
+    m_sinks.push_back(std::make_unique<ConsoleSink>());
+    m_writeBatch.reserve(WRITE_BATCH_BYTES + 4096);
+    m_lastOverflowReport = Timer::Ticks();
     m_logThread = std::thread(&Logger::RunLogger, this);
 }
 
@@ -21,12 +30,11 @@ Logger::~Logger()
     LOG(LogLevel::WARNING, "Finishing Logging...");
     if (m_debugLogger)
     {
-        LOG(LogLevel::DEBUG, "Max queue size during logging: {}", m_queueMaxSize);
+        LOG(LogLevel::DEBUG, "Max queue size during logging: {}", m_queueMaxSize.load());
     }
 
-    // Tell the logging thread to finish up and update condition variable
+    // Tell the logging thread to finish up
     m_finishLogging = true;
-    m_cv.notify_one();
 
     // Wait for the thread to finish logging
     m_logThread.join();
@@ -48,42 +56,250 @@ void Logger::RunLogger()
     const std::string timeString = GetTimeString(now); 
 
     // Output initial message indicating the logger has started
-    std::println("----------------------------------------------------------------------------------------");
-    PrintMessage(timeString, LogLevel::INFO, __LINE__, __FILE__, dateString);
-    std::println("----------------------------------------------------------------------------------------");
+    const std::string_view separator = "----------------------------------------------------------------------------------------\n";
+    m_writeBatch += separator;
+    FormatMessage(m_writeBatch, timeString, LogLevel::INFO, __LINE__, __FILE__, dateString);
+    m_writeBatch += separator;
 
-    // Run loop until no more messages to log and the class is being destroyed
-    while (!m_queue.empty() || !m_finishLogging)
+    // Run loop until the class is being destroyed, then drain whatever is left
+    Backoff idleBackoff;
+    while (true)
     {
-        // Mutex lock and wait
-        std::unique_lock queueReadLock(m_queueMutex);
-        // Wait for a message to be available in the queue or for the logging to finish
-        m_cv.wait(queueReadLock, [this] {return !m_queue.empty() || m_finishLogging;});
+        // Any flush requested before this point is covered once the buffers have been emptied
+        const uint64_t flushRequest = m_flushRequested.load(std::memory_order_acquire);
 
-        // If the queue is empty and we're not finishing, wait for the condition variable
-        if (m_queue.empty())
+        if (DrainQueue() > 0)
         {
+            idleBackoff.Reset();
             continue;
         }
 
-        if (m_queue.size() > m_queueMaxSize)
+        // Caught up, so write out whatever has been collected
+        WriteBatch();
+        m_flushCompleted.store(flushRequest, std::memory_order_release);
+
+        if (m_finishLogging)
         {
-            m_queueMaxSize = m_queue.size();
+            // Everything logged before the flag was set is visible now, so print it and stop
+            while (DrainQueue() > 0)
+            {
+            }
+            ReportOverflows();
+            break;
         }
 
-        // Get the message and remove it from the queue
-        const messageType msg = std::move(m_queue.front());
-        m_queue.pop();
-        // Since we're done messing with the queue, unlock the mutex
-        queueReadLock.unlock();
+        // Nothing to do, spin then yield then sleep until messages show up
+        idleBackoff.Pause();
+    }
+
+    // End the logging with two empty lines
+    m_writeBatch += "\n\n";
+    WriteBatch();
+}
+
+void Logger::AddSink(std::unique_ptr<LogSink> sink)
+{
+    std::lock_guard sinksLock(m_sinksMutex);
+    m_sinks.push_back(std::move(sink));
+}
+
+void Logger::ClearSinks()
+{
+    std::lock_guard sinksLock(m_sinksMutex);
+    m_sinks.clear();
+}
 
-        // Get the time of day in hh:mm:ss format
-        const std::string timeString = GetTimeString(msg.messageTime);
+void Logger::Flush()
+{
+    const uint64_t flushRequest = m_flushRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+    Backoff flushBackoff;
+    while (m_flushCompleted.load(std::memory_order_acquire) < flushRequest && !m_finishLogging)
+    {
+        flushBackoff.Pause();
+    }
+}
 
-        // Output the message
-        PrintMessage(timeString, msg.level, msg.lineNumber, msg.sourceFile, msg.message);
+void Logger::WriteBatch()
+{
+    if (m_writeBatch.empty())
+    {
+        return;
     }
 
-    // End the logging with two empty lines
-    std::print("\n\n");
+    {
+        PROFILE_SCOPE("LogWrite");
+        std::lock_guard sinksLock(m_sinksMutex);
+        for (const std::unique_ptr<LogSink>& sink : m_sinks)
+        {
+            sink->Write(m_writeBatch);
+        }
+    }
+    m_writeBatch.clear();
+}
+
+size_t Logger::GetDroppedMessageCount()
+{
+    const LogOverflowCounts counts = GetOverflowCounts();
+    return counts.dropped + counts.overwritten;
+}
+
+LogOverflowCounts Logger::GetOverflowCounts()
+{
+    std::lock_guard buffersLock(m_buffersMutex);
+    LogOverflowCounts counts = m_retiredOverflowCounts;
+    for (const std::shared_ptr<LogThreadBuffer>& buffer : m_buffers)
+    {
+        counts += buffer->GetOverflowCounts();
+    }
+    return counts;
+}
+
+void Logger::RegisterThread(ThreadBufferHandle& handle)
+{
+    std::shared_ptr<LogThreadBuffer> buffer = std::make_shared<LogThreadBuffer>(m_overflowPolicy, m_maxThreadBufferSegments);
+    {
+        std::lock_guard buffersLock(m_buffersMutex);
+        m_buffers.push_back(buffer);
+        m_buffersVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    // A handle left over from a previous logger gives its old buffer up
+    if (handle.buffer)
+    {
+        handle.buffer->Retire();
+    }
+    handle.buffer = std::move(buffer);
+    handle.loggerId = m_loggerId;
+}
+
+size_t Logger::DrainQueue()
+{
+    UpdateBuffers();
+
+    // Find the oldest record of every thread buffer
+    m_mergeHeads.resize(m_pollBuffers.size());
+    for (size_t i = 0; i < m_pollBuffers.size(); ++i)
+    {
+        LogThreadBuffer& buffer = *m_pollBuffers[i];
+        buffer.BeginConsume();
+        m_mergeHeads[i] = buffer.Front();
+
+        const size_t queueSize = buffer.SizeApprox();
+        if (queueSize > m_queueMaxSize.load(std::memory_order_relaxed))
+        {
+            m_queueMaxSize.store(queueSize, std::memory_order_relaxed);
+        }
+    }
+
+    // Repeatedly print whichever buffer has the oldest record, so the output stays in time order across threads
+    size_t printed = 0;
+    while (printed < BATCH_SIZE)
+    {
+        size_t oldest = m_mergeHeads.size();
+        for (size_t i = 0; i < m_mergeHeads.size(); ++i)
+        {
+            if (m_mergeHeads[i] != nullptr && 
+                (oldest == m_mergeHeads.size() || m_mergeHeads[i]->messageTime < m_mergeHeads[oldest]->messageTime))
+            {
+                oldest = i;
+            }
+        }
+
+        if (oldest == m_mergeHeads.size())
+        {
+            break; // Every buffer is empty
+        }
+
+        PrintRecord(*m_mergeHeads[oldest]);
+        LogThreadBuffer& buffer = *m_pollBuffers[oldest];
+        buffer.Pop();
+        m_mergeHeads[oldest] = buffer.Front();
+        ++printed;
+
+        if (m_writeBatch.size() >= WRITE_BATCH_BYTES)
+        {
+            break;
+        }
+    }
+
+    // Release the buffers before writing, so producers overwriting old records don't wait on the sinks
+    for (const std::shared_ptr<LogThreadBuffer>& buffer : m_pollBuffers)
+    {
+        buffer->EndConsume();
+    }
+
+    if (m_writeBatch.size() >= WRITE_BATCH_BYTES)
+    {
+        WriteBatch();
+    }
+
+    return printed;
+}
+
+void Logger::PrintRecord(const messageType& msg)
+{
+    // Get the time of day in hh:mm:ss format
+    const std::string_view timeString = m_timeStringCache.Format(msg.messageTime);
+
+    // Format the message here if the call site deferred it
+    m_messageBuffer.clear();
+    msg.AppendMessage(m_messageBuffer);
+
+    // Add the message to the write batch
+    const LogSite& site = *msg.site;
+    FormatMessage(m_writeBatch, timeString, site.level, site.lineNumber, site.sourceFile, m_messageBuffer);
+}
+
+void Logger::UpdateBuffers()
+{
+    // Pick up newly registered threads
+    if (m_buffersVersion.load(std::memory_order_acquire) != m_pollBuffersVersion)
+    {
+        std::lock_guard buffersLock(m_buffersMutex);
+        m_pollBuffers = m_buffers;
+        m_pollBuffersVersion = m_buffersVersion.load(std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < m_pollBuffers.size(); ++i)
+    {
+        LogThreadBuffer& buffer = *m_pollBuffers[i];
+
+        // Once the owning thread has exited and everything it logged has been printed, stop polling its buffer.
+        // Retired is checked first so every record pushed before the thread exited is visible.
+        if (buffer.IsRetired() && buffer.Front() == nullptr)
+        {
+            std::lock_guard buffersLock(m_buffersMutex);
+            std::erase(m_buffers, m_pollBuffers[i]);
+            m_retiredOverflowCounts += buffer.GetOverflowCounts();
+            m_buffersVersion.fetch_add(1, std::memory_order_relaxed);
+            m_pollBuffers.erase(m_pollBuffers.begin() + i);
+            --i;
+        }
+    }
+
+    // Let the user know if messages were lost or held up, at most once per interval
+    const uint64_t now = Timer::Ticks();
+    if (Timer::TicksToNanoseconds(now - m_lastOverflowReport) >= OVERFLOW_REPORT_INTERVAL_NS)
+    {
+        m_lastOverflowReport = now;
+        ReportOverflows();
+    }
+}
+
+void Logger::ReportOverflows()
+{
+    const LogOverflowCounts counts = GetOverflowCounts();
+    const size_t dropped     = counts.dropped     - m_reportedOverflowCounts.dropped;
+    const size_t overwritten = counts.overwritten - m_reportedOverflowCounts.overwritten;
+    const size_t blocked     = counts.blocked     - m_reportedOverflowCounts.blocked;
+    m_reportedOverflowCounts = counts;
+
+    if (dropped == 0 && overwritten == 0 && blocked == 0)
+    {
+        return;
+    }
+
+    FormatMessage(m_writeBatch, m_timeStringCache.Format(Timer::Ticks()), LogLevel::WARNING, __LINE__, __FILE__,
+        std::format("Thread log buffers full ({}): dropped {}, overwritten {}, blocked {} messages",
+            OverflowPolicyToString(m_overflowPolicy), dropped, overwritten, blocked));
 }
@@ -5,86 +5,207 @@
 // The Logger class provides a thread-safe logging mechanism.
 // It uses a separate thread to handle logging messages, allowing the main thread
 // to continue executing without blocking.
-// The logger uses a queue to store messages and a condition variable to signal
-// the logging thread when there are messages to log.
+// Every thread that logs registers its own bounded single-producer/single-consumer
+// buffer the first time it calls LOG, so producers never share a cache line, take
+// a lock or wake another thread. The logging thread polls all of the buffers, merges
+// their records in timestamp order, and backs off (spin, yield, sleep) when idle.
+// Merged messages are formatted into one large batch that is handed to every
+// LogSink with a single write, instead of one print per message.
+// What a producer does when its buffer is full is set per Logger with an
+// OverflowPolicy (drop the new message, overwrite the oldest, grow the buffer up
+// to a cap, or wait for space). Overflows are counted and reported periodically.
 // The logger can be used from any thread, and it is safe to call the LOG
 // macro from multiple threads simultaneously.
 
-#include <mutex>
-#include <condition_variable>
 #include <string>
 #include <string_view>
 #include <format>
 #include <thread>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <chrono> // For time-related functions
 
-#include <GL/glew.h> // For GLubyte type
-
 #include "LoggerHelper.h"
 #include "Timer.h"
-#include "CircularBuffer.h"
+#include "LogRecord.h"
+#include "LogSinks.h"
+#include "LogThreadBuffer.h"
+#include "ThreadUtils.h"
 
 class Logger
 {
 public:
-    Logger();
+    // overflowPolicy decides what happens when a thread logs faster than the logging thread can keep up.
+    // maxThreadBufferMessages caps how far a thread's buffer may grow with OverflowPolicy::GROW.
+    explicit Logger(OverflowPolicy overflowPolicy = OverflowPolicy::DROP_NEWEST,
+                    size_t maxThreadBufferMessages = 16 * THREAD_BUFFER_CAPACITY);
     ~Logger();
 
-    // Method to log messages with a specific log level, source file, line number, and message
+    // Method to log messages from a LOG call site
     // Accessed via the LOG macro, which automatically includes the source file and line number.
     // Example usage: LOG(LogLevel::INFO, "This is a log message with value: {}", value);
-    // The macro automatically includes the function name and line number in the log message
-    inline void Log(const LogLevel level, 
-                    const unsigned int lineNumber,
-                    const std::string sourceFile,
-                    const std::string& msg)
+    // The format string is checked at compile time. When every argument can be captured as raw
+    // bytes the message is only formatted later on the logging thread, otherwise it is formatted here.
+    template <typename... Args>
+    inline void Log(const LogSite& site, std::format_string<Args...> formatStr, Args&&... args)
     {
-        // Get the current date
-        const std::chrono::time_point msgTime{ std::chrono::system_clock::now() };
+        // Timestamp the message with the cheap tick counter, the logging thread converts it to wall time
+        const uint64_t msgTime = Timer::Ticks();
+
+        // Construct the record in this thread's buffer, the overflow policy decides what happens if it is full
+        LogThreadBuffer& buffer = GetThreadBuffer();
+        if constexpr (LOG_ARGS_DEFERRABLE<Args...>)
         {
-            // Lock the mutex when modifying the queue
-            std::lock_guard queueUpdatelock(m_queueMutex);
-
-            // Construct the message structure in the queue
-            m_queue.emplace(msgTime, level, lineNumber, sourceFile, msg);
-        } // Unlock mutex before updating condition variable
-    
-        // Update condition variable
-        m_cv.notify_one();
+            if (LogRecord::EncodedSize(args...) <= LOG_RECORD_ARG_BYTES)
+            {
+                Enqueue(buffer, DeferredFormatTag{}, msgTime, site, args...);
+                return;
+            }
+        }
+        Enqueue(buffer, msgTime, site, std::format(formatStr, std::forward<Args>(args)...));
     }
 
-// private:
-    // Structure to hold the log message
-    struct msgStruct
+    // Set the lowest level that gets logged at runtime. Levels below LOG_COMPILE_MIN_LEVEL
+    // are compiled out and can't be turned back on here.
+    inline void SetMinLevel(const LogLevel level) { m_minLevelSeverity.store(LogLevelSeverity(level), std::memory_order_relaxed); }
+
+    // Check if a message of the given level should be logged. Called by LOG before anything is formatted.
+    inline bool IsLevelEnabled(const LogLevel level) const
     {
-        std::chrono::time_point<std::chrono::system_clock> messageTime; // Time of day when the message was logged
-        LogLevel level;
-        unsigned int lineNumber;
-        std::string sourceFile;
-        std::string message;
-
-        msgStruct() = default; // Default constructor
-
-        // Constructor to initialize the message structure
-        msgStruct(std::chrono::time_point<std::chrono::system_clock> time, LogLevel lvl, unsigned int line, std::string file, std::string msg)
-            : messageTime(time), level(lvl), lineNumber(line), sourceFile(std::move(file)), message(msg) 
-        {}
-    };
-    typedef msgStruct messageType;
+        return LogLevelSeverity(level) >= m_minLevelSeverity.load(std::memory_order_relaxed);
+    }
+
+    // Total number of messages lost because a thread's buffer was full (dropped or overwritten)
+    size_t GetDroppedMessageCount();
+
+    // Totals of every overflow counter since the logger started
+    LogOverflowCounts GetOverflowCounts();
+
+    OverflowPolicy GetOverflowPolicy() const { return m_overflowPolicy; }
+
+    // Add a destination for log messages. A new logger starts with a ConsoleSink.
+    void AddSink(std::unique_ptr<LogSink> sink);
+
+    // Remove every sink (messages are discarded until a sink is added again)
+    void ClearSinks();
+
+    // Wait until everything this thread logged so far has been written to the sinks
+    void Flush();
+
+    typedef LogRecord messageType;
 private:
 
+    static constexpr size_t THREAD_BUFFER_CAPACITY = LogThreadBuffer::SEGMENT_CAPACITY; // Messages per thread buffer segment
+    static constexpr size_t BATCH_SIZE             = 256;  // Messages merged per drain before checking for shutdown
+    static constexpr size_t WRITE_BATCH_BYTES      = 64 * 1024; // Formatted bytes collected before they are written to the sinks
+    static constexpr double OVERFLOW_REPORT_INTERVAL_NS = 1e9; // How often overflows are summarized in the log
+
+    // Thread local handle that registers the thread's buffer and retires it when the thread exits
+    struct ThreadBufferHandle
+    {
+        uint64_t                         loggerId = 0;
+        std::shared_ptr<LogThreadBuffer> buffer;
+
+        ~ThreadBufferHandle()
+        {
+            if (buffer)
+            {
+                buffer->Retire();
+            }
+        }
+    };
+
+    // Get the calling thread's buffer, registering it on first use
+    inline LogThreadBuffer& GetThreadBuffer()
+    {
+        thread_local ThreadBufferHandle t_handle;
+        if (t_handle.loggerId != m_loggerId) [[unlikely]]
+        {
+            RegisterThread(t_handle);
+        }
+        return *t_handle.buffer;
+    }
+
+    // Construct a record in the buffer. With OverflowPolicy::BLOCK this waits for space until the
+    // logger shuts down, every other policy is applied by the buffer itself and never waits.
+    template <typename... RecordArgs>
+    inline void Enqueue(LogThreadBuffer& buffer, RecordArgs&&... recordArgs)
+    {
+        if (buffer.TryPush(std::forward<RecordArgs>(recordArgs)...)) [[likely]]
+        {
+            return;
+        }
+
+        if (m_overflowPolicy == OverflowPolicy::BLOCK)
+        {
+            buffer.CountBlocked();
+            Backoff blockBackoff;
+            while (!m_finishLogging.load(std::memory_order_relaxed))
+            {
+                blockBackoff.Pause();
+                if (buffer.TryPush(std::forward<RecordArgs>(recordArgs)...))
+                {
+                    return;
+                }
+            }
+        }
+        buffer.CountDropped();
+    }
+
+    // Create a buffer for the calling thread and add it to the list the logging thread polls
+    void RegisterThread(ThreadBufferHandle& handle);
+
     const bool              m_debugLogger = true; // Flag to indicate if debug prints in the logger itself should print
-    size_t                  m_queueMaxSize = 0;
-    CircularBuffer<messageType> m_queue; // Circular buffer to hold messages
-    std::mutex              m_queueMutex;
-    std::condition_variable m_cv;
+    const uint64_t          m_loggerId; // Unique per Logger instance so thread handles can tell loggers apart
+    const OverflowPolicy    m_overflowPolicy;
+    const size_t            m_maxThreadBufferSegments; // Segments a buffer may grow to with OverflowPolicy::GROW
+    std::atomic<size_t>     m_queueMaxSize = 0; // Written by the logging thread, read on shutdown
+    std::atomic<int>        m_minLevelSeverity = LogLevelSeverity(LOG_COMPILE_MIN_LEVEL); // Runtime level threshold
     std::atomic<bool>       m_finishLogging = false;
+
+    std::mutex              m_buffersMutex; // Only taken when a thread registers or a buffer is added/removed
+    std::vector<std::shared_ptr<LogThreadBuffer>> m_buffers; // Every registered thread buffer
+    std::atomic<uint64_t>   m_buffersVersion = 0; // Bumped whenever m_buffers changes
+    LogOverflowCounts       m_retiredOverflowCounts; // Overflows counted by buffers that were already removed
+
+    std::mutex              m_sinksMutex; // Taken by the logging thread once per write batch
+    std::vector<std::unique_ptr<LogSink>> m_sinks;
+    std::atomic<uint64_t>   m_flushRequested = 0; // Incremented by Flush()
+    std::atomic<uint64_t>   m_flushCompleted = 0; // Last flush request the logging thread has written out
+
+    // Only touched by the logging thread
+    std::vector<std::shared_ptr<LogThreadBuffer>> m_pollBuffers; // Snapshot of m_buffers
+    uint64_t                m_pollBuffersVersion = 0;
+    std::vector<messageType*> m_mergeHeads; // Oldest unprinted record of each buffer while merging
+    std::string             m_messageBuffer; // Reused to format deferred messages
+    std::string             m_writeBatch; // Formatted messages waiting to be written to the sinks
+    TimeStringCache         m_timeStringCache; // Turns record timestamps into HH:MM:SS.hh
+    LogOverflowCounts       m_reportedOverflowCounts; // Overflow totals at the last report
+    uint64_t                m_lastOverflowReport = 0; // Timer::Ticks() of the last report
+
     std::thread             m_logThread;
 
     // Function to run the logging thread
-    // This function will continuously check for messages in the queue and log them.
+    // This function will continuously check for messages in the thread buffers and log them.
     void RunLogger();
+
+    // Merge and print up to BATCH_SIZE queued messages in timestamp order and return how many were printed
+    size_t DrainQueue();
+
+    // Format a single record into the write batch
+    void PrintRecord(const messageType& msg);
+
+    // Write the batch to every sink
+    void WriteBatch();
+
+    // Refresh m_pollBuffers and remove the buffers of threads that have exited
+    void UpdateBuffers();
+
+    // Write one line summarizing the overflows since the last report, if there were any
+    void ReportOverflows();
 };
 
 // Pointer to a logging object for use by any file that includes this header.
@@ -94,6 +215,20 @@ inline Logger* loggerPtr = nullptr;
 // Macro to log messages
 // Usage: LOG(LogLevel::INFO, "This is a log message with value: {}", value);
 // The macro automatically includes the function name and line number in the log message.
-#define LOG(level, formatStr, ...) loggerPtr->Log(level, __LINE__, __FILE__, std::format(formatStr, ##__VA_ARGS__))
+// Each call site gets its own static LogSite, so only a pointer to it is queued with the arguments.
+// Levels below LOG_COMPILE_MIN_LEVEL are discarded at compile time, and levels below the logger's
+// runtime threshold return before anything is formatted. In both cases the arguments are not evaluated.
+#define LOG(level, formatStr, ...) \
+    do \
+    { \
+        if constexpr (IsLogLevelCompiledIn(level)) \
+        { \
+            if (loggerPtr->IsLevelEnabled(level)) \
+            { \
+                static constexpr LogSite logSite{level, __LINE__, __FILE__, formatStr}; \
+                loggerPtr->Log(logSite, formatStr, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
 
 #endif // !LOGGER_H
\ No newline at end of file
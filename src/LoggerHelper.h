@@ -1,11 +1,18 @@
 #ifndef LOGGER_TYPES_H
 #define LOGGER_TYPES_H
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <format>
+#include <iterator>
 #include <print>
 
+#include "Timer.h"
+
 enum class LogLevel
 {
     INFO,
@@ -27,6 +34,32 @@ constexpr inline std::string LogLevelToString(const LogLevel level)
     }
 }
 
+// Rank log levels by importance so they can be compared against a minimum level.
+// DEBUG is the least important and ERROR the most.
+constexpr inline int LogLevelSeverity(const LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::DEBUG:   return 0;
+        case LogLevel::INFO:    return 1;
+        case LogLevel::WARNING: return 2;
+        case LogLevel::ERROR:   return 3;
+        default:                return 3;
+    }
+}
+
+// Lowest level that is compiled into the program. LOG calls below it compile to nothing.
+// Set through the PHYSICSSIM_LOG_MIN_LEVEL CMake option.
+#ifndef LOG_COMPILE_MIN_LEVEL
+    #define LOG_COMPILE_MIN_LEVEL LogLevel::DEBUG
+#endif
+
+// Check if messages of the given level are compiled in
+constexpr inline bool IsLogLevelCompiledIn(const LogLevel level)
+{
+    return LogLevelSeverity(level) >= LogLevelSeverity(LOG_COMPILE_MIN_LEVEL);
+}
+
 // Function to get the time of day in hh:mm:ss format
 inline std::string GetTimeString(const std::chrono::time_point<std::chrono::system_clock> now)
 {
@@ -37,10 +70,47 @@ inline std::string GetTimeString(const std::chrono::time_point<std::chrono::syst
                                         - std::chrono::floor<std::chrono::seconds>(now)).count() / 10};
 
     // Format time to hundredths of a second (HH:MM:SS.hh)
-    return std::format("{:02}:{:02}:{:02}.{:<2}",
+    return std::format("{:02}:{:02}:{:02}.{:02}",
         localTime.tm_hour, localTime.tm_min, localTime.tm_sec, ms.count());
 }
 
+// Formats Timer::Ticks() timestamps as HH:MM:SS.hh for the logging thread.
+// The broken down local time is only computed when the second changes, every other
+// timestamp just patches the hundredths digits of the cached string.
+class TimeStringCache
+{
+public:
+    inline std::string_view Format(const uint64_t ticks)
+    {
+        const std::chrono::time_point time = Timer::TicksToSystemTime(ticks);
+        const std::chrono::time_point second = std::chrono::floor<std::chrono::seconds>(time);
+        const int64_t secondCount = second.time_since_epoch().count();
+        if (secondCount != m_cachedSecond)
+        {
+            // New second, do the slow local time conversion once
+            const std::time_t timeT = std::chrono::system_clock::to_time_t(second);
+            std::tm localTime;
+#if defined(_WIN32)
+            localtime_s(&localTime, &timeT);
+#else
+            localtime_r(&timeT, &localTime);
+#endif
+            std::format_to(m_timeString.data(), "{:02}:{:02}:{:02}.00", localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+            m_cachedSecond = secondCount;
+        }
+
+        // Patch in the hundredths of a second
+        const int hundredths = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(time - second).count() / 10);
+        m_timeString[9]  = static_cast<char>('0' + hundredths / 10);
+        m_timeString[10] = static_cast<char>('0' + hundredths % 10);
+        return std::string_view(m_timeString.data(), m_timeString.size());
+    }
+
+private:
+    int64_t              m_cachedSecond = INT64_MIN;  // Seconds since the epoch of the cached string
+    std::array<char, 11> m_timeString{};              // "HH:MM:SS.hh"
+};
+
 // Function to extract base file name from __FILE__
 constexpr static inline std::string_view GetBaseFileName(std::string_view file)
 {
@@ -48,15 +118,29 @@ constexpr static inline std::string_view GetBaseFileName(std::string_view file)
     return (lastSep == std::string_view::npos) ? file : file.substr(lastSep + 1);
 }
 
+// Function to append a message with the correct format and a trailing newline to out
+inline void FormatMessage(std::string&           out,
+                          const std::string_view timeString,
+                          const LogLevel         level,
+                          const unsigned int     lineNumber,
+                          const std::string_view sourceFile,
+                          const std::string_view message)
+{
+    std::format_to(std::back_inserter(out), "{}  {:<8} [{:<20}:{:<3}] {}\n", 
+        timeString, LogLevelToString(level), GetBaseFileName(sourceFile), lineNumber, message);
+}
+
 // Function to print a message to the console with the correct format
-inline void PrintMessage(const std::string& timeString,
-                         const LogLevel     level,
-                         const unsigned int lineNumber,
-                         const std::string& sourceFile,
-                         const std::string& message)
+inline void PrintMessage(const std::string&     timeString,
+                         const LogLevel         level,
+                         const unsigned int     lineNumber,
+                         const std::string_view sourceFile,
+                         const std::string_view message)
 {
     // Output the message
-    std::println("{}  {:<8} [{:<20}:{:<3}] {}", timeString, LogLevelToString(level), GetBaseFileName(sourceFile), lineNumber, message);
+    std::string line;
+    FormatMessage(line, timeString, level, lineNumber, sourceFile, message);
+    std::print("{}", line);
 }
 
 // Function to immediately print a message to the console. 
@@ -6,6 +6,9 @@
 #include <sstream>
 #include <array>
 #include <numbers>
+#include <vector>
+#include <cstdlib>
+#include <memory>
 
 // External Libraries includes
 #include <GL/glew.h>
@@ -14,27 +17,61 @@
 // Project includes
 #include "Logger.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "TraceWriter.h"
 #include "UnitTests.h"
 #include "OpenGlUtils.h"
 #include "Renderer.h"
-#include "VertexBuffer.h"
-#include "VertexBufferLayout.h"
-#include "IndexBuffer.h"
-#include "VertexArray.h"
-#include "Shader.h"
+#include "BodyRenderer.h"
 #include "Application.h"
+#include "Simulation.h"
 
 // #define TESTING
 
-int main() 
+int main(int argc, char** argv) 
 {
+    // Create the profiler object, zone statistics are logged every 120 frames.
+    // Created before the logger so it outlives the logging thread, which records zones too.
+    Profiler profiler;
+    profilerPtr = &profiler;
+
     // Create the logger object
     Logger logger;
     loggerPtr = &logger;
 
     // Run the unit tests
     // LogTimerTest();
+    // LogContentionTest();
+    // LogDeferredFormatTest();
+    // LogSinkThroughputTest();
+    // LogTimestampTest();
+    // LogOverflowPolicyTest();
+    // CircularBufferTest();
+    // ProfilerOverheadTest();
+    // TraceWriterTest();
+    // BodyStoreTest();
+    // SimulationStepTest();
+    // IntegratorBenchmarkTest();
+    // BroadphaseTest();
+    // AabbTreeTest();
+    // ContactSolverTest();
+    // JobSystemTest();
+    // GravityTest();
+    // BodyReorderTest();
+    // DrawQueueTest();
 #ifndef TESTING
+    SimulationConfig config;
+    if (!ParseSimulationArguments(argc, argv, config))
+    {
+        return -1;
+    }
+
+    // Headless mode never opens a window, it only steps the simulation as fast as it can
+    if (config.headless)
+    {
+        return RunHeadlessSimulation(config);
+    }
+
     LOG(LogLevel::INFO, "Hello, World! This is my OpenGL application using GLEW and GLFW.");
     
     // Initialize GLFW
@@ -58,6 +95,15 @@ int main()
         return -1;
     }
 
+    // Write a Chrome trace of every profiled zone if PHYSICSSIM_TRACE is set to a file path
+    std::unique_ptr<TraceWriter> traceWriter;
+    if (const char* tracePath = std::getenv("PHYSICSSIM_TRACE"))
+    {
+        traceWriter = std::make_unique<TraceWriter>(tracePath);
+        profiler.SetTraceWriter(traceWriter.get());
+        LOG(LogLevel::INFO, "Writing trace to {}", tracePath);
+    }
+
     // Set the key callback function
     glfwSetKeyCallback(window, Application::KeyCallback);
 
@@ -68,7 +114,7 @@ int main()
     // Set the current context to the created window
     glfwMakeContextCurrent(window);
 
-    glfwSwapInterval(1); // Enable vsync
+    glfwSwapInterval(config.vsync ? 1 : 0); // Enable vsync unless rendering is being measured
 
     // Initialize GLEW
     // glewExperimental = GL_TRUE; // Enable modern OpenGL functionality
@@ -90,76 +136,165 @@ int main()
                           0.5f,  0.5f,
                          -0.5f,  0.5f}; // 2D vertex positions
 
-    unsigned int indices[] = {0, 1, 2, 
-                              2, 3, 0};
-
-    appState.m_positions = positions;
+    // Every vertex of the quad is a body, the body store is the only copy of the positions from here on
+    for (size_t i = 0; i + 1 < sizeof(positions) / sizeof(positions[0]); i += 2)
+    {
+        appState.m_bodies.Add(positions[i], positions[i + 1]);
+    }
+    AddRandomBodies(appState.m_bodies, config.windowBodies, config.contacts);
     appState.m_updatePositions = true; // Add a flag to track changes in positions
-    appState.m_positionsLength = sizeof(positions) / sizeof(positions[0]);
-    appState.m_indices = indices;
-    appState.m_indicesLength = sizeof(indices) / sizeof(indices[0]);
     
     {
-        VertexArray va;
-        // Create a vertex array buffer to put data into
-        VertexBuffer vb(appState.m_positions, appState.m_positionsLength * sizeof(appState.m_positions[0]));
-        
-        VertexBufferLayout layout;
-        layout.Push<float>(2);
-        va.AddBuffer(vb, layout);
-
-        // Create an index buffer object (IBO) for element array
-        IndexBuffer ib(appState.m_indices, appState.m_indicesLength);
-        
-        // Create shaders
-        Shader shader("res/shaders/Basic.shader");
-        shader.Bind();
-        shader.SetUniform4f("u_Color", 0.8f, 0.3f, 0.8f, 1.0f);
-
-        va.Unbind(); // Unbind the VAO
-        vb.Unbind();
-        ib.Unbind();
-        shader.Unbind();
-
-        // Create renderer object
-        Renderer renderer;
-
-        float redChannelColor = 0.0f;
-        float increment = 0.05f;
+        // Create renderer object first, so every GL object binds through its state cache
+        Renderer renderer(config.stateCache);
+
+        // Every body is an instance of one quad, drawn in a single call
+        BodyRenderer bodyRenderer("res/shaders/Instanced.shader", config.persistentMapping);
+        int framebufferWidth = 0;
+        int framebufferHeight = 0;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        bodyRenderer.SetViewport(framebufferWidth, framebufferHeight);
+
+        // Physics runs at a fixed rate, independent of how fast frames are presented
+        Simulation simulation(appState.m_bodies, config.integrator, config.simdLevel);
+        FixedStepClock clock(config.stepHz, config.maxSubsteps);
+        const float stepSeconds = static_cast<float>(clock.StepSeconds());
+        LOG(LogLevel::INFO, "Physics at {} Hz with the {} integrator ({})", config.stepHz,
+            IntegratorTypeToString(config.integrator), SimdLevelToString(simulation.GetIntegrator().GetSimdLevel()));
+
+        // Physics and vertex generation run as jobs, with the main thread helping while it waits
+        JobSystem jobs(config.threads);
+        simulation.SetJobSystem(&jobs);
+        if (config.contacts)
+        {
+            simulation.EnableContacts();
+        }
+        if (config.gravity)
+        {
+            GravitySettings gravity;
+            gravity.openingAngle = config.theta;
+            simulation.EnableGravity(gravity);
+        }
+        if (config.reorder)
+        {
+            simulation.EnableReordering();
+        }
+        LOG(LogLevel::INFO, "Running jobs on {} threads, contacts {}, gravity {}", jobs.GetThreadCount(), config.contacts ? "on" : "off",
+            config.gravity ? "on" : "off");
+
+        // Frame and step times are accumulated separately and reported every REPORT_FRAMES frames
+        constexpr unsigned int REPORT_FRAMES = 240;
+        unsigned int reportFrames = 0;
+        uint64_t reportSteps = 0;
+        int64_t reportFrameUs = 0;
+        int64_t reportStepUs = 0;
+        GlCallStats reportGlStart = glCallStats;
+        GlStateStats reportStateStart = renderer.GetStateCache().GetStats();
 
         Timer frameTimer{false};
+        Timer stepTimer{false};
+        uint64_t lastFrameTicks = Timer::Ticks();
         // Loop until the user closes the window
         while (!glfwWindowShouldClose(window))
         {
             frameTimer.Start();
+            unsigned int steps = 0;
+            {
+                PROFILE_SCOPE("Frame");
 
-            // Clear here
-            renderer.Clear();
+                // Run as many fixed steps as the real time since the last frame covers
+                {
+                    PROFILE_SCOPE("Physics");
+                    const uint64_t frameTicks = Timer::Ticks();
+                    steps = clock.Advance(Timer::TicksToNanoseconds(frameTicks - lastFrameTicks) * 1e-9);
+                    lastFrameTicks = frameTicks;
 
-            // Bind shader and set up the uniforms
-            shader.Bind();
-            shader.SetUniform4f("u_Color", redChannelColor, 0.3f, 0.8f, 1.0f); // Set the color uniform
+                    stepTimer.Start();
+                    for (unsigned int step = 0; step < steps; ++step)
+                    {
+                        simulation.Step(stepSeconds);
+                    }
+                    reportStepUs += stepTimer.Stop().count();
+                    reportSteps += steps;
+                }
 
-            // Update vertex buffer data only if positions have changed
-            if (appState.m_updatePositions) 
-            {
-                vb.UpdateData(appState.m_positions, appState.m_positionsLength * sizeof(appState.m_positions[0]));
-                appState.m_updatePositions = false; // Reset the flag after updating
-            }
-            va.AddBuffer(vb, layout); // Re-add the buffer to update the VAO state
+                // Clear here
+                {
+                    PROFILE_SCOPE("Clear");
+                    renderer.Clear();
+                }
+
+                // Update the instance buffers only if positions have changed
+                {
+                    PROFILE_SCOPE("BufferUpdate");
+                    // Bodies moved by the keys jump straight to their new positions
+                    if (appState.m_updatePositions)
+                    {
+                        simulation.ResetInterpolation();
+                    }
+
+                    // Draw the bodies between the last two steps, so motion is smooth whatever the step rate
+                    if (appState.m_updatePositions || steps > 0)
+                    {
+                        bodyRenderer.Update(appState.m_bodies, simulation, clock.Alpha(), &jobs);
+                        appState.m_updatePositions = false; // Reset the flag after updating
+                    }
+                }
 
-            // Draw the triangle using the shader program
-            renderer.Draw(va, ib, shader);
+                // Draw every body, through the renderer's queue
+                {
+                    PROFILE_SCOPE("Draw");
+                    bodyRenderer.Draw(renderer);
+                    renderer.Flush();
+                    bodyRenderer.EndFrame();
+                }
 
-            // Swap front and back buffers
-            glfwSwapBuffers(window);
+                // Swap front and back buffers
+                {
+                    PROFILE_SCOPE("Swap");
+                    glfwSwapBuffers(window);
+                }
 
-            // Poll for and process events
-            glfwPollEvents();
+                // Poll for and process events
+                {
+                    PROFILE_SCOPE("Poll");
+                    glfwPollEvents();
+                }
+            }
+            profiler.EndFrame();
             
             std::chrono::microseconds frameTime = frameTimer.Stop();
-            // Print out the time difference
-            LOG(LogLevel::INFO, "Frame time delta = {}us, fps={}", frameTime.count(), 1e6 / frameTime.count());
+            // Print out the time difference (compiled out unless DEBUG logs are enabled)
+            LOG(LogLevel::DEBUG, "Frame time delta = {}us, fps={}, physics steps={}", frameTime.count(), 1e6 / frameTime.count(), steps);
+
+            reportFrameUs += frameTime.count();
+            if (++reportFrames == REPORT_FRAMES)
+            {
+                LOG(LogLevel::INFO, "Frame avg = {:.1f}us, step avg = {:.1f}us, {:.2f} steps/frame at {} Hz, {} steps skipped so far",
+                    static_cast<double>(reportFrameUs) / reportFrames,
+                    reportSteps > 0 ? static_cast<double>(reportStepUs) / reportSteps : 0.0,
+                    static_cast<double>(reportSteps) / reportFrames, config.stepHz, clock.GetSkippedSteps());
+                LOG(LogLevel::INFO, "Rendered {} bodies from {} draw commands in {} draw calls, {} waits for the GPU so far ({} mapping)",
+                    bodyRenderer.GetInstanceCount(), renderer.GetQueueStats().commands, renderer.GetQueueStats().batches,
+                    bodyRenderer.GetWaitCount(),
+                    bodyRenderer.IsPersistent() ? "persistent" : "per frame");
+                LOG(LogLevel::INFO, "{:.1f} GL calls and {:.1f} draw calls per frame, {} vertex arrays recorded so far",
+                    static_cast<double>(glCallStats.calls - reportGlStart.calls) / reportFrames,
+                    static_cast<double>(glCallStats.drawCalls - reportGlStart.drawCalls) / reportFrames,
+                    bodyRenderer.GetVertexArrayBuilds());
+                const GlStateStats& stateStats = renderer.GetStateCache().GetStats();
+                LOG(LogLevel::INFO, "State changes per frame: {:.1f} issued, {:.1f} skipped by the state cache ({})",
+                    static_cast<double>(stateStats.issued - reportStateStart.issued) / reportFrames,
+                    static_cast<double>(stateStats.skipped - reportStateStart.skipped) / reportFrames,
+                    renderer.GetStateCache().IsEnabled() ? "on" : "off");
+                reportGlStart = glCallStats;
+                reportStateStart = stateStats;
+                LogJobStats(jobs.GetStats());
+                reportFrames = 0;
+                reportSteps = 0;
+                reportFrameUs = 0;
+                reportStepUs = 0;
+            }
         }
     }
     LOG(LogLevel::INFO, "GLEW version: {}", reinterpret_cast<const char*>(glewGetString(GLEW_VERSION))); 
@@ -0,0 +1,75 @@
+#include "Morton.h"
+
+#include <array>
+#include <utility>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// Positions coded per job
+static constexpr size_t CODE_GRAIN = 16384;
+
+void MortonOrder::Sort(const float* x, const float* y, const size_t count, JobSystem* jobs)
+{
+    PROFILE_SCOPE("MortonSort");
+
+    m_codes.resize(count);
+    m_order.resize(count);
+    m_scratchCodes.resize(count);
+    m_scratchOrder.resize(count);
+
+    const auto encode = [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_codes[i] = MortonCode(x[i], y[i]);
+            m_order[i] = static_cast<uint32_t>(i);
+        }
+    };
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(count, CODE_GRAIN, encode);
+    }
+    else
+    {
+        encode(0, count);
+    }
+
+    // Least significant digit radix sort, 8 bits per pass. All four histograms are counted in one read.
+    std::array<std::array<uint32_t, 256>, 4> counts = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t code = m_codes[i];
+        ++counts[0][code & 0xFF];
+        ++counts[1][(code >> 8) & 0xFF];
+        ++counts[2][(code >> 16) & 0xFF];
+        ++counts[3][code >> 24];
+    }
+
+    for (uint32_t pass = 0; pass < 4; ++pass)
+    {
+        // A digit every code shares doesn't change the order, which is common for the top digit of a crowded area
+        const uint32_t shift = 8 * pass;
+        if (count == 0 || counts[pass][(m_codes[0] >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& digitCount : counts[pass])
+        {
+            const uint32_t digitStart = offset;
+            offset += digitCount;
+            digitCount = digitStart;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t slot = counts[pass][(m_codes[i] >> shift) & 0xFF]++;
+            m_scratchCodes[slot] = m_codes[i];
+            m_scratchOrder[slot] = m_order[i];
+        }
+        std::swap(m_codes, m_scratchCodes);
+        std::swap(m_order, m_scratchOrder);
+    }
+}
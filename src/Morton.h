@@ -0,0 +1,68 @@
+#ifndef MORTON_H
+#define MORTON_H
+// Morton.h
+// This file contains Morton codes (the Z-order curve) for positions in the world.
+// The world is divided into a grid of 2^16 x 2^16 cells and the bits of a cell's
+// x and y coordinates are interleaved into one 32 bit code. Sorting by the code
+// walks the grid in Z order: the bodies of every quadtree cell, at every level, end
+// up next to each other, and the top 2 * level bits of a code name the cell at that
+// level. MortonOrder computes the codes of a set of bodies and radix sorts them.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Integrator.h"
+
+class JobSystem;
+
+// Bits of each coordinate in a code, so levels of the quadtree a code can tell apart
+inline constexpr uint32_t MORTON_BITS = 16;
+
+// Spread the low 16 bits of v out to the even bits
+inline uint32_t MortonSpreadBits(uint32_t v)
+{
+    v &= 0x0000FFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+// Code of grid cell (x, y), with x in the even bits
+inline uint32_t MortonEncode(const uint32_t x, const uint32_t y)
+{
+    return MortonSpreadBits(x) | (MortonSpreadBits(y) << 1);
+}
+
+// Code of the cell a world position falls in. Positions outside the world (not wrapped yet) go to the edge cells.
+inline uint32_t MortonCode(const float x, const float y)
+{
+    constexpr float cellsPerUnit = static_cast<float>(1u << MORTON_BITS) / WORLD_SIZE;
+    constexpr float lastCell = static_cast<float>((1u << MORTON_BITS) - 1);
+    const float cellX = (x - WORLD_MIN) * cellsPerUnit;
+    const float cellY = (y - WORLD_MIN) * cellsPerUnit;
+    return MortonEncode(static_cast<uint32_t>(cellX < 0.0f ? 0.0f : (cellX > lastCell ? lastCell : cellX)),
+                        static_cast<uint32_t>(cellY < 0.0f ? 0.0f : (cellY > lastCell ? lastCell : cellY)));
+}
+
+// Sorts bodies by Morton code. The buffers are reused between sorts.
+class MortonOrder
+{
+public:
+    // Compute the codes of count positions (on jobs if given) and sort them
+    void Sort(const float* x, const float* y, size_t count, JobSystem* jobs = nullptr);
+
+    // Sorted codes, and the index of the position each one belongs to
+    const std::vector<uint32_t>& GetCodes() const { return m_codes; }
+    const std::vector<uint32_t>& GetOrder() const { return m_order; }
+
+private:
+    std::vector<uint32_t> m_codes;
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_scratchCodes;
+    std::vector<uint32_t> m_scratchOrder;
+};
+
+#endif // !MORTON_H
@@ -3,6 +3,7 @@
 // OpenGlUtils.h
 
 // C++ Standard Library includes
+#include <cstdint>
 #include <string>
 
 // External Libraries includes
@@ -19,8 +20,19 @@
     #define ASSERT(x) if (!(x)) __debugbreak();
 #endif
 
+// Calls made through GL_CALL and draw calls issued by the Renderer, since the start. The render
+// thread reads them, subtracting the values of an earlier frame, to report the calls per frame.
+struct GlCallStats
+{
+    uint64_t calls     = 0;
+    uint64_t drawCalls = 0;
+};
+
+inline GlCallStats glCallStats;
+
 // GL error macros
 #define GL_CALL(x) GlClearError(); \
+    ++glCallStats.calls; \
     x; \
     ASSERT(GlLogCall(#x, __FILE__, __LINE__))
 
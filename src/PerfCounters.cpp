@@ -0,0 +1,124 @@
+#include "PerfCounters.h"
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(__linux__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+    #include <cstring>
+    #include <initializer_list>
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+// Open a disabled counter of the calling thread, user space only. Returns -1 if it can't be opened.
+static int OpenCounter(const uint32_t type, const uint64_t config)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+static uint64_t ReadCounter(const int fd)
+{
+    uint64_t count = 0;
+    if (fd < 0 || read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count)))
+    {
+        return 0;
+    }
+    return count;
+}
+
+CacheMissCounter::CacheMissCounter()
+{
+    m_l1Fd = OpenCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    m_lastLevelFd = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+    if (m_l1Fd >= 0)
+    {
+        close(m_l1Fd);
+    }
+    if (m_lastLevelFd >= 0)
+    {
+        close(m_lastLevelFd);
+    }
+}
+
+void CacheMissCounter::Start()
+{
+    for (const int fd : {m_l1Fd, m_lastLevelFd})
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+CacheMissCounts CacheMissCounter::Stop()
+{
+    for (const int fd : {m_l1Fd, m_lastLevelFd})
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    CacheMissCounts counts;
+    counts.l1DataMisses = ReadCounter(m_l1Fd);
+    counts.lastLevelMisses = ReadCounter(m_lastLevelFd);
+    return counts;
+}
+
+#else
+
+CacheMissCounter::CacheMissCounter() = default;
+CacheMissCounter::~CacheMissCounter() = default;
+void CacheMissCounter::Start() {}
+CacheMissCounts CacheMissCounter::Stop() { return CacheMissCounts{}; }
+
+#endif
+
+size_t GetPeakResidentBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    #if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // Already in bytes
+    #else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // In kilobytes
+    #endif
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,47 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+// PerfCounters.h
+// This file contains hardware cache miss counters for measuring memory locality.
+// On Linux they are read through perf_event_open, counting only the calling thread
+// in user space (which is allowed at the default perf_event_paranoid level). Where
+// the counters can't be opened (another OS, a virtual machine without a PMU, or a
+// stricter paranoid level) IsAvailable() is false and every count reads zero, so
+// callers can always use them and just report that nothing was measured.
+// It also reads the peak memory use of the process, for the benchmarks.
+
+#include <cstddef>
+#include <cstdint>
+
+struct CacheMissCounts
+{
+    uint64_t l1DataMisses    = 0; // L1 data cache read misses
+    uint64_t lastLevelMisses = 0; // Misses of the last level cache, which go to memory
+};
+
+class CacheMissCounter
+{
+public:
+    CacheMissCounter();
+    ~CacheMissCounter();
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    // True if at least one of the counters could be opened
+    bool IsAvailable() const { return m_l1Fd >= 0 || m_lastLevelFd >= 0; }
+
+    // Reset the counters and start counting
+    void Start();
+
+    // Stop counting and return the misses since Start
+    CacheMissCounts Stop();
+
+private:
+    int m_l1Fd = -1;
+    int m_lastLevelFd = -1;
+};
+
+// Most memory the process has had resident at once, in bytes. 0 where it can't be read.
+size_t GetPeakResidentBytes();
+
+#endif // !PERF_COUNTERS_H
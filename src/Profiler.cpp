@@ -0,0 +1,159 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logger.h"
+#include "TraceWriter.h"
+
+// Source of unique profiler IDs, 0 is reserved for threads that haven't registered yet
+static std::atomic<uint64_t> s_nextProfilerId = 1;
+
+Profiler::Profiler(const unsigned int reportInterval)
+    : m_profilerId(s_nextProfilerId.fetch_add(1, std::memory_order_relaxed)),
+      m_reportInterval(reportInterval)
+{
+}
+
+Profiler::~Profiler()
+{
+    if (profilerPtr == this)
+    {
+        profilerPtr = nullptr;
+    }
+}
+
+void Profiler::RegisterThread(ThreadRingHandle& handle)
+{
+    std::shared_ptr<ThreadRing> ring = std::make_shared<ThreadRing>();
+    {
+        std::lock_guard ringsLock(m_ringsMutex);
+        ring->threadId = m_nextThreadId++;
+        m_rings.push_back(ring);
+    }
+
+    // A handle left over from a previous profiler gives its old ring up
+    if (handle.ring)
+    {
+        handle.ring->retired.store(true, std::memory_order_release);
+    }
+    handle.ring = std::move(ring);
+    handle.profilerId = m_profilerId;
+}
+
+void Profiler::EndFrame()
+{
+    const uint64_t frameEndTicks = Timer::Ticks();
+    const uint32_t frameThreadId = GetThreadRing().threadId;
+
+    size_t droppedEvents = m_retiredDroppedEvents;
+    {
+        std::lock_guard ringsLock(m_ringsMutex);
+        for (size_t i = 0; i < m_rings.size(); ++i)
+        {
+            ThreadRing& ring = *m_rings[i];
+
+            // Retired is checked first so every event pushed before the thread exited is drained below
+            const bool retired = ring.retired.load(std::memory_order_acquire);
+            while (ProfileEvent* event = ring.events.front())
+            {
+                auto [zoneIt, inserted] = m_zoneIndices.try_emplace(event->zone, m_zones.size());
+                if (inserted)
+                {
+                    ZoneHistory history;
+                    history.zone = event->zone;
+                    m_zones.push_back(std::move(history));
+                }
+                ZoneHistory& history = m_zones[zoneIt->second];
+                history.frameTicks += event->endTicks - event->beginTicks;
+                ++history.frameCalls;
+
+                if (m_traceWriter != nullptr)
+                {
+                    m_traceEvents.push_back(TraceEvent{event->zone, event->beginTicks, event->endTicks, ring.threadId, event->depth});
+                }
+                ring.events.pop();
+            }
+
+            droppedEvents += ring.droppedEvents.load(std::memory_order_relaxed);
+            if (retired)
+            {
+                m_retiredDroppedEvents += ring.droppedEvents.load(std::memory_order_relaxed);
+                m_rings.erase(m_rings.begin() + i);
+                --i;
+            }
+        }
+    }
+
+    if (m_traceWriter != nullptr)
+    {
+        m_traceEvents.push_back(TraceEvent{nullptr, frameEndTicks, frameEndTicks, frameThreadId, 0});
+        m_traceWriter->Submit(m_traceEvents);
+    }
+
+    // Close the frame: every zone that ran gets one sample with its total time
+    for (ZoneHistory& history : m_zones)
+    {
+        if (history.frameCalls > 0)
+        {
+            history.frameTimesMs.push_back(Timer::TicksToNanoseconds(history.frameTicks) * 1e-6);
+            history.totalCalls += history.frameCalls;
+            history.frameTicks = 0;
+            history.frameCalls = 0;
+        }
+    }
+
+    if (droppedEvents != m_reportedDroppedEvents)
+    {
+        LOG(LogLevel::WARNING, "Profiler ring full, dropped {} events", droppedEvents - m_reportedDroppedEvents);
+        m_reportedDroppedEvents = droppedEvents;
+    }
+
+    ++m_framesSinceReport;
+    if (m_reportInterval > 0 && m_framesSinceReport >= m_reportInterval)
+    {
+        Report();
+    }
+}
+
+void Profiler::Report()
+{
+    m_lastReport.clear();
+    for (ZoneHistory& history : m_zones)
+    {
+        std::vector<double>& times = history.frameTimesMs;
+        if (times.empty())
+        {
+            continue;
+        }
+
+        ProfileZoneStats stats;
+        stats.name   = history.zone->name;
+        stats.frames = times.size();
+        stats.callsPerFrame = static_cast<double>(history.totalCalls) / static_cast<double>(times.size());
+        stats.minMs  = *std::min_element(times.begin(), times.end());
+        double totalMs = 0.0;
+        for (const double time : times)
+        {
+            totalMs += time;
+        }
+        stats.avgMs = totalMs / static_cast<double>(times.size());
+
+        // Nearest rank 99th percentile
+        const size_t p99Rank = static_cast<size_t>(std::ceil(0.99 * static_cast<double>(times.size()))) - 1;
+        std::nth_element(times.begin(), times.begin() + p99Rank, times.end());
+        stats.p99Ms = times[p99Rank];
+
+        m_lastReport.push_back(stats);
+        times.clear();
+        history.totalCalls = 0;
+    }
+
+    LOG(LogLevel::INFO, "Profile over {} frames:", m_framesSinceReport);
+    for (const ProfileZoneStats& stats : m_lastReport)
+    {
+        LOG(LogLevel::INFO, "  {:<16} min {:>7.3f}ms  avg {:>7.3f}ms  p99 {:>7.3f}ms  calls/frame {:.1f}",
+            stats.name, stats.minMs, stats.avgMs, stats.p99Ms, stats.callsPerFrame);
+    }
+    m_framesSinceReport = 0;
+}
@@ -0,0 +1,215 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+// Profiler.h
+// This file contains the definition of the Profiler class and the PROFILE_SCOPE macro.
+// PROFILE_SCOPE("name") times the rest of the enclosing scope. The hot path only reads
+// Timer::Ticks() on entry and exit and pushes the raw begin/end ticks into the calling
+// thread's own ring buffer: nothing is formatted, locked or allocated.
+// Once per frame the main loop calls Profiler::EndFrame(), which drains every thread's
+// ring and adds up the time spent in each zone during that frame. Every few frames the
+// per-frame totals are turned into min/avg/p99 per zone and logged. With a TraceWriter
+// attached, every event and frame boundary is also streamed to a Chrome trace file.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CircularBuffer.h"
+#include "Timer.h"
+
+class TraceWriter;
+struct TraceEvent;
+
+// Set to 0 to compile every PROFILE_SCOPE out
+#ifndef PROFILER_ENABLED
+    #define PROFILER_ENABLED 1
+#endif
+
+// Static description of a profiled zone. Every PROFILE_SCOPE owns one instance in static
+// storage, so its address identifies the zone without copying the name.
+struct ProfileZone
+{
+    std::string_view name;
+    unsigned int     lineNumber;
+    std::string_view sourceFile;
+};
+
+// One timed run of a zone, as recorded on the hot path
+struct ProfileEvent
+{
+    const ProfileZone* zone = nullptr;
+    uint64_t           beginTicks = 0;
+    uint64_t           endTicks = 0;
+    uint32_t           depth = 0; // Number of zones this one is nested in on its thread
+};
+
+// Summary of one zone over the frames since the last report
+struct ProfileZoneStats
+{
+    std::string_view name;
+    double           minMs = 0.0;  // Per frame totals, so a zone that runs twice a frame counts both runs
+    double           avgMs = 0.0;
+    double           p99Ms = 0.0;
+    double           callsPerFrame = 0.0;
+    size_t           frames = 0;   // Frames the zone ran in
+};
+
+class Profiler
+{
+public:
+    // Zone statistics are logged every reportInterval frames (0 disables logging, see GetLastReport)
+    explicit Profiler(unsigned int reportInterval = 120);
+    ~Profiler();
+
+    // Record a finished zone on the calling thread. Called by PROFILE_SCOPE.
+    inline void Record(const ProfileZone& zone, const uint64_t beginTicks, const uint64_t endTicks, const uint32_t depth)
+    {
+        ThreadRing& ring = GetThreadRing();
+        if (!ring.events.emplace(ProfileEvent{&zone, beginTicks, endTicks, depth})) [[unlikely]]
+        {
+            // Only this thread writes the counter, so a plain load and store is enough
+            ring.droppedEvents.store(ring.droppedEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    // Aggregate everything recorded since the last call into the current frame.
+    // Call once per frame from the thread that runs the main loop, outside of any PROFILE_SCOPE.
+    void EndFrame();
+
+    // Stream every recorded zone and frame boundary to writer (nullptr stops tracing).
+    // Only call between frames, from the thread that calls EndFrame.
+    void SetTraceWriter(TraceWriter* writer) { m_traceWriter = writer; }
+
+    // Statistics of the last completed report interval
+    const std::vector<ProfileZoneStats>& GetLastReport() const { return m_lastReport; }
+
+    // Nesting depth of the calling thread's open zones, maintained by PROFILE_SCOPE
+    static inline uint32_t& ThreadDepth()
+    {
+        thread_local uint32_t t_depth = 0;
+        return t_depth;
+    }
+
+private:
+    static constexpr size_t RING_CAPACITY = 8192; // Events per thread that can be recorded between two EndFrame calls
+
+    // Ring owned by one recording thread and drained by EndFrame
+    struct ThreadRing
+    {
+        FixedCircularBuffer<ProfileEvent, RING_CAPACITY, BufferThreading::SPSC> events;
+        std::atomic<size_t> droppedEvents = 0;
+        std::atomic<bool>   retired = false; // Set when the owning thread exits
+        uint32_t            threadId = 0;    // Small sequential ID, used as the trace's thread ID
+    };
+
+    // Thread local handle that registers the thread's ring and retires it when the thread exits
+    struct ThreadRingHandle
+    {
+        uint64_t                    profilerId = 0;
+        std::shared_ptr<ThreadRing> ring;
+
+        ~ThreadRingHandle()
+        {
+            if (ring)
+            {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    // Per zone totals of the current frame and the per-frame history since the last report
+    struct ZoneHistory
+    {
+        const ProfileZone*  zone = nullptr;
+        uint64_t            frameTicks = 0; // Ticks spent in the zone during the current frame
+        size_t              frameCalls = 0;
+        size_t              totalCalls = 0;
+        std::vector<double> frameTimesMs;   // One entry per frame the zone ran in
+    };
+
+    // Get the calling thread's ring, registering it on first use
+    inline ThreadRing& GetThreadRing()
+    {
+        thread_local ThreadRingHandle t_handle;
+        if (t_handle.profilerId != m_profilerId) [[unlikely]]
+        {
+            RegisterThread(t_handle);
+        }
+        return *t_handle.ring;
+    }
+
+    // Create a ring for the calling thread and add it to the list EndFrame drains
+    void RegisterThread(ThreadRingHandle& handle);
+
+    // Turn the history into m_lastReport, log it and start a new interval
+    void Report();
+
+    const uint64_t         m_profilerId; // Unique per Profiler instance so thread handles can tell profilers apart
+    const unsigned int     m_reportInterval;
+
+    std::mutex             m_ringsMutex; // Only taken when a thread registers and once per frame
+    std::vector<std::shared_ptr<ThreadRing>> m_rings;
+    uint32_t               m_nextThreadId = 0;
+
+    // Only touched by the thread calling EndFrame
+    std::vector<ZoneHistory> m_zones; // In order of first appearance, so reports keep a stable order
+    std::unordered_map<const ProfileZone*, size_t> m_zoneIndices;
+    std::vector<ProfileZoneStats> m_lastReport;
+    unsigned int           m_framesSinceReport = 0;
+    size_t                 m_reportedDroppedEvents = 0;
+    size_t                 m_retiredDroppedEvents = 0;
+    TraceWriter*           m_traceWriter = nullptr;
+    std::vector<TraceEvent> m_traceEvents; // The current frame's events on their way to m_traceWriter
+};
+
+// Pointer to the profiler for use by any file that includes this header.
+// The actual object must be created in main. PROFILE_SCOPE does nothing while it is null.
+inline Profiler* profilerPtr = nullptr;
+
+// Times the rest of the enclosing scope, see PROFILE_SCOPE
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const ProfileZone& zone)
+        : m_zone(zone), m_beginTicks(Timer::Ticks())
+    {
+        ++Profiler::ThreadDepth();
+    }
+
+    ~ProfileScope()
+    {
+        const uint64_t endTicks = Timer::Ticks();
+        const uint32_t depth = --Profiler::ThreadDepth();
+        if (profilerPtr != nullptr)
+        {
+            profilerPtr->Record(m_zone, m_beginTicks, endTicks, depth);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const ProfileZone& m_zone;
+    const uint64_t     m_beginTicks;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Macro to profile a scope
+// Usage: { PROFILE_SCOPE("Draw"); renderer.Draw(va, ib, shader); }
+// Each call site gets its own static ProfileZone, so only a pointer to it is recorded with the ticks.
+#if PROFILER_ENABLED
+    #define PROFILE_SCOPE(name) \
+        static constexpr ProfileZone PROFILE_CONCAT(profileZone_, __LINE__){name, __LINE__, __FILE__}; \
+        ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZone_, __LINE__))
+#else
+    #define PROFILE_SCOPE(name) do {} while (0)
+#endif
+
+#endif // !PROFILER_H
@@ -1,5 +1,22 @@
 #include "Renderer.h"
 
+#include <cstdint>
+
+Renderer::Renderer(const bool cacheState)
+    : m_state(cacheState),
+      m_baseInstance(GLEW_VERSION_4_2 || GLEW_ARB_base_instance)
+{
+    SetCurrentGlState(&m_state);
+}
+
+Renderer::~Renderer()
+{
+    if (&CurrentGlState() == &m_state)
+    {
+        SetCurrentGlState(nullptr);
+    }
+}
+
 void Renderer::Clear() const
 {
     GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
@@ -7,8 +24,62 @@ void Renderer::Clear() const
 
 void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const
 {
+    // Each is skipped by the state cache if it is already bound, the element buffer usually by the vertex array
     shader.Bind();
     va.Bind();
     ib.Bind();
     GL_CALL(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
-}
\ No newline at end of file
+    ++glCallStats.drawCalls;
+}
+
+void Renderer::DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const
+{
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GL_CALL(glDrawElementsInstanced(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr, instanceCount));
+    ++glCallStats.drawCalls;
+}
+void Renderer::Submit(const DrawCommand& command)
+{
+    m_queue.Record(command);
+}
+
+void Renderer::Flush()
+{
+    const std::vector<DrawBatch>& batches = m_queue.Build();
+    const std::vector<int>& multiDrawCounts = m_queue.GetMultiDrawCounts();
+    const std::vector<const void*>& multiDrawOffsets = m_queue.GetMultiDrawOffsets();
+    for (const DrawBatch& batch : batches)
+    {
+        // Sorted by state, so most of these are skipped by the state cache
+        batch.shader->Bind();
+        batch.vertexArray->Bind();
+        batch.indexBuffer->Bind();
+
+        if (batch.multiDrawCount > 0)
+        {
+            GL_CALL(glMultiDrawElements(GL_TRIANGLES, &multiDrawCounts[batch.multiDrawFirst], GL_UNSIGNED_INT,
+                &multiDrawOffsets[batch.multiDrawFirst], static_cast<GLsizei>(batch.multiDrawCount)));
+        }
+        else
+        {
+            const void* const offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(batch.firstIndex) * sizeof(unsigned int));
+            if (batch.firstInstance == 0)
+            {
+                GL_CALL(glDrawElementsInstanced(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT, offset, batch.instanceCount));
+            }
+            else if (m_baseInstance)
+            {
+                GL_CALL(glDrawElementsInstancedBaseInstance(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT, offset,
+                    batch.instanceCount, batch.firstInstance));
+            }
+            else
+            {
+                LOG(LogLevel::ERROR, "Draw starting at instance {} needs GL 4.2 or ARB_base_instance, skipped", batch.firstInstance);
+                continue;
+            }
+        }
+        ++glCallStats.drawCalls;
+    }
+}
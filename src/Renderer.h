@@ -1,6 +1,11 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 // Renderer.h
+// The Renderer owns the GlStateCache of its thread's context: while it exists every bind,
+// uniform and delete of the GL wrapper classes goes through the cache, so a draw only calls
+// OpenGL for the state that differs from the previous draw.
+// Draws can also be submitted to its DrawQueue, from any thread, and issued together by
+// Flush on the GL thread: sorted by state, with compatible draws merged into one call.
 
 // C++ Standard Library includes
 #include <string>
@@ -9,6 +14,8 @@
 #include <GL/glew.h>
 
 // Project includes
+#include "DrawQueue.h"
+#include "GlStateCache.h"
 #include "Logger.h"
 #include "VertexArray.h"
 #include "IndexBuffer.h"
@@ -17,8 +24,37 @@
 class Renderer
 {
     public:
+    // Makes its state cache the current one of the calling thread, which must have the OpenGL context.
+    // The cache can be turned off to compare against issuing every call.
+    explicit Renderer(bool cacheState = true);
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
     void Clear() const;
     void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
+
+    // Draw the indexed mesh instanceCount times in one call, the per-instance attributes advance per copy
+    void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const;
+
+    // Queue a draw for the next Flush. Safe to call from job threads; the shader's uniforms are whatever
+    // they are when Flush runs, so commands sharing a shader share its uniforms.
+    void Submit(const DrawCommand& command);
+
+    // Sort and merge the submitted draws and issue them. Call on the GL thread once nothing is submitting.
+    void Flush();
+
+    // Commands and draw calls of the last Flush
+    inline const DrawQueueStats& GetQueueStats() const { return m_queue.GetStats(); }
+
+    inline GlStateCache& GetStateCache() { return m_state; }
+    inline const GlStateCache& GetStateCache() const { return m_state; }
+
+    private:
+    GlStateCache m_state;
+    DrawQueue    m_queue;
+    bool         m_baseInstance; // Instanced draws can start past instance 0, GL 4.2 or ARB_base_instance
 };
 
 
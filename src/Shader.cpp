@@ -1,4 +1,5 @@
 #include "Shader.h"
+#include "GlStateCache.h"
 #include "OpenGlUtils.h"
 
 #include <fstream>
@@ -13,7 +14,7 @@ Shader::Shader(const std::string &filename)
 
 Shader::~Shader()
 {
-    GL_CALL(glDeleteProgram(m_RendererId));
+    CurrentGlState().DeleteProgram(m_RendererId);
     LOG(LogLevel::INFO, "Shader {} destroyed", m_Filepath);
 }
 
@@ -106,19 +107,26 @@ ShaderProgramSource Shader::ParseShader(const std::string& filepath)
 
 void Shader::Bind() const
 {
-    GL_CALL(glUseProgram(m_RendererId));
+    CurrentGlState().UseProgram(m_RendererId);
     //LOG(LogLevel::DEBUG, "Shader {} bound", m_Filepath);
 }
 
 void Shader::Unbind() const
 {
-    GL_CALL(glUseProgram(0));
+    CurrentGlState().UseProgram(0);
     LOG(LogLevel::DEBUG, "Shader {} unbound", m_Filepath);
 }
 
+void Shader::SetUniform2f(const std::string& name, float v0, float v1)
+{
+    const float values[] = {v0, v1};
+    CurrentGlState().SetUniform(GetUniformLocation(name), values, 2); // Skipped if the value is unchanged
+}
+
 void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
 {
-    GL_CALL(glUniform4f(GetUniformLocation(name), v0, v1, v2, v3));
+    const float values[] = {v0, v1, v2, v3};
+    CurrentGlState().SetUniform(GetUniformLocation(name), values, 4);
 }
 
 unsigned int Shader::GetUniformLocation(const std::string& name)
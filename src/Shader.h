@@ -24,7 +24,10 @@ public:
     void Bind() const;
     void Unbind() const;
 
+    inline unsigned int GetRendererId() const { return m_RendererId; }
+
     // Set uniforms
+    void SetUniform2f(const std::string& name, float v0, float v1);
     void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
 
 private: 
@@ -0,0 +1,378 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ArgumentUtils.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+bool ParseSimulationArguments(const int argc, char** argv, SimulationConfig& config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        bool valid = true;
+        if (argument == "--headless")
+        {
+            config.headless = true;
+        }
+        else if (argument == "--hz" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.stepHz) && config.stepHz > 0.0;
+        }
+        else if (argument == "--max-substeps" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.maxSubsteps) && config.maxSubsteps > 0;
+        }
+        else if (argument == "--steps" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.headlessSteps);
+        }
+        else if (argument == "--bodies" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.headlessBodies);
+        }
+        else if (argument == "--integrator" && hasValue)
+        {
+            const std::string_view name = argv[++i];
+            if      (name == "euler")  config.integrator = IntegratorType::SEMI_IMPLICIT_EULER;
+            else if (name == "verlet") config.integrator = IntegratorType::VELOCITY_VERLET;
+            else if (name == "rk4")    config.integrator = IntegratorType::RK4;
+            else                       valid = false;
+        }
+        else if (argument == "--simd" && hasValue)
+        {
+            const std::string_view name = argv[++i];
+            if      (name == "scalar") config.simdLevel = SimdLevel::SCALAR;
+            else if (name == "sse")    config.simdLevel = SimdLevel::SSE;
+            else if (name == "avx2")   config.simdLevel = SimdLevel::AVX2;
+            else                       valid = false;
+        }
+        else if (argument == "--contacts")
+        {
+            config.contacts = true;
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.threads);
+        }
+        else if (argument == "--gravity")
+        {
+            config.gravity = true;
+        }
+        else if (argument == "--theta" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.theta) && config.theta >= 0.0f;
+        }
+        else if (argument == "--no-reorder")
+        {
+            config.reorder = false;
+        }
+        else if (argument == "--window-bodies" && hasValue)
+        {
+            valid = ParseNumber(argv[++i], config.windowBodies);
+        }
+        else if (argument == "--no-vsync")
+        {
+            config.vsync = false;
+        }
+        else if (argument == "--no-persistent-map")
+        {
+            config.persistentMapping = false;
+        }
+        else if (argument == "--no-state-cache")
+        {
+            config.stateCache = false;
+        }
+        else
+        {
+            LOG(LogLevel::ERROR, "Unknown argument {}. Usage: [--headless] [--hz N] [--max-substeps N] [--steps N] [--bodies N] "
+                "[--integrator euler|verlet|rk4] [--simd scalar|sse|avx2] [--contacts] [--threads N] [--gravity] [--theta X] [--no-reorder] "
+                "[--window-bodies N] [--no-vsync] [--no-persistent-map] [--no-state-cache]", argument);
+            return false;
+        }
+
+        if (!valid)
+        {
+            LOG(LogLevel::ERROR, "Invalid value {} for {}", std::string_view(argv[i]), argument);
+            return false;
+        }
+    }
+    return true;
+}
+
+//===============================================================
+// FixedStepClock
+//===============================================================
+FixedStepClock::FixedStepClock(const double stepHz, const unsigned int maxSubsteps)
+    : m_stepSeconds(1.0 / stepHz), m_maxSubsteps(maxSubsteps)
+{
+}
+
+unsigned int FixedStepClock::Advance(const double frameSeconds)
+{
+    m_accumulator += frameSeconds;
+
+    unsigned int steps = static_cast<unsigned int>(m_accumulator / m_stepSeconds);
+    if (steps > m_maxSubsteps)
+    {
+        // Falling behind: run the most we allow and let the simulation slow down instead of
+        // spending even longer on the next frame trying to catch up
+        m_skippedSteps += steps - m_maxSubsteps;
+        steps = m_maxSubsteps;
+        m_accumulator = 0.0;
+        return steps;
+    }
+
+    m_accumulator -= steps * m_stepSeconds;
+    return steps;
+}
+
+//===============================================================
+// Simulation
+//===============================================================
+Simulation::Simulation(BodyStore& bodies, const IntegratorType integrator, const SimdLevel simdLevel)
+    : m_bodies(bodies), m_integrator(integrator, simdLevel)
+{
+}
+
+// Bodies per integration job and per interpolation job, multiples of the arrays' padding
+static constexpr size_t INTEGRATE_GRAIN   = 8192;
+static constexpr size_t INTERPOLATE_GRAIN = 16384;
+
+void Simulation::Step(const float dt)
+{
+    PROFILE_SCOPE("PhysicsStep");
+
+    // Before anything reads the positions, so the whole step sees the new order. The previous positions
+    // are copied from it below.
+    if (m_reorderEnabled)
+    {
+        m_reorder.Update(m_bodies, m_jobs);
+    }
+
+    const size_t size = m_bodies.Size();
+    if (m_jobs == nullptr)
+    {
+        SavePreviousPositions();
+        if (m_gravityEnabled)
+        {
+            ComputeGravity();
+        }
+        if (m_contactsEnabled)
+        {
+            m_broadphase.Update(m_bodies);
+            m_contactSolver.Solve(m_bodies, m_broadphase.GetPairs(), dt);
+        }
+        Integrate(dt, 0, size);
+        ++m_stepCount;
+        return;
+    }
+
+    // Saving the positions and gravity only read them, so they overlap the broadphase. Integrating
+    // moves the bodies, so it waits for the copy, gravity and the solve.
+    JobCounter broadphaseDone;
+    JobCounter readyToIntegrate;
+    JobCounter integrated;
+    m_jobs->Schedule(readyToIntegrate, [this] { SavePreviousPositions(); });
+    if (m_gravityEnabled)
+    {
+        m_jobs->Schedule(readyToIntegrate, [this] { ComputeGravity(); });
+    }
+    if (m_contactsEnabled)
+    {
+        m_jobs->Schedule(broadphaseDone, [this]
+        {
+            PROFILE_SCOPE("Broadphase");
+            m_broadphase.Update(m_bodies);
+        });
+        m_jobs->Schedule(readyToIntegrate, [this, dt]
+        {
+            PROFILE_SCOPE("ContactSolve");
+            m_contactSolver.Solve(m_bodies, m_broadphase.GetPairs(), dt, m_jobs);
+        }, &broadphaseDone);
+    }
+    m_jobs->Schedule(integrated, [this, dt, size]
+    {
+        m_jobs->ParallelFor(size, INTEGRATE_GRAIN, [&](const size_t begin, const size_t end) { Integrate(dt, begin, end); });
+    }, &readyToIntegrate);
+    m_jobs->Wait(integrated);
+    ++m_stepCount;
+}
+
+void Simulation::SavePreviousPositions()
+{
+    PROFILE_SCOPE("SavePositions");
+
+    const size_t size = m_bodies.Size();
+    const float* const x = m_bodies.X();
+    const float* const y = m_bodies.Y();
+    m_previousX.reserve(m_bodies.Capacity(), 0);
+    m_previousY.reserve(m_bodies.Capacity(), 0);
+    std::copy(x, x + size, m_previousX.data());
+    std::copy(y, y + size, m_previousY.data());
+    m_previousSize = size;
+}
+
+void Simulation::ComputeGravity()
+{
+    m_accelerationX.reserve(m_bodies.Capacity(), 0);
+    m_accelerationY.reserve(m_bodies.Capacity(), 0);
+    m_gravity.Build(m_bodies, m_jobs);
+    m_gravity.ComputeAccelerations(m_accelerationX.data(), m_accelerationY.data(), m_jobs);
+}
+
+void Simulation::Integrate(const float dt, const size_t begin, const size_t end)
+{
+    PROFILE_SCOPE("Integrate");
+
+    // The kernels round the count up to their SIMD width, which stays inside the padding
+    IntegratorArrays arrays;
+    arrays.x     = m_bodies.X() + begin;
+    arrays.y     = m_bodies.Y() + begin;
+    arrays.vx    = m_bodies.VX() + begin;
+    arrays.vy    = m_bodies.VY() + begin;
+    arrays.ax    = m_gravityEnabled ? m_accelerationX.data() + begin : nullptr;
+    arrays.ay    = m_gravityEnabled ? m_accelerationY.data() + begin : nullptr;
+    arrays.flags = m_bodies.Flags() + begin;
+    arrays.count = end - begin;
+    m_integrator.Step(arrays, dt, m_forces);
+}
+
+void Simulation::InterpolatePositions(const float alpha, float* out) const
+{
+    const size_t size = m_bodies.Size();
+    const float* const x = m_bodies.X();
+    const float* const y = m_bodies.Y();
+
+    // Bodies were added or removed since the last step, so there is nothing to interpolate from
+    if (m_previousSize != size)
+    {
+        m_bodies.CopyPositionsInterleaved(out);
+        return;
+    }
+
+    const auto interpolate = [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float dx = x[i] - m_previousX[i];
+            const float dy = y[i] - m_previousY[i];
+
+            // A body that wrapped around the world would be drawn sweeping across it, so show it where it is now
+            out[2 * i]     = (std::fabs(dx) < 0.5f * WORLD_SIZE) ? m_previousX[i] + dx * alpha : x[i];
+            out[2 * i + 1] = (std::fabs(dy) < 0.5f * WORLD_SIZE) ? m_previousY[i] + dy * alpha : y[i];
+        }
+    };
+
+    if (m_jobs != nullptr)
+    {
+        m_jobs->ParallelFor(size, INTERPOLATE_GRAIN, interpolate);
+    }
+    else
+    {
+        interpolate(0, size);
+    }
+}
+
+//===============================================================
+// Headless mode
+//===============================================================
+void AddRandomBodies(BodyStore& bodies, const size_t count, const bool contacts)
+{
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+    std::uniform_real_distribution<float> velocity(-0.25f, 0.25f);
+    const float coverRadius = std::sqrt(WORLD_SIZE * WORLD_SIZE / (3.0f * 3.14159265f * std::max<size_t>(count, 1)));
+    const float radius = contacts ? std::min(BODY_DEFAULT_RADIUS, coverRadius) : BODY_DEFAULT_RADIUS;
+    bodies.Reserve(bodies.Size() + count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        bodies.Add(position(random), position(random), velocity(random), velocity(random), 1.0f, BODY_FLAG_NONE, radius);
+    }
+}
+
+int RunHeadlessSimulation(const SimulationConfig& config)
+{
+    BodyStore bodies(config.headlessBodies);
+    AddRandomBodies(bodies, config.headlessBodies, config.contacts);
+
+    JobSystem jobs(config.threads);
+    Simulation simulation(bodies, config.integrator, config.simdLevel);
+    simulation.SetJobSystem(&jobs);
+    if (config.contacts)
+    {
+        simulation.EnableContacts();
+    }
+    if (config.gravity)
+    {
+        GravitySettings gravity;
+        gravity.openingAngle = config.theta;
+        simulation.EnableGravity(gravity);
+    }
+    if (config.reorder)
+    {
+        simulation.EnableReordering();
+    }
+    LOG(LogLevel::INFO, "Running headless: {} bodies, {} steps at {} Hz, {} integrator ({}), contacts {}, gravity {}, {} threads",
+        config.headlessBodies, config.headlessSteps, config.stepHz, IntegratorTypeToString(config.integrator),
+        SimdLevelToString(simulation.GetIntegrator().GetSimdLevel()), config.contacts ? "on" : "off",
+        config.gravity ? std::format("theta {}", config.theta) : std::string("off"), jobs.GetThreadCount());
+
+    const float dt = static_cast<float>(1.0 / config.stepHz);
+
+    // Discard the setup time so the utilization covers only the steps
+    jobs.GetStats();
+
+    // Every step is a frame, so the profiler reports and traces work the same as with a window
+    uint64_t stepTicks = 0;
+    Timer runTimer{false};
+    runTimer.Start();
+    for (size_t step = 0; step < config.headlessSteps; ++step)
+    {
+        const uint64_t stepStart = Timer::Ticks();
+        simulation.Step(dt);
+        stepTicks += Timer::Ticks() - stepStart;
+
+        if (profilerPtr != nullptr)
+        {
+            profilerPtr->EndFrame();
+        }
+    }
+    const std::chrono::microseconds runTime = runTimer.Stop();
+
+    const double steps = static_cast<double>(config.headlessSteps > 0 ? config.headlessSteps : 1);
+    const double stepUs = Timer::TicksToNanoseconds(stepTicks) * 1e-3 / steps;
+    const double runSeconds = runTime.count() * 1e-6;
+    LOG(LogLevel::INFO, "Headless run finished in {:.3f}s: step avg = {:.1f}us, {:.0f} steps/s, {:.3e} body steps/s",
+        runSeconds, stepUs, steps / runSeconds, steps * config.headlessBodies / runSeconds);
+    if (config.contacts)
+    {
+        const ContactSolver& solver = simulation.GetContactSolver();
+        LOG(LogLevel::INFO, "Last step: {} contacts in {} colors, {} warm started", solver.GetContactCount(), solver.GetColorCount(),
+            solver.GetWarmStartedCount());
+    }
+    if (config.gravity)
+    {
+        const BarnesHutTree& gravity = simulation.GetGravity();
+        LOG(LogLevel::INFO, "Last step: {} tree nodes, {} leaves, {:.0f} interactions per body", gravity.GetNodeCount(),
+            gravity.GetLeafCount(), static_cast<double>(gravity.GetInteractionCount()) / std::max<size_t>(bodies.Size(), 1));
+    }
+    if (config.reorder)
+    {
+        const BodyReorder& reorder = simulation.GetReorder();
+        LOG(LogLevel::INFO, "Reordered {} times, disorder at the last check {:.3f}, checking every {} steps", reorder.GetReorderCount(),
+            reorder.GetLastDisorder(), reorder.GetCheckInterval());
+    }
+    LogJobStats(jobs.GetStats());
+    return 0;
+}
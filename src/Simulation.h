@@ -0,0 +1,160 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+// Simulation.h
+// This file contains the physics loop that is decoupled from rendering.
+// The Simulation advances the BodyStore in fixed steps of 1/stepHz seconds. The
+// FixedStepClock turns the real time each rendered frame took into a whole number of
+// those steps (at most maxSubsteps, so a slow frame can't cause ever longer frames),
+// and carries the remainder over to the next frame. The renderer draws the bodies
+// interpolated between the last two steps, so motion stays smooth at any display rate.
+// With contacts enabled, every step first finds the overlapping bodies with a
+// broadphase and lets the ContactSolver push them apart before they are integrated.
+// Before a step the BodyReorder may sort the bodies along the Z-order curve, so bodies
+// that are close in space stay close in memory for everything that follows.
+// With gravity enabled, a Barnes-Hut tree gives every body its acceleration towards all
+// the others, which the integrator adds to the force field.
+// Given a JobSystem, a step is a small job graph: saving the previous positions, the
+// broadphase and gravity run side by side, the solve waits for the broadphase, and the
+// integration (split into ranges) waits for all of them. Interpolating the vertex
+// positions is split into ranges too.
+// In headless mode there is no window at all, and the simulation steps as fast as
+// it can so its throughput can be measured.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BarnesHut.h"
+#include "BodyReorder.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "ContactSolver.h"
+#include "Integrator.h"
+#include "JobSystem.h"
+
+// Settings of the physics loop, filled in from the command line
+struct SimulationConfig
+{
+    double       stepHz        = 120.0; // Fixed physics steps per simulated second
+    unsigned int maxSubsteps   = 8;     // Most steps run for one rendered frame
+    bool         headless      = false; // Run without a window, as fast as possible
+    size_t       headlessSteps = 10000; // Steps to run in headless mode
+    size_t       headlessBodies = 100000; // Bodies to simulate in headless mode
+    IntegratorType integrator  = IntegratorType::SEMI_IMPLICIT_EULER;
+    SimdLevel    simdLevel     = SimdLevel::AVX2; // Widest instruction set to use, lowered to what the CPU supports
+    bool         contacts      = false; // Collide the bodies with each other
+    unsigned int threads       = 0;     // Threads running physics jobs, 0 for every hardware thread
+    bool         gravity       = false; // Bodies attract each other
+    float        theta         = 0.7f;  // Barnes-Hut opening angle
+    bool         reorder       = true;  // Keep the bodies sorted by Morton code
+    size_t       windowBodies  = 0;     // Bodies scattered over the world in windowed mode, besides the four of the quad
+    bool         vsync         = true;  // Wait for the display between frames, off to measure rendering
+    bool         persistentMapping = true; // Map the instance buffers persistently where GL 4.4 or ARB_buffer_storage allows
+    bool         stateCache    = true;  // Skip GL calls that don't change the state, off to compare
+};
+
+// Parse the program arguments into config. Returns false (after logging why) if they are invalid.
+// Supported: --headless, --hz <steps per second>, --max-substeps <n>, --steps <n>, --bodies <n>,
+// --integrator <euler|verlet|rk4>, --simd <scalar|sse|avx2>, --contacts, --threads <n>, --gravity, --theta <angle>,
+// --no-reorder, --window-bodies <n>, --no-vsync, --no-persistent-map, --no-state-cache
+bool ParseSimulationArguments(int argc, char** argv, SimulationConfig& config);
+
+// Turns real frame times into a number of fixed steps
+class FixedStepClock
+{
+public:
+    FixedStepClock(double stepHz, unsigned int maxSubsteps);
+
+    // Add the real time the last frame took and return how many steps to run now
+    unsigned int Advance(double frameSeconds);
+
+    // How far the simulation is between the last step and the next one, in [0, 1)
+    float Alpha() const { return static_cast<float>(m_accumulator / m_stepSeconds); }
+
+    double StepSeconds() const { return m_stepSeconds; }
+
+    // Steps that were skipped because a frame needed more than maxSubsteps
+    uint64_t GetSkippedSteps() const { return m_skippedSteps; }
+
+private:
+    double       m_stepSeconds;
+    unsigned int m_maxSubsteps;
+    double       m_accumulator = 0.0;
+    uint64_t     m_skippedSteps = 0;
+};
+
+class Simulation
+{
+public:
+    explicit Simulation(BodyStore& bodies, IntegratorType integrator = IntegratorType::SEMI_IMPLICIT_EULER, SimdLevel simdLevel = SimdLevel::AVX2);
+
+    // Advance every body by one fixed step of dt seconds
+    void Step(float dt);
+
+    // Write positions interpolated between the previous and the current step as interleaved x,y pairs
+    // (2 * bodies.Size() floats). alpha is FixedStepClock::Alpha().
+    void InterpolatePositions(float alpha, float* out) const;
+
+    // Show the bodies at their current positions until the next step, for when they were moved outside Step
+    void ResetInterpolation() { m_previousSize = 0; }
+
+    void SetForceField(const ForceField& forces) { m_forces = forces; }
+
+    // Run steps and interpolation as jobs, or on the calling thread if jobs is nullptr
+    void SetJobSystem(JobSystem* jobs) { m_jobs = jobs; }
+
+    // Collide the bodies before integrating them
+    void EnableContacts() { m_contactsEnabled = true; }
+    void DisableContacts() { m_contactsEnabled = false; }
+
+    // Let the bodies attract each other
+    void EnableGravity(const GravitySettings& settings = {}) { m_gravityEnabled = true; m_gravity.SetSettings(settings); }
+    void DisableGravity() { m_gravityEnabled = false; }
+
+    // Sort the bodies by Morton code whenever their order has degraded. Array indices kept outside the
+    // simulation go stale when it does, handles don't.
+    void EnableReordering(const ReorderSettings& settings = {}) { m_reorderEnabled = true; m_reorder.SetSettings(settings); }
+    void DisableReordering() { m_reorderEnabled = false; }
+
+    const Integrator&    GetIntegrator()    const { return m_integrator; }
+    const ContactSolver& GetContactSolver() const { return m_contactSolver; }
+    const BarnesHutTree& GetGravity()       const { return m_gravity; }
+    const BodyReorder&   GetReorder()       const { return m_reorder; }
+    uint64_t             GetStepCount()     const { return m_stepCount; }
+
+private:
+    BodyStore&            m_bodies;
+    Integrator            m_integrator;
+    ForceField            m_forces;
+    UniformGridBroadphase m_broadphase;
+    ContactSolver         m_contactSolver;
+    JobSystem*            m_jobs = nullptr;
+    bool                  m_contactsEnabled = false;
+    BarnesHutTree         m_gravity;
+    bool                  m_gravityEnabled = false;
+    AlignedArray<float>   m_accelerationX; // From gravity, by array index
+    AlignedArray<float>   m_accelerationY;
+    BodyReorder           m_reorder;
+    bool                  m_reorderEnabled = false;
+    AlignedArray<float>   m_previousX; // Positions before the last step, for interpolation
+    AlignedArray<float>   m_previousY;
+    size_t                m_previousSize = 0;
+    uint64_t              m_stepCount = 0;
+
+    // Copy the positions before the step, for interpolation
+    void SavePreviousPositions();
+
+    // Fill the acceleration arrays with the pull of gravity
+    void ComputeGravity();
+
+    // Integrate the bodies [begin, end), begin must be a multiple of the arrays' padding
+    void Integrate(float dt, size_t begin, size_t end);
+};
+
+// Scatter count bodies over the world with a fixed seed, so runs can be compared. With contacts they are
+// shrunk to cover about a third of the world, so most bodies touch a few others instead of hundreds.
+void AddRandomBodies(BodyStore& bodies, size_t count, bool contacts);
+
+// Run the simulation without a window and log its throughput. Returns the process exit code.
+int RunHeadlessSimulation(const SimulationConfig& config);
+
+#endif // !SIMULATION_H
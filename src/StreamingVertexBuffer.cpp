@@ -0,0 +1,158 @@
+#include "StreamingVertexBuffer.h"
+
+#include "GlStateCache.h"
+#include "OpenGlUtils.h"
+
+// How long one wait for a fence lasts before checking again, in nanoseconds
+static constexpr GLuint64 FENCE_WAIT_TIMEOUT = 100'000'000;
+
+StreamingVertexBuffer::StreamingVertexBuffer(const unsigned int regionSize, const bool allowPersistent)
+    : m_persistent(allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage))
+{
+    Allocate(regionSize);
+    LOG(LogLevel::INFO, "Streaming vertex buffer of {} x {} bytes, {} mapping", REGION_COUNT, m_regionSize,
+        m_persistent ? "persistent" : "per frame");
+}
+
+StreamingVertexBuffer::~StreamingVertexBuffer()
+{
+    Release();
+}
+
+void StreamingVertexBuffer::Allocate(const unsigned int regionSize)
+{
+    // Keep every region's offset aligned for any attribute type
+    m_regionSize = (regionSize + 63u) & ~63u;
+    const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(m_regionSize) * REGION_COUNT;
+
+    GL_CALL(glGenBuffers(1, &m_RendererId));
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+    if (m_persistent)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GL_CALL(glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags));
+        GL_CALL(m_persistentData = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags)));
+        if (m_persistentData != nullptr)
+        {
+            return;
+        }
+
+        // Immutable storage can't be given to glBufferData, so map every frame from a new buffer instead
+        LOG(LogLevel::WARNING, "Persistent mapping of a streaming vertex buffer failed, mapping it every frame instead");
+        m_persistent = false;
+        CurrentGlState().DeleteBuffer(m_RendererId);
+        GL_CALL(glGenBuffers(1, &m_RendererId));
+        CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+    }
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW));
+}
+
+void StreamingVertexBuffer::Release()
+{
+    for (unsigned int region = 0; region < REGION_COUNT; ++region)
+    {
+        if (m_fences[region] != nullptr)
+        {
+            GL_CALL(glDeleteSync(m_fences[region]));
+            m_fences[region] = nullptr;
+        }
+    }
+    if (m_persistentData != nullptr || m_mapped)
+    {
+        CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+        GL_CALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+        m_persistentData = nullptr;
+        m_mapped = false;
+    }
+    CurrentGlState().DeleteBuffer(m_RendererId);
+    m_RendererId = 0;
+}
+
+void StreamingVertexBuffer::WaitForRegion(const unsigned int region)
+{
+    GLsync& fence = m_fences[region];
+    if (fence == nullptr)
+    {
+        return;
+    }
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        // The GPU is a whole ring behind, flush so the fence is sure to be reached and wait for it
+        ++m_waitCount;
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    if (status == GL_WAIT_FAILED)
+    {
+        LOG(LogLevel::ERROR, "Waiting for a streaming vertex buffer fence failed");
+    }
+    GL_CALL(glDeleteSync(fence));
+    fence = nullptr;
+}
+
+void* StreamingVertexBuffer::Map(const unsigned int size)
+{
+    if (size > m_regionSize)
+    {
+        // Everything drawn from the old buffer must be done before it goes. Grow by half again,
+        // so a slowly growing body count doesn't reallocate every frame.
+        for (unsigned int region = 0; region < REGION_COUNT; ++region)
+        {
+            WaitForRegion(region);
+        }
+        Release();
+        Allocate(size + size / 2);
+        m_region = REGION_COUNT - 1;
+    }
+
+    m_region = (m_region + 1) % REGION_COUNT;
+    WaitForRegion(m_region);
+
+    if (m_persistent)
+    {
+        return m_persistentData + GetOffset();
+    }
+
+    // The fence already guarantees the GPU is done with the region, so the driver doesn't need to synchronize
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+    GL_CALL(void* data = glMapBufferRange(GL_ARRAY_BUFFER, GetOffset(), m_regionSize, flags));
+    m_mapped = data != nullptr;
+    return data;
+}
+
+void StreamingVertexBuffer::Unmap()
+{
+    // Coherent persistent memory is seen by the GPU without any call
+    if (m_persistent || !m_mapped)
+    {
+        return;
+    }
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+    GL_CALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+    m_mapped = false;
+}
+
+void StreamingVertexBuffer::Fence()
+{
+    // Drawn again since the last fence, only the latest draw matters
+    if (m_fences[m_region] != nullptr)
+    {
+        GL_CALL(glDeleteSync(m_fences[m_region]));
+    }
+    GL_CALL(m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void StreamingVertexBuffer::Bind() const
+{
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
+}
+
+void StreamingVertexBuffer::Unbind() const
+{
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,75 @@
+#ifndef STREAMING_VERTEX_BUFFER_H
+#define STREAMING_VERTEX_BUFFER_H
+// StreamingVertexBuffer.h
+// This file contains a vertex buffer for data that is rewritten every frame.
+// The buffer is split into REGION_COUNT regions used as a ring: each frame writes the
+// next region while the GPU may still be drawing from the previous ones, and a fence
+// inserted after the draws that read a region tells when it may be written again. The
+// CPU only waits if it gets a whole ring ahead of the GPU, instead of the driver copying
+// or stalling on glBufferSubData every frame.
+// With GL 4.4 or ARB_buffer_storage the buffer is allocated with glBufferStorage and
+// mapped once, persistently and coherently, so Map just returns a pointer into it and the
+// data is written straight into memory the GPU reads. On plain GL 3.3 core each region
+// is mapped with glMapBufferRange, unsynchronized (the fences already keep the GPU off
+// it) and with its old contents invalidated, and unmapped again when written.
+// Attributes read from the region at GetOffset(), with a VertexArray per region (see
+// VertexArrayCache), since the offset is recorded in the VAO.
+
+// C++ Standard Library includes
+#include <cstdint>
+
+// External Libraries includes
+#include <GL/glew.h>
+
+class StreamingVertexBuffer
+{
+public:
+    static constexpr unsigned int REGION_COUNT = 3;
+
+    // regionSize bytes per region to start with, Map grows them. Persistent mapping is used
+    // if allowPersistent and the context supports it.
+    explicit StreamingVertexBuffer(unsigned int regionSize, bool allowPersistent = true);
+    ~StreamingVertexBuffer();
+
+    StreamingVertexBuffer(const StreamingVertexBuffer&) = delete;
+    StreamingVertexBuffer& operator=(const StreamingVertexBuffer&) = delete;
+
+    // Move on to the next region and return memory to write size bytes of it to. Waits if the
+    // GPU hasn't finished drawing from that region yet. Reallocates the buffer (a new buffer ID)
+    // if size doesn't fit in a region.
+    void* Map(unsigned int size);
+
+    // Done writing the mapped region, the next draws read it
+    void Unmap();
+
+    // Call after issuing the draws that read the current region
+    void Fence();
+
+    void Bind() const;
+    void Unbind() const;
+
+    unsigned int GetRendererId() const { return m_RendererId; }
+    unsigned int GetOffset()     const { return m_region * m_regionSize; } // Of the current region, in bytes
+    bool         IsPersistent()  const { return m_persistent; }
+
+    // Statistics
+    uint64_t GetWaitCount() const { return m_waitCount; } // Maps that had to wait for the GPU
+
+private:
+    unsigned int m_RendererId = 0; // OpenGL buffer ID
+    unsigned int m_regionSize = 0;
+    unsigned int m_region = REGION_COUNT - 1;
+    bool         m_persistent = false;
+    bool         m_mapped = false;
+    uint8_t*     m_persistentData = nullptr; // Start of the whole buffer when mapped persistently
+    GLsync       m_fences[REGION_COUNT] = {};
+    uint64_t     m_waitCount = 0;
+
+    void Allocate(unsigned int regionSize);
+    void Release();
+
+    // Wait until the GPU is done with the region and drop its fence
+    void WaitForRegion(unsigned int region);
+};
+
+#endif // !STREAMING_VERTEX_BUFFER_H
@@ -0,0 +1,80 @@
+#ifndef THREAD_UTILS_H
+#define THREAD_UTILS_H
+// ThreadUtils.h
+// Small helpers shared by the lock-free containers and the threads that spin on them.
+
+#include <cstddef>
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+// Size used to pad atomics that are written by different threads so they never share a cache line.
+// 64 bytes covers x86 and most ARM cores; Apple Silicon pairs lines, but 64 still avoids the worst of it.
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Tell the CPU we are in a spin-wait loop (reduces power and pipeline flushes on the way out of the loop)
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    asm volatile("yield" ::: "memory");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Adaptive wait strategy for threads polling a lock-free queue.
+// Each call to Pause() escalates from busy spinning, to yielding the time slice, to sleeping
+// for progressively longer periods. Call Reset() as soon as work is found again.
+class Backoff
+{
+public:
+    void Pause()
+    {
+        if (m_iteration < SPIN_ITERATIONS)
+        {
+            for (unsigned int i = 0; i < (1u << (m_iteration % 6)); ++i)
+            {
+                CpuRelax();
+            }
+        }
+        else if (m_iteration < SPIN_ITERATIONS + YIELD_ITERATIONS)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(m_sleepTime);
+            if (m_sleepTime < MAX_SLEEP_TIME)
+            {
+                m_sleepTime *= 2;
+            }
+            return; // Stay in the sleeping phase
+        }
+        ++m_iteration;
+    }
+
+    void Reset()
+    {
+        m_iteration = 0;
+        m_sleepTime = MIN_SLEEP_TIME;
+    }
+
+    // True once the backoff has escalated past spinning and yielding
+    bool IsSleeping() const { return m_iteration >= SPIN_ITERATIONS + YIELD_ITERATIONS; }
+
+private:
+    static constexpr unsigned int SPIN_ITERATIONS  = 64;
+    static constexpr unsigned int YIELD_ITERATIONS = 16;
+    static constexpr std::chrono::microseconds MIN_SLEEP_TIME{50};
+    static constexpr std::chrono::microseconds MAX_SLEEP_TIME{1000};
+
+    unsigned int              m_iteration = 0;
+    std::chrono::microseconds m_sleepTime = MIN_SLEEP_TIME;
+};
+
+#endif // !THREAD_UTILS_H
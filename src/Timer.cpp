@@ -5,6 +5,64 @@
 
 #include "Logger.h"
 
+namespace
+{
+    // Relation between Ticks() and the system clock, measured once
+    struct TickCalibration
+    {
+        double   nanosecondsPerTick;
+        uint64_t baseTicks;
+        std::chrono::time_point<std::chrono::system_clock> baseTime;
+    };
+
+    TickCalibration Calibrate()
+    {
+        TickCalibration calibration;
+#if defined(TIMER_TICKS_TSC)
+        // The TSC rate isn't exposed portably, so measure it against steady_clock over a short window
+        const auto     steadyStart = std::chrono::steady_clock::now();
+        const uint64_t ticksStart  = Timer::Ticks();
+        while (std::chrono::steady_clock::now() - steadyStart < std::chrono::milliseconds(20))
+        {
+        }
+        const uint64_t ticksEnd  = Timer::Ticks();
+        const auto     steadyEnd = std::chrono::steady_clock::now();
+        calibration.nanosecondsPerTick = std::chrono::duration<double, std::nano>(steadyEnd - steadyStart).count() 
+                                         / static_cast<double>(ticksEnd - ticksStart);
+#elif defined(TIMER_TICKS_ARM_COUNTER)
+        // The counter frequency is published by the hardware
+        uint64_t frequency;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+        calibration.nanosecondsPerTick = 1e9 / static_cast<double>(frequency);
+#else
+        calibration.nanosecondsPerTick = 1e9 * std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+#endif
+        // Pair a tick value with the wall clock time taken right after it
+        calibration.baseTicks = Timer::Ticks();
+        calibration.baseTime  = std::chrono::system_clock::now();
+        return calibration;
+    }
+
+    const TickCalibration& GetCalibration()
+    {
+        static const TickCalibration calibration = Calibrate(); // Thread safe one time initialization
+        return calibration;
+    }
+}
+
+double Timer::TicksToNanoseconds(const uint64_t ticks)
+{
+    return static_cast<double>(ticks) * GetCalibration().nanosecondsPerTick;
+}
+
+std::chrono::time_point<std::chrono::system_clock> Timer::TicksToSystemTime(const uint64_t ticks)
+{
+    const TickCalibration& calibration = GetCalibration();
+    const double offsetNs = static_cast<double>(static_cast<int64_t>(ticks - calibration.baseTicks)) * calibration.nanosecondsPerTick;
+    return calibration.baseTime + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                      std::chrono::duration<double, std::nano>(offsetNs));
+}
+
 void Timer::Start()
 {
     // Get the start time
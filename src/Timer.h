@@ -2,8 +2,20 @@
 #define TIMER_H
 
 #include <chrono> 
+#include <cstdint>
 #include <mutex>
 
+#if defined(__x86_64__) || defined(_M_X64)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define TIMER_TICKS_TSC 1
+#elif defined(__aarch64__)
+    #define TIMER_TICKS_ARM_COUNTER 1
+#endif
+
 class Timer
 {
 public:
@@ -13,6 +25,29 @@ public:
     void                      Start();
     std::chrono::microseconds Stop(const int id = -1);
 
+    // Cheap monotonic tick counter for timestamps that are taken on hot paths.
+    // Uses the TSC on x86-64 and the generic timer counter on ARM64, which both cost a few
+    // nanoseconds and don't go through the OS, and falls back to steady_clock nanoseconds.
+    static inline uint64_t Ticks()
+    {
+#if defined(TIMER_TICKS_TSC)
+        return __rdtsc();
+#elif defined(TIMER_TICKS_ARM_COUNTER)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Convert a difference between two Ticks() values to nanoseconds
+    static double TicksToNanoseconds(uint64_t ticks);
+
+    // Convert a Ticks() value to wall clock time.
+    // The tick rate and its offset to the system clock are calibrated once, on first use.
+    static std::chrono::time_point<std::chrono::system_clock> TicksToSystemTime(uint64_t ticks);
+
 private: 
     using MsTimer = std::chrono::time_point<std::chrono::high_resolution_clock>;
        
@@ -0,0 +1,156 @@
+#include "TraceWriter.h"
+
+#include <format>
+#include <iterator>
+#include <string_view>
+
+#include "ThreadUtils.h"
+#include "Timer.h"
+
+// Append a string with the characters JSON requires escaped
+static void AppendJsonString(std::string& out, const std::string_view text)
+{
+    out += '"';
+    for (const char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            out += '\\';
+        }
+        out += character;
+    }
+    out += '"';
+}
+
+TraceWriter::TraceWriter(const std::string& filepath)
+    : m_file(filepath, false), m_baseTicks(Timer::Ticks())
+{
+    m_writeBatch.reserve(WRITE_BATCH_BYTES + 4096);
+    // Every event after this one starts with a comma, so the list stays valid JSON
+    m_writeBatch += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    m_writeBatch += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"PhysicsSim\"}}";
+    m_writerThread = std::thread(&TraceWriter::RunWriter, this);
+}
+
+TraceWriter::~TraceWriter()
+{
+    // Tell the writer thread to finish up
+    m_finishWriting = true;
+
+    // Wait for the thread to write everything that was submitted
+    m_writerThread.join();
+}
+
+void TraceWriter::Submit(std::vector<TraceEvent>& events)
+{
+    {
+        std::lock_guard pendingLock(m_pendingMutex);
+        if (m_pending.size() + events.size() <= MAX_PENDING_EVENTS)
+        {
+            m_pending.insert(m_pending.end(), events.begin(), events.end());
+        }
+        else
+        {
+            m_droppedEvents.fetch_add(events.size(), std::memory_order_relaxed);
+        }
+    }
+    events.clear();
+}
+
+void TraceWriter::RunWriter()
+{
+    // Run loop until the class is being destroyed, then write whatever is left
+    Backoff idleBackoff;
+    while (true)
+    {
+        if (WritePending() > 0)
+        {
+            idleBackoff.Reset();
+            continue;
+        }
+
+        if (m_finishWriting)
+        {
+            // Everything submitted before the flag was set is visible now
+            WritePending();
+            break;
+        }
+
+        // Nothing to do, spin then yield then sleep until a frame is submitted
+        idleBackoff.Pause();
+    }
+
+    // Close the event list so the file is valid JSON
+    m_writeBatch += "\n]}\n";
+    WriteBatch();
+}
+
+size_t TraceWriter::WritePending()
+{
+    {
+        std::lock_guard pendingLock(m_pendingMutex);
+        m_writing.swap(m_pending);
+    }
+
+    for (const TraceEvent& event : m_writing)
+    {
+        AppendEvent(event);
+        if (m_writeBatch.size() >= WRITE_BATCH_BYTES)
+        {
+            WriteBatch();
+        }
+    }
+
+    const size_t written = m_writing.size();
+    m_writing.clear();
+    return written;
+}
+
+void TraceWriter::AppendEvent(const TraceEvent& event)
+{
+    // Zones that ended before the writer was created, like the ones the logging thread records at startup
+    if (event.zone != nullptr && event.endTicks <= m_baseTicks)
+    {
+        return;
+    }
+
+    auto out = std::back_inserter(m_writeBatch);
+
+    // Name every thread the first time it shows up
+    if (event.threadId >= m_namedThreads.size())
+    {
+        m_namedThreads.resize(event.threadId + 1, false);
+    }
+    if (!m_namedThreads[event.threadId])
+    {
+        std::format_to(out, ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{0},\"args\":{{\"name\":\"Thread {0}\"}}}}",
+            event.threadId);
+        m_namedThreads[event.threadId] = true;
+    }
+
+    // Zones that were already open when the writer was created start at 0
+    const uint64_t beginTicks = event.beginTicks > m_baseTicks ? event.beginTicks : m_baseTicks;
+    const double   beginUs = Timer::TicksToNanoseconds(beginTicks - m_baseTicks) * 1e-3;
+    if (event.zone == nullptr)
+    {
+        // Frame boundary, shown as a global instant event
+        std::format_to(out, ",\n{{\"name\":\"Frame {}\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":{},\"ts\":{:.3f}}}",
+            m_frameIndex++, event.threadId, beginUs);
+        return;
+    }
+
+    const double durationUs = Timer::TicksToNanoseconds(event.endTicks - beginTicks) * 1e-3;
+    m_writeBatch += ",\n{\"name\":";
+    AppendJsonString(m_writeBatch, event.zone->name);
+    std::format_to(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"depth\":{},\"line\":{}}}}}",
+        event.threadId, beginUs, durationUs, event.depth, event.zone->lineNumber);
+}
+
+void TraceWriter::WriteBatch()
+{
+    if (!m_writeBatch.empty())
+    {
+        m_file.Write(m_writeBatch);
+        m_writeBatch.clear();
+    }
+}
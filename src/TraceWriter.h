@@ -0,0 +1,82 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+// TraceWriter.h
+// This file contains the definition of the TraceWriter class.
+// The TraceWriter streams the zones recorded by the Profiler to a Chrome Trace Event
+// JSON file, which can be opened in chrome://tracing, Perfetto (ui.perfetto.dev) or
+// any other viewer that understands the format.
+// Profiler::EndFrame hands each frame's events over in one call, and a dedicated
+// writer thread turns them into JSON and writes them to disk in large batches, so
+// the frame itself only pays for copying the raw events.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LogSinks.h"
+#include "Profiler.h"
+
+// One zone (or frame boundary) on its way to the trace file
+struct TraceEvent
+{
+    const ProfileZone* zone = nullptr; // nullptr marks the end of a frame
+    uint64_t           beginTicks = 0;
+    uint64_t           endTicks = 0;
+    uint32_t           threadId = 0;   // Profiler's index of the recording thread
+    uint32_t           depth = 0;
+};
+
+class TraceWriter
+{
+public:
+    explicit TraceWriter(const std::string& filepath);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Queue a frame's worth of events for the writer thread and empty the vector.
+    // Called by Profiler::EndFrame.
+    void Submit(std::vector<TraceEvent>& events);
+
+    // Number of events dropped because the writer thread fell too far behind
+    size_t GetDroppedEventCount() const { return m_droppedEvents.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MAX_PENDING_EVENTS = 1024 * 1024; // Events waiting for the writer before new ones are dropped
+    static constexpr size_t WRITE_BATCH_BYTES  = 256 * 1024;  // JSON collected before it is written to the file
+
+    FileSink                m_file;
+    const uint64_t          m_baseTicks; // Trace timestamps are relative to the writer's creation
+    std::atomic<bool>       m_finishWriting = false;
+    std::atomic<size_t>     m_droppedEvents = 0;
+
+    std::mutex              m_pendingMutex; // Taken once per frame by Submit and once per pass by the writer
+    std::vector<TraceEvent> m_pending;
+
+    // Only touched by the writer thread
+    std::vector<TraceEvent> m_writing;
+    std::vector<bool>       m_namedThreads; // Threads that already have a thread_name entry
+    std::string             m_writeBatch;
+    uint64_t                m_frameIndex = 0;
+
+    std::thread             m_writerThread;
+
+    // Function to run the writer thread
+    void RunWriter();
+
+    // Take the pending events and append them to the write batch. Returns the number of events written.
+    size_t WritePending();
+
+    // Append one event as JSON
+    void AppendEvent(const TraceEvent& event);
+
+    // Write the batch to the file
+    void WriteBatch();
+};
+
+#endif // !TRACE_WRITER_H
@@ -3,9 +3,35 @@
 #include <iostream>
 #include <format>
 #include <print>
+#include <thread>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <functional>
+#include <memory>
+#include <random>
 
 #include "Logger.h"
 #include "Timer.h"
+#include "CircularBuffer.h"
+#include "Profiler.h"
+#include "TraceWriter.h"
+#include "BodyStore.h"
+#include "Simulation.h"
+#include "Integrator.h"
+#include "Broadphase.h"
+#include "ContactSolver.h"
+#include "JobSystem.h"
+#include "BarnesHut.h"
+#include "BodyReorder.h"
+#include "PerfCounters.h"
+#include "DrawQueue.h"
 
 void LogTimerTest()
 {
@@ -107,3 +133,1622 @@ void LogTimerTest()
     LOG(LogLevel::WARNING, "-----------------------------");
 
 }
+
+void LogContentionTest()
+{
+    const unsigned int messagesPerThread = 2000;
+    const std::array<unsigned int, 5> producerCounts = {1, 2, 4, 8, 16};
+
+    struct Result
+    {
+        unsigned int producers;
+        double       avgLogNs;
+        double       messagesPerSecond;
+        size_t       dropped;
+    };
+    std::vector<Result> results;
+
+    for (const unsigned int producers : producerCounts)
+    {
+        std::vector<std::chrono::microseconds> threadTimes(producers);
+        std::vector<std::thread> threads;
+        std::atomic<bool> go = false;
+        const size_t droppedBefore = loggerPtr->GetDroppedMessageCount();
+
+        Timer wallTimer{false};
+        for (unsigned int t = 0; t < producers; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                // Log once up front so setting up the thread's log buffer isn't part of the measurement
+                LOG(LogLevel::INFO, "Producer {} ready", t);
+
+                // Start every producer at the same time to get the worst case contention
+                while (!go.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+
+                Timer timer{false};
+                timer.Start();
+                for (unsigned int i = 0; i < messagesPerThread; ++i)
+                {
+                    LOG(LogLevel::INFO, "Producer {} LOG #{}", t, i);
+                }
+                threadTimes[t] = timer.Stop();
+            });
+        }
+
+        wallTimer.Start();
+        go.store(true, std::memory_order_release);
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        const std::chrono::microseconds wallTime = wallTimer.Stop();
+
+        std::chrono::microseconds totalThreadTime{0};
+        for (const std::chrono::microseconds& threadTime : threadTimes)
+        {
+            totalThreadTime += threadTime;
+        }
+
+        const double totalMessages = static_cast<double>(producers) * messagesPerThread;
+        results.push_back({producers,
+                           1000.0 * totalThreadTime.count() / totalMessages,
+                           totalMessages / (std::max<long long>(wallTime.count(), 1) * 1e-6),
+                           loggerPtr->GetDroppedMessageCount() - droppedBefore});
+
+        // Give the logging thread time to catch up so each run starts with an empty queue
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    for (const Result& result : results)
+    {
+        LOG(LogLevel::WARNING, "Producers = {:>2}: Log avg = {:.1f}ns, throughput = {:.0f} msg/s, dropped = {}", 
+            result.producers, result.avgLogNs, result.messagesPerSecond, result.dropped);
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Contention tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void LogDeferredFormatTest()
+{
+    // Stay below the queue capacity so no message is dropped during a run
+    const unsigned int numIterations = 4000;
+    const std::string  name = "body";
+
+    // Let the logging thread empty the queue between runs
+    const auto waitForLogger = [] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); };
+
+    // Deferred: only the arguments are copied into the record
+    Timer deferredTimer{false};
+    deferredTimer.Start();
+    for (unsigned int i = 0; i < numIterations; ++i)
+    {
+        LOG(LogLevel::INFO, "Deferred LOG #{}: {} at ({:.3f}, {:.3f})", i, name, 0.5f * i, -0.25f * i);
+    }
+    const std::chrono::microseconds deferredTime = deferredTimer.Stop();
+    waitForLogger();
+
+    // Formatted on the calling thread: the message is built first and then copied into the record
+    Timer formattedTimer{false};
+    formattedTimer.Start();
+    for (unsigned int i = 0; i < numIterations; ++i)
+    {
+        LOG(LogLevel::INFO, "{}", std::format("Formatted LOG #{}: {} at ({:.3f}, {:.3f})", i, name, 0.5f * i, -0.25f * i));
+    }
+    const std::chrono::microseconds formattedTime = formattedTimer.Stop();
+    waitForLogger();
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Deferred LOG avg = {:.1f}ns",  1000.0 * deferredTime.count()  / numIterations);
+    LOG(LogLevel::WARNING, "Formatted LOG avg = {:.1f}ns", 1000.0 * formattedTime.count() / numIterations);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Deferred format tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void LogSinkThroughputTest()
+{
+    const unsigned int numMessages = 100000;
+    const unsigned int burstSize   = 2000; // Below the per-thread buffer capacity so nothing is dropped
+
+    const std::filesystem::path logDir = std::filesystem::temp_directory_path();
+    const std::string filePath     = (logDir / "PhysicsSim_FileSink.log").string();
+    const std::string rotatingPath = (logDir / "PhysicsSim_RotatingFileSink.log").string();
+    const std::string mmapPath     = (logDir / "PhysicsSim_MmapFileSink.log").string();
+
+    struct SinkCase
+    {
+        std::string                               name;
+        std::function<std::unique_ptr<LogSink>()> create;
+    };
+    const std::vector<SinkCase> sinkCases = {
+        {"Console",      [] { return std::make_unique<ConsoleSink>(); }},
+        {"File",         [&] { return std::make_unique<FileSink>(filePath); }},
+        {"RotatingFile", [&] { return std::make_unique<RotatingFileSink>(rotatingPath, 4 * 1024 * 1024, 2); }},
+#if LOG_SINKS_POSIX
+        {"MmapFile",     [&] { return std::make_unique<MmapFileSink>(mmapPath); }},
+#endif
+    };
+
+    std::vector<double> messagesPerSecond;
+    for (const SinkCase& sinkCase : sinkCases)
+    {
+        loggerPtr->Flush();
+        loggerPtr->ClearSinks();
+        loggerPtr->AddSink(sinkCase.create());
+
+        Timer timer{false};
+        timer.Start();
+        for (unsigned int i = 0; i < numMessages; i += burstSize)
+        {
+            for (unsigned int j = i; j < i + burstSize; ++j)
+            {
+                LOG(LogLevel::INFO, "{} sink LOG #{} value {:.3f}", sinkCase.name, j, 0.001f * j);
+            }
+            // Wait for the burst to be written so the next one can't overflow the buffer
+            loggerPtr->Flush();
+        }
+        const std::chrono::microseconds duration = timer.Stop();
+        messagesPerSecond.push_back(numMessages / (std::max<long long>(duration.count(), 1) * 1e-6));
+    }
+
+    // Closes the file sinks before their files are removed
+    loggerPtr->ClearSinks();
+    loggerPtr->AddSink(std::make_unique<ConsoleSink>());
+    std::filesystem::remove(filePath);
+    std::filesystem::remove(rotatingPath);
+    std::filesystem::remove(rotatingPath + ".1");
+    std::filesystem::remove(rotatingPath + ".2");
+    std::filesystem::remove(mmapPath);
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    for (size_t i = 0; i < sinkCases.size(); ++i)
+    {
+        LOG(LogLevel::WARNING, "{:<12} sink = {:.0f} msg/s", sinkCases[i].name, messagesPerSecond[i]);
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Sink throughput tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void LogTimestampTest()
+{
+    const unsigned int numIterations = 100000;
+
+    // Spread the timestamps over a few seconds like a real log would be
+    const uint64_t startTicks = Timer::Ticks();
+    const double   ticksPerStep = 50000.0 / Timer::TicksToNanoseconds(1); // 50us between messages
+    size_t checksum = 0; // Keeps the results alive
+
+    Timer uncachedTimer{false};
+    uncachedTimer.Start();
+    for (unsigned int i = 0; i < numIterations; ++i)
+    {
+        const uint64_t ticks = startTicks + static_cast<uint64_t>(i * ticksPerStep);
+        checksum += GetTimeString(Timer::TicksToSystemTime(ticks)).back();
+    }
+    const std::chrono::microseconds uncachedTime = uncachedTimer.Stop();
+
+    TimeStringCache timeStringCache;
+    Timer cachedTimer{false};
+    cachedTimer.Start();
+    for (unsigned int i = 0; i < numIterations; ++i)
+    {
+        const uint64_t ticks = startTicks + static_cast<uint64_t>(i * ticksPerStep);
+        checksum += timeStringCache.Format(ticks).back();
+    }
+    const std::chrono::microseconds cachedTime = cachedTimer.Stop();
+
+    // Cost of taking the timestamp itself on the calling thread
+    Timer ticksTimer{false};
+    ticksTimer.Start();
+    for (unsigned int i = 0; i < numIterations; ++i)
+    {
+        checksum += Timer::Ticks() & 1;
+    }
+    const std::chrono::microseconds ticksTime = ticksTimer.Stop();
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "GetTimeString avg = {:.1f}ns",   1000.0 * uncachedTime.count() / numIterations);
+    LOG(LogLevel::WARNING, "TimeStringCache avg = {:.1f}ns", 1000.0 * cachedTime.count()   / numIterations);
+    LOG(LogLevel::WARNING, "Timer::Ticks avg = {:.1f}ns",    1000.0 * ticksTime.count()    / numIterations);
+    LOG(LogLevel::WARNING, "(checksum {})", checksum);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Timestamp tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void LogOverflowPolicyTest()
+{
+    const unsigned int numThreads  = 4;
+    const unsigned int numMessages = 50000; // Per thread, well past the per-thread buffer capacity
+
+    const std::filesystem::path logPath = std::filesystem::temp_directory_path() / "PhysicsSim_OverflowPolicy.log";
+    const std::array<OverflowPolicy, 4> policies = {
+        OverflowPolicy::DROP_NEWEST, OverflowPolicy::OVERWRITE_OLDEST, OverflowPolicy::GROW, OverflowPolicy::BLOCK
+    };
+
+    struct PolicyResult
+    {
+        double            averageLogTime = 0.0; // Nanoseconds per LOG call on the producing threads
+        LogOverflowCounts counts;
+    };
+    std::vector<PolicyResult> results;
+
+    Logger* mainLogger = loggerPtr;
+    for (const OverflowPolicy policy : policies)
+    {
+        PolicyResult result;
+        {
+            // Every producer floods a logger of its own, so the main log isn't affected
+            Logger policyLogger(policy);
+            policyLogger.ClearSinks();
+            policyLogger.AddSink(std::make_unique<FileSink>(logPath.string()));
+            loggerPtr = &policyLogger;
+
+            std::vector<long long> threadTimes(numThreads);
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < numThreads; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    Timer timer{false};
+                    timer.Start();
+                    for (unsigned int i = 0; i < numMessages; ++i)
+                    {
+                        LOG(LogLevel::INFO, "Thread {} overflow LOG #{} value {:.3f}", t, i, 0.001f * i);
+                    }
+                    threadTimes[t] = timer.Stop().count();
+                });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            policyLogger.Flush();
+            loggerPtr = mainLogger;
+
+            long long totalTime = 0;
+            for (const long long threadTime : threadTimes)
+            {
+                totalTime += threadTime;
+            }
+            result.averageLogTime = 1000.0 * totalTime / (numThreads * numMessages);
+            result.counts = policyLogger.GetOverflowCounts();
+        }
+        results.push_back(result);
+        std::filesystem::remove(logPath);
+    }
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    for (size_t i = 0; i < policies.size(); ++i)
+    {
+        LOG(LogLevel::WARNING, "{:<16} LOG avg = {:.1f}ns, dropped {}, overwritten {}, blocked {}",
+            OverflowPolicyToString(policies[i]), results[i].averageLogTime,
+            results[i].counts.dropped, results[i].counts.overwritten, results[i].counts.blocked);
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Overflow policy tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void CircularBufferTest()
+{
+    const unsigned int numElements = 1 << 22;
+    const size_t       chunkSize   = 1024; // Elements pushed before they are popped again
+    const size_t       bulkSize    = 64;   // Elements per push_n/pop_n in the two thread runs
+
+    struct Element
+    {
+        uint64_t id = 0;
+        float    x = 0.0f, y = 0.0f, vx = 0.0f, vy = 0.0f;
+    };
+
+    uint64_t checksum = 0; // Keeps the results alive
+    const auto nanosecondsPerElement = [&](const std::chrono::microseconds duration)
+    {
+        return 1000.0 * duration.count() / numElements;
+    };
+
+    // Original buffer: modulo indexing, element built as a temporary and move assigned
+    CircularBuffer<Element> dynamicBuffer(chunkSize, OverflowPolicy::DROP_NEWEST);
+    Timer dynamicTimer{false};
+    dynamicTimer.Start();
+    for (unsigned int i = 0; i < numElements; i += chunkSize)
+    {
+        for (unsigned int j = i; j < i + chunkSize; ++j)
+        {
+            dynamicBuffer.emplace(Element{j, 1.0f, 2.0f, 3.0f, 4.0f});
+        }
+        while (!dynamicBuffer.empty())
+        {
+            checksum += dynamicBuffer.front().id;
+            dynamicBuffer.pop();
+        }
+    }
+    const double dynamicTime = nanosecondsPerElement(dynamicTimer.Stop());
+
+    // Fixed buffer, one element at a time
+    std::unique_ptr<FixedCircularBuffer<Element, chunkSize>> fixedBuffer = std::make_unique<FixedCircularBuffer<Element, chunkSize>>();
+    Timer fixedTimer{false};
+    fixedTimer.Start();
+    for (unsigned int i = 0; i < numElements; i += chunkSize)
+    {
+        for (unsigned int j = i; j < i + chunkSize; ++j)
+        {
+            fixedBuffer->emplace(Element{j, 1.0f, 2.0f, 3.0f, 4.0f});
+        }
+        while (Element* element = fixedBuffer->front())
+        {
+            checksum += element->id;
+            fixedBuffer->pop();
+        }
+    }
+    const double fixedTime = nanosecondsPerElement(fixedTimer.Stop());
+
+    // Fixed buffer, a whole chunk per call
+    std::vector<Element> chunk(chunkSize);
+    Timer bulkTimer{false};
+    bulkTimer.Start();
+    for (unsigned int i = 0; i < numElements; i += chunkSize)
+    {
+        for (size_t j = 0; j < chunkSize; ++j)
+        {
+            chunk[j].id = i + j;
+        }
+        fixedBuffer->push_n(chunk.data(), chunkSize);
+        const size_t popped = fixedBuffer->pop_n(chunk.data(), chunkSize);
+        checksum += chunk[popped - 1].id;
+    }
+    const double bulkTime = nanosecondsPerElement(bulkTimer.Stop());
+
+    // Fixed buffer shared by a producer and a consumer thread
+    using SpscBuffer = FixedCircularBuffer<Element, chunkSize, BufferThreading::SPSC>;
+    const auto runSpsc = [&](const size_t elementsPerCall)
+    {
+        std::unique_ptr<SpscBuffer> spscBuffer = std::make_unique<SpscBuffer>();
+        uint64_t consumerChecksum = 0;
+
+        Timer spscTimer{false};
+        spscTimer.Start();
+        std::thread consumer([&]()
+        {
+            std::vector<Element> received(elementsPerCall);
+            unsigned int count = 0;
+            while (count < numElements)
+            {
+                size_t popped = 0;
+                if (elementsPerCall > 1)
+                {
+                    popped = spscBuffer->pop_n(received.data(), elementsPerCall);
+                }
+                else if (Element* element = spscBuffer->front())
+                {
+                    received[0] = *element;
+                    spscBuffer->pop();
+                    popped = 1;
+                }
+                for (size_t i = 0; i < popped; ++i)
+                {
+                    consumerChecksum += received[i].id;
+                }
+                count += static_cast<unsigned int>(popped);
+                if (popped == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<Element> sent(elementsPerCall);
+        for (unsigned int i = 0; i < numElements; )
+        {
+            for (size_t j = 0; j < elementsPerCall; ++j)
+            {
+                sent[j].id = i + j;
+            }
+            const size_t pushed = (elementsPerCall > 1)
+                ? spscBuffer->push_n(sent.data(), std::min<size_t>(elementsPerCall, numElements - i))
+                : (spscBuffer->emplace(sent[0]) ? 1 : 0);
+            i += static_cast<unsigned int>(pushed);
+            if (pushed == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        consumer.join();
+        checksum += consumerChecksum;
+        return nanosecondsPerElement(spscTimer.Stop());
+    };
+    const double spscTime     = runSpsc(1);
+    const double spscBulkTime = runSpsc(bulkSize);
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "CircularBuffer emplace/pop avg = {:.2f}ns",             dynamicTime);
+    LOG(LogLevel::WARNING, "FixedCircularBuffer emplace/pop avg = {:.2f}ns",        fixedTime);
+    LOG(LogLevel::WARNING, "FixedCircularBuffer push_n/pop_n avg = {:.2f}ns",       bulkTime);
+    LOG(LogLevel::WARNING, "FixedCircularBuffer SPSC emplace/pop avg = {:.2f}ns",   spscTime);
+    LOG(LogLevel::WARNING, "FixedCircularBuffer SPSC push_n/pop_n avg = {:.2f}ns",  spscBulkTime);
+    LOG(LogLevel::WARNING, "(checksum {})", checksum);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Circular buffer tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void ProfilerOverheadTest()
+{
+    const unsigned int numFrames     = 100;
+    const unsigned int zonesPerFrame = 1000; // Below the per-thread ring capacity so nothing is dropped
+
+    // Other threads (like the logging thread) may be recording into the profiler at any time,
+    // so the test uses the main one instead of swapping in a profiler of its own
+    if (profilerPtr == nullptr)
+    {
+        LOG(LogLevel::ERROR, "ProfilerOverheadTest needs a Profiler, create one before running it");
+        return;
+    }
+    Profiler& profiler = *profilerPtr;
+    profiler.EndFrame(); // Start from an empty frame
+
+    uint64_t checksum = 0; // Keeps the zones from being optimized away
+
+    // Cost of a Timer around the same work, without printing
+    Timer timerTimer{false};
+    timerTimer.Start();
+    for (unsigned int frame = 0; frame < numFrames; ++frame)
+    {
+        for (unsigned int i = 0; i < zonesPerFrame; ++i)
+        {
+            Timer zoneTimer{false};
+            zoneTimer.Start();
+            checksum += i;
+            checksum += zoneTimer.Stop().count();
+        }
+    }
+    const std::chrono::microseconds timerTime = timerTimer.Stop();
+
+    std::chrono::microseconds scopeTime{0};
+    std::chrono::microseconds endFrameTime{0};
+    for (unsigned int frame = 0; frame < numFrames; ++frame)
+    {
+        Timer scopeTimer{false};
+        scopeTimer.Start();
+        for (unsigned int i = 0; i < zonesPerFrame; ++i)
+        {
+            PROFILE_SCOPE("OverheadTest");
+            checksum += i;
+        }
+        scopeTime += scopeTimer.Stop();
+
+        Timer endFrameTimer{false};
+        endFrameTimer.Start();
+        profiler.EndFrame();
+        endFrameTime += endFrameTimer.Stop();
+    }
+
+    const double totalZones = static_cast<double>(numFrames) * zonesPerFrame;
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Timer Start/Stop avg = {:.1f}ns",       1000.0 * timerTime.count() / totalZones);
+    LOG(LogLevel::WARNING, "PROFILE_SCOPE avg = {:.1f}ns",          1000.0 * scopeTime.count() / totalZones);
+    LOG(LogLevel::WARNING, "EndFrame avg = {:.1f}us for {} zones",  static_cast<double>(endFrameTime.count()) / numFrames, zonesPerFrame);
+    LOG(LogLevel::WARNING, "(checksum {})", checksum);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Profiler tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void TraceWriterTest()
+{
+    const unsigned int numFrames     = 600;
+    const unsigned int zonesPerFrame = 50;
+    const std::filesystem::path tracePath = std::filesystem::temp_directory_path() / "PhysicsSim_Trace.json";
+
+    // Simulated frame: a few nested zones around a little work, the same with and without tracing
+    uint64_t checksum = 0; // Keeps the work from being optimized away
+    const auto runFrames = [&](Profiler& profiler)
+    {
+        Timer timer{false};
+        timer.Start();
+        for (unsigned int frame = 0; frame < numFrames; ++frame)
+        {
+            {
+                PROFILE_SCOPE("TraceFrame");
+                for (unsigned int i = 0; i < zonesPerFrame; ++i)
+                {
+                    PROFILE_SCOPE("TraceZone");
+                    for (unsigned int j = 0; j < 1000; ++j)
+                    {
+                        checksum += j ^ i;
+                    }
+                }
+            }
+            profiler.EndFrame();
+        }
+        return timer.Stop();
+    };
+
+    // Other threads (like the logging thread) may be recording into the profiler at any time,
+    // so the test uses the main one instead of swapping in a profiler of its own
+    if (profilerPtr == nullptr)
+    {
+        LOG(LogLevel::ERROR, "TraceWriterTest needs a Profiler, create one before running it");
+        return;
+    }
+    Profiler& profiler = *profilerPtr;
+    profiler.EndFrame(); // Start from an empty frame
+
+    const std::chrono::microseconds untracedTime = runFrames(profiler);
+
+    // A zone that ends before the writer is created is still in the profiler when the first traced frame ends
+    {
+        PROFILE_SCOPE("TraceEarlyZone");
+    }
+
+    std::chrono::microseconds tracedTime;
+    {
+        TraceWriter traceWriter(tracePath.string());
+        profiler.SetTraceWriter(&traceWriter);
+        tracedTime = runFrames(profiler);
+        profiler.SetTraceWriter(nullptr);
+    }
+
+    const uintmax_t traceBytes = std::filesystem::file_size(tracePath);
+
+    // The early zone must be left out, and no zone may last longer than the whole traced run
+    unsigned int errors = 0;
+    {
+        std::ifstream traceFile(tracePath);
+        const std::string trace((std::istreambuf_iterator<char>(traceFile)), std::istreambuf_iterator<char>());
+        if (trace.find("\"TraceEarlyZone\"") != std::string::npos)
+        {
+            ++errors;
+        }
+        const std::string_view durationKey = "\"dur\":";
+        for (size_t pos = trace.find(durationKey); pos != std::string::npos; pos = trace.find(durationKey, pos + 1))
+        {
+            const double durationUs = std::strtod(trace.c_str() + pos + durationKey.size(), nullptr);
+            if (durationUs < 0.0 || durationUs > static_cast<double>(tracedTime.count()))
+            {
+                ++errors;
+            }
+        }
+    }
+    std::filesystem::remove(tracePath);
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Trace writer errors = {}", errors);
+    LOG(LogLevel::WARNING, "Untraced frames avg = {:.1f}us", static_cast<double>(untracedTime.count()) / numFrames);
+    LOG(LogLevel::WARNING, "Traced frames avg = {:.1f}us ({:+.2f}%)", static_cast<double>(tracedTime.count()) / numFrames,
+        100.0 * (tracedTime.count() - untracedTime.count()) / std::max<long long>(untracedTime.count(), 1));
+    LOG(LogLevel::WARNING, "Trace file size = {} bytes for {} zones", traceBytes, numFrames * (zonesPerFrame + 1));
+    LOG(LogLevel::WARNING, "(checksum {})", checksum);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Trace writer tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void BodyStoreTest()
+{
+    const unsigned int numBodies    = 1 << 20;
+    const unsigned int numStepLoops = 20;
+    const float        dt = 1.0f / 60.0f;
+
+    BodyStore bodies(numBodies);
+    std::vector<BodyHandle> handles;
+    handles.reserve(numBodies);
+    for (unsigned int i = 0; i < numBodies; ++i)
+    {
+        handles.push_back(bodies.Add(0.001f * (i % 1000), 0.001f * (i / 1000), 0.5f, -0.25f));
+    }
+
+    // Remove every third body and check that handles follow the bodies that were moved
+    unsigned int errors = 0;
+    for (unsigned int i = 0; i < numBodies; i += 3)
+    {
+        bodies.Remove(handles[i]);
+    }
+    for (unsigned int i = 0; i < numBodies; ++i)
+    {
+        const size_t index = bodies.IndexOf(handles[i]);
+        const bool removed = (i % 3) == 0;
+        if (removed != (index == BodyStore::INVALID_INDEX) ||
+            (!removed && (bodies.X()[index] != 0.001f * (i % 1000) || bodies.HandleAt(index) != handles[i])))
+        {
+            ++errors;
+        }
+    }
+    if (reinterpret_cast<uintptr_t>(bodies.X()) % BODY_STORE_ALIGNMENT != 0 || reinterpret_cast<uintptr_t>(bodies.VY()) % BODY_STORE_ALIGNMENT != 0)
+    {
+        ++errors;
+    }
+
+    // Advance the positions with the store's separate arrays
+    Timer soaTimer{false};
+    soaTimer.Start();
+    for (unsigned int loop = 0; loop < numStepLoops; ++loop)
+    {
+        float* const x = bodies.X();
+        float* const y = bodies.Y();
+        const float* const vx = bodies.VX();
+        const float* const vy = bodies.VY();
+        for (size_t i = 0; i < bodies.Size(); ++i)
+        {
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+        }
+    }
+    const std::chrono::microseconds soaTime = soaTimer.Stop();
+
+    // The same step over interleaved bodies, the layout Application used before
+    struct InterleavedBody
+    {
+        float x, y, vx, vy, mass;
+        uint32_t flags;
+    };
+    std::vector<InterleavedBody> interleaved(bodies.Size(), InterleavedBody{0.0f, 0.0f, 0.5f, -0.25f, 1.0f, 0});
+    Timer aosTimer{false};
+    aosTimer.Start();
+    for (unsigned int loop = 0; loop < numStepLoops; ++loop)
+    {
+        for (InterleavedBody& body : interleaved)
+        {
+            body.x += body.vx * dt;
+            body.y += body.vy * dt;
+        }
+    }
+    const std::chrono::microseconds aosTime = aosTimer.Stop();
+
+    const double bodySteps = static_cast<double>(numStepLoops) * bodies.Size();
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "BodyStore handle/removal errors = {}", errors);
+    LOG(LogLevel::WARNING, "Structure of arrays step avg = {:.3f}ns/body", 1000.0 * soaTime.count() / bodySteps);
+    LOG(LogLevel::WARNING, "Interleaved bodies step avg = {:.3f}ns/body",  1000.0 * aosTime.count() / bodySteps);
+    LOG(LogLevel::WARNING, "(checksum {})", bodies.X()[bodies.Size() / 2] + interleaved[interleaved.size() / 2].x);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Body store tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void SimulationStepTest()
+{
+    const unsigned int numBodies = 100000;
+    const unsigned int numSteps  = 200;
+    const double       stepHz    = 120.0;
+    const double       stepSeconds = 1.0 / stepHz;
+
+    // 60 Hz frames run two steps each, a half second stall is capped at maxSubsteps
+    unsigned int errors = 0;
+    FixedStepClock clock(stepHz, 8);
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        if (clock.Advance(1.0 / 60.0) != 2)
+        {
+            ++errors;
+        }
+    }
+    if (clock.Advance(0.5) != 8 || clock.GetSkippedSteps() != 60 - 8 || clock.Alpha() < 0.0f || clock.Alpha() >= 1.0f)
+    {
+        ++errors;
+    }
+    if (clock.Advance(0.25 * stepSeconds) != 0 || std::abs(clock.Alpha() - 0.25f) > 1e-3f)
+    {
+        ++errors;
+    }
+
+    // One body crossing the right edge, one moving slowly, one static
+    BodyStore bodies(numBodies);
+    bodies.Add(WORLD_MAX - 0.001f, 0.0f, 1.0f, 0.0f);
+    bodies.Add(0.0f, 0.0f, 0.0f, 1.2f);
+    bodies.Add(0.5f, 0.5f, 1.0f, 1.0f, 1.0f, BODY_FLAG_STATIC);
+    Simulation simulation(bodies);
+    simulation.Step(static_cast<float>(stepSeconds));
+
+    float interpolated[6];
+    simulation.InterpolatePositions(0.5f, interpolated);
+    const float* const x = bodies.X();
+    const float* const y = bodies.Y();
+    if (x[0] >= 0.0f || interpolated[0] != x[0] ||                          // Wrapped, so drawn where it is now
+        std::abs(interpolated[3] - 0.5f * y[1]) > 1e-6f ||                    // Halfway between the two steps
+        interpolated[4] != 0.5f || interpolated[5] != 0.5f)                   // Never moved
+    {
+        ++errors;
+    }
+
+    // Time steps over a full store
+    bodies.Clear();
+    for (unsigned int i = 0; i < numBodies; ++i)
+    {
+        bodies.Add(0.00002f * i - 1.0f, 1.0f - 0.00002f * i, 0.5f, -0.25f);
+    }
+    Timer stepTimer{false};
+    stepTimer.Start();
+    for (unsigned int step = 0; step < numSteps; ++step)
+    {
+        simulation.Step(static_cast<float>(stepSeconds));
+    }
+    const std::chrono::microseconds stepTime = stepTimer.Stop();
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Fixed step clock and interpolation errors = {}", errors);
+    LOG(LogLevel::WARNING, "Step avg = {:.1f}us for {} bodies, {:.3f}ns/body",
+        static_cast<double>(stepTime.count()) / numSteps, numBodies, 1000.0 * stepTime.count() / (static_cast<double>(numSteps) * numBodies));
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Simulation step tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void IntegratorBenchmarkTest()
+{
+    const unsigned int numBodies = 1 << 20;
+    const unsigned int numSteps  = 50;
+    const float        dt = 1.0f / 120.0f;
+
+    ForceField forces;
+    forces.gravityY = -0.5f;
+    forces.damping  = 0.5f;
+
+    // Every run starts from the same bodies, every eighth one static
+    BodyStore initial(numBodies);
+    for (unsigned int i = 0; i < numBodies; ++i)
+    {
+        initial.Add(0.0000019f * i - 1.0f, 0.9f - 0.0000017f * i, 0.001f * (i % 500), -0.002f * (i % 300), 1.0f,
+                    (i % 8) == 0 ? BODY_FLAG_STATIC : BODY_FLAG_NONE);
+    }
+    BodyStore bodies(numBodies);
+    std::vector<float> scalarX(numBodies);
+
+    // Exact velocity after numSteps under gravity and linear drag: v(t) = g/k + (v0 - g/k) * e^(-kt)
+    const double terminalVelocity = forces.gravityY / forces.damping;
+    const double time = static_cast<double>(numSteps) * dt;
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Integrators over {} bodies, {} steps, CPU supports {}", numBodies, numSteps, SimdLevelToString(DetectSimdLevel()));
+    for (const IntegratorType type : {IntegratorType::SEMI_IMPLICIT_EULER, IntegratorType::VELOCITY_VERLET, IntegratorType::RK4})
+    {
+        for (const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE, SimdLevel::AVX2})
+        {
+            const Integrator integrator(type, level);
+            if (integrator.GetSimdLevel() != level)
+            {
+                continue; // Not supported here
+            }
+
+            bodies.Clear();
+            for (size_t i = 0; i < initial.Size(); ++i)
+            {
+                bodies.Add(initial.X()[i], initial.Y()[i], initial.VX()[i], initial.VY()[i], initial.Mass()[i], initial.Flags()[i]);
+            }
+
+            Timer stepTimer{false};
+            stepTimer.Start();
+            for (unsigned int step = 0; step < numSteps; ++step)
+            {
+                integrator.Step(bodies, dt, forces);
+            }
+            const std::chrono::microseconds stepTime = stepTimer.Stop();
+
+            // Every instruction set runs the same operations in the same order
+            double maxDifference = 0.0;
+            if (level == SimdLevel::SCALAR)
+            {
+                std::copy(bodies.X(), bodies.X() + numBodies, scalarX.begin());
+            }
+            for (size_t i = 0; i < numBodies; ++i)
+            {
+                maxDifference = std::max(maxDifference, static_cast<double>(std::abs(bodies.X()[i] - scalarX[i])));
+            }
+
+            const double exactVelocity = terminalVelocity + (initial.VY()[1] - terminalVelocity) * std::exp(-forces.damping * time);
+            LOG(LogLevel::WARNING, "{:>20} {:>6}: {:7.1f}M bodies/s/core, max difference to scalar = {:.2e}, velocity error = {:.2e}",
+                IntegratorTypeToString(type), SimdLevelToString(level),
+                static_cast<double>(numSteps) * numBodies / stepTime.count(), maxDifference, std::abs(bodies.VY()[1] - exactVelocity));
+        }
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Integrator tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void BroadphaseTest()
+{
+    const unsigned int numCheckBodies = 4000;
+    const unsigned int numUpdates     = 20;
+
+    // Compare with every pair, about one body in ten touches an edge of the world
+    unsigned int errors = 0;
+    BodyStore bodies(numCheckBodies);
+    for (unsigned int i = 0; i < numCheckBodies; ++i)
+    {
+        const float x = WORLD_MIN + WORLD_SIZE * ((i * 7919u) % numCheckBodies) / numCheckBodies;
+        const float y = WORLD_MIN + WORLD_SIZE * ((i * 104729u) % 997u) / 997.0f;
+        bodies.Add(x, y, 0.0f, 0.0f, 1.0f, BODY_FLAG_NONE, 0.002f + 0.001f * (i % 16));
+    }
+
+    std::vector<BodyPair> expected;
+    for (uint32_t a = 0; a < bodies.Size(); ++a)
+    {
+        for (uint32_t b = a + 1; b < bodies.Size(); ++b)
+        {
+            float dx = std::abs(bodies.X()[b] - bodies.X()[a]);
+            float dy = std::abs(bodies.Y()[b] - bodies.Y()[a]);
+            dx = std::min(dx, WORLD_SIZE - dx);
+            dy = std::min(dy, WORLD_SIZE - dy);
+            const float reach = bodies.Radius()[a] + bodies.Radius()[b];
+            if (dx < reach && dy < reach)
+            {
+                expected.push_back(BodyPair{a, b});
+            }
+        }
+    }
+
+    UniformGridBroadphase grid;
+    grid.Update(bodies);
+    std::vector<BodyPair> found = grid.GetPairs();
+    const auto pairLess = [](const BodyPair& lhs, const BodyPair& rhs) { return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b; };
+    std::sort(found.begin(), found.end(), pairLess);
+    if (found != expected)
+    {
+        ++errors;
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Broadphase pairs = {}, all pairs = {}, errors = {}", found.size(), expected.size(), errors);
+
+    // Time rebuilds with the bodies scattered at random
+    for (const unsigned int numBodies : {10000u, 100000u, 1000000u})
+    {
+        BodyStore spread(numBodies);
+        std::mt19937 random(numBodies);
+        std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+        for (unsigned int i = 0; i < numBodies; ++i)
+        {
+            spread.Add(position(random), position(random), 0.0f, 0.0f, 1.0f, BODY_FLAG_NONE, 0.5f / std::sqrt(static_cast<float>(numBodies)));
+        }
+
+        UniformGridBroadphase broadphase;
+        broadphase.Update(spread); // Grow the buffers
+        Timer updateTimer{false};
+        updateTimer.Start();
+        for (unsigned int update = 0; update < numUpdates; ++update)
+        {
+            broadphase.Update(spread);
+        }
+        const std::chrono::microseconds updateTime = updateTimer.Stop();
+
+        LOG(LogLevel::WARNING, "{:>8} bodies: update avg = {:8.1f}us, {:.1f}ns/body, {} cells per side, {} pairs",
+            numBodies, static_cast<double>(updateTime.count()) / numUpdates, 1000.0 * updateTime.count() / (static_cast<double>(numUpdates) * numBodies),
+            broadphase.GetCellsPerSide(), broadphase.GetPairs().size());
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Broadphase tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void AabbTreeTest()
+{
+    const unsigned int numBodies  = 20000;
+    const unsigned int numSteps   = 30;
+    const unsigned int numRays    = 1000;
+    const unsigned int numUpdates = 10;
+
+    // Radii of the checked bodies are spread evenly on a log scale between 0.0005 and 0.05.
+    // The timed bodies are either all the same size, or mostly small with one in a hundred large.
+    enum class Sizes { VARIED, EQUAL, MIXED };
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+    std::uniform_real_distribution<float> velocity(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> logRadius(std::log(0.0005f), std::log(0.05f));
+    const auto addBodies = [&](BodyStore& bodies, const unsigned int count, const Sizes sizes)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const float radius = (sizes == Sizes::VARIED) ? std::exp(logRadius(random)) : (sizes == Sizes::MIXED && i % 100 == 0) ? 0.05f : 0.002f;
+            bodies.Add(position(random), position(random), velocity(random), velocity(random), 1.0f, BODY_FLAG_NONE, radius);
+        }
+    };
+    const auto pairLess = [](const BodyPair& lhs, const BodyPair& rhs) { return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b; };
+
+    // Step the bodies and compare with the grid, which tests every pair in neighbouring cells
+    unsigned int errors = 0;
+    size_t movedLeaves = 0;
+    BodyStore bodies(numBodies);
+    addBodies(bodies, numBodies, Sizes::VARIED);
+    const Integrator integrator;
+    UniformGridBroadphase grid;
+    AabbTreeBroadphase tree;
+    for (unsigned int step = 0; step < numSteps; ++step)
+    {
+        integrator.Step(bodies, 1.0f / 120.0f);
+        for (unsigned int i = 0; i < 50; ++i)
+        {
+            bodies.Remove(bodies.HandleAt((step * 7919u + i * 104729u) % bodies.Size()));
+        }
+        addBodies(bodies, 50, Sizes::VARIED);
+
+        grid.Update(bodies);
+        tree.Update(bodies);
+        movedLeaves += tree.GetMovedCount();
+
+        std::vector<BodyPair> gridPairs = grid.GetPairs();
+        std::vector<BodyPair> treePairs = tree.GetPairs();
+        std::sort(gridPairs.begin(), gridPairs.end(), pairLess);
+        std::sort(treePairs.begin(), treePairs.end(), pairLess);
+        if (gridPairs != treePairs || !tree.GetTree().Validate() || tree.GetTree().GetLeafCount() != bodies.Size())
+        {
+            ++errors;
+        }
+    }
+
+    // The closest hit of every ray, compared with testing every body
+    for (unsigned int ray = 0; ray < numRays; ++ray)
+    {
+        const float angle = 0.001f * ray * 6283.0f / numRays;
+        const float dirX = std::cos(angle);
+        const float dirY = std::sin(angle);
+        const float originX = 0.5f * position(random);
+        const float originY = 0.5f * position(random);
+
+        float expectedDistance = 1.0f;
+        size_t expected = BodyStore::INVALID_INDEX;
+        for (size_t i = 0; i < bodies.Size(); ++i)
+        {
+            const float mx = originX - bodies.X()[i];
+            const float my = originY - bodies.Y()[i];
+            const float b = mx * dirX + my * dirY;
+            const float c = mx * mx + my * my - bodies.Radius()[i] * bodies.Radius()[i];
+            if ((c <= 0.0f || b <= 0.0f) && b * b - c >= 0.0f)
+            {
+                const float t = std::max(0.0f, -b - std::sqrt(b * b - c));
+                if (t < expectedDistance)
+                {
+                    expectedDistance = t;
+                    expected = i;
+                }
+            }
+        }
+
+        float hitDistance = 0.0f;
+        const size_t hit = tree.RayCast(originX, originY, dirX, dirY, 1.0f, &hitDistance);
+        if (hit != expected && (hit == BodyStore::INVALID_INDEX || expected == BodyStore::INVALID_INDEX || hitDistance != expectedDistance))
+        {
+            ++errors;
+        }
+    }
+
+    // Axis aligned rays running exactly along the edges of a row of boxes (and so of the inner nodes above them)
+    // still reach every box, a zero direction component mustn't cull anything it lies inside of
+    {
+        const unsigned int numBoxes = 16;
+        DynamicAabbTree edgeTree;
+        for (unsigned int i = 0; i < numBoxes; ++i)
+        {
+            edgeTree.CreateProxy(AABB{static_cast<float>(i), 0.0f, static_cast<float>(i + 1), 1.0f}, 0.0f, i);
+        }
+        const auto countHits = [&](const float originX, const float originY, const float dirX, const float dirY)
+        {
+            unsigned int hits = 0;
+            edgeTree.RayCast(originX, originY, dirX, dirY, 2.0f * numBoxes, [&](int32_t, const float distance)
+            {
+                ++hits;
+                return distance;
+            });
+            return hits;
+        };
+        errors += (countHits(-1.0f, 0.0f, 1.0f, 0.0f) == numBoxes) ? 0 : 1; // Along the bottom edges
+        errors += (countHits(-1.0f, 1.0f, 1.0f, 0.0f) == numBoxes) ? 0 : 1; // Along the top edges
+        errors += (countHits(numBoxes + 1.0f, 1.0f, -1.0f, 0.0f) == numBoxes) ? 0 : 1;
+        errors += (countHits(0.0f, -1.0f, 0.0f, 1.0f) == 1) ? 0 : 1;        // Up the left edge of the first box
+        errors += (countHits(-1.0f, 1.5f, 1.0f, 0.0f) == 0) ? 0 : 1;        // Parallel, just outside
+    }
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "AABB tree errors = {}, height = {}, area ratio = {:.1f}, leaves moved per step = {}",
+        errors, tree.GetTree().GetHeight(), tree.GetTree().GetAreaRatio(), movedLeaves / numSteps);
+
+    // Time both broadphases on the same moving bodies
+    for (const Sizes sizes : {Sizes::EQUAL, Sizes::MIXED})
+    {
+        for (const unsigned int count : {10000u, 100000u})
+        {
+            BodyStore timed(count);
+            addBodies(timed, count, sizes);
+            UniformGridBroadphase timedGrid;
+            AabbTreeBroadphase timedTree;
+            timedTree.Update(timed); // Build the tree
+
+            std::chrono::microseconds gridTime(0);
+            std::chrono::microseconds treeTime(0);
+            for (unsigned int update = 0; update < numUpdates; ++update)
+            {
+                integrator.Step(timed, 1.0f / 120.0f);
+
+                Timer gridTimer{false};
+                gridTimer.Start();
+                timedGrid.Update(timed);
+                gridTime += gridTimer.Stop();
+
+                Timer treeTimer{false};
+                treeTimer.Start();
+                timedTree.Update(timed);
+                treeTime += treeTimer.Stop();
+            }
+
+            LOG(LogLevel::WARNING, "{:>6} bodies, {:>7} sizes: grid update avg = {:8.1f}us, tree update avg = {:8.1f}us, {} pairs",
+                count, sizes == Sizes::MIXED ? "mixed" : "equal", static_cast<double>(gridTime.count()) / numUpdates,
+                static_cast<double>(treeTime.count()) / numUpdates, timedTree.GetPairs().size());
+        }
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "AABB tree tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void ContactSolverTest()
+{
+    const unsigned int numSteps  = 60;
+    const unsigned int numSolves = 10;
+    const float dt = 1.0f / 120.0f;
+
+    // Bodies on a jittered square grid with a radius of radiusScale times the spacing, so above 0.5 each
+    // overlaps its neighbours and the pile is jammed. Every seventh row is static.
+    const auto addPile = [](BodyStore& bodies, const unsigned int side, const float radiusScale)
+    {
+        std::mt19937 random(7);
+        const float spacing = WORLD_SIZE / side;
+        const float radius = radiusScale * spacing;
+        std::uniform_real_distribution<float> jitter(-0.15f * spacing, 0.15f * spacing);
+        std::uniform_real_distribution<float> velocity(-0.1f, 0.1f);
+        for (unsigned int row = 0; row < side; ++row)
+        {
+            const uint32_t flags = (row % 7 == 0) ? BODY_FLAG_STATIC : BODY_FLAG_NONE;
+            for (unsigned int column = 0; column < side; ++column)
+            {
+                const float x = WORLD_MIN + (column + 0.5f) * spacing + jitter(random);
+                const float y = WORLD_MIN + (row + 0.5f) * spacing + jitter(random);
+                const bool isStatic = flags == BODY_FLAG_STATIC;
+                bodies.Add(x, y, isStatic ? 0.0f : velocity(random), isStatic ? 0.0f : velocity(random), 1.0f, flags, radius);
+            }
+        }
+    };
+    const auto maxPenetration = [](const BodyStore& bodies, const std::vector<BodyPair>& pairs)
+    {
+        float deepest = 0.0f;
+        for (const BodyPair& pair : pairs)
+        {
+            if ((bodies.Flags()[pair.a] & bodies.Flags()[pair.b] & BODY_FLAG_STATIC) != 0)
+            {
+                continue;
+            }
+            const float dx = WrappedDelta(bodies.X()[pair.a], bodies.X()[pair.b]);
+            const float dy = WrappedDelta(bodies.Y()[pair.a], bodies.Y()[pair.b]);
+            deepest = std::max(deepest, bodies.Radius()[pair.a] + bodies.Radius()[pair.b] - std::sqrt(dx * dx + dy * dy));
+        }
+        return deepest;
+    };
+
+    // The same loose pile stepped with and without the job system has to match exactly, the colors make the order
+    // irrelevant. Its bodies have room to separate, so the overlap has to shrink.
+    unsigned int errors = 0;
+    BodyStore serialBodies;
+    BodyStore parallelBodies;
+    addPile(serialBodies, 100, 0.45f);
+    addPile(parallelBodies, 100, 0.45f);
+    JobSystem jobs(4);
+    const Integrator integrator;
+    UniformGridBroadphase broadphase;
+    ContactSolver serialSolver;
+    ContactSolver parallelSolver;
+
+    broadphase.Update(serialBodies);
+    const float initialPenetration = maxPenetration(serialBodies, broadphase.GetPairs());
+    for (unsigned int step = 0; step < numSteps; ++step)
+    {
+        broadphase.Update(serialBodies);
+        serialSolver.Solve(serialBodies, broadphase.GetPairs(), dt);
+        parallelSolver.Solve(parallelBodies, broadphase.GetPairs(), dt, &jobs);
+        if (!std::equal(serialBodies.VX(), serialBodies.VX() + serialBodies.Size(), parallelBodies.VX()) ||
+            !std::equal(serialBodies.VY(), serialBodies.VY() + serialBodies.Size(), parallelBodies.VY()))
+        {
+            ++errors;
+        }
+        integrator.Step(serialBodies, dt);
+        integrator.Step(parallelBodies, dt);
+    }
+    broadphase.Update(serialBodies);
+    const float finalPenetration = maxPenetration(serialBodies, broadphase.GetPairs());
+    errors += (finalPenetration < 0.5f * initialPenetration) ? 0 : 1;
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Contact solver errors = {}, max penetration {:.5f} -> {:.5f}, {} contacts in {} colors, {} warm started",
+        errors, initialPenetration, finalPenetration, serialSolver.GetContactCount(), serialSolver.GetColorCount(),
+        serialSolver.GetWarmStartedCount());
+    for (uint32_t color = 0; color < serialSolver.GetColorCount(); ++color)
+    {
+        LOG(LogLevel::WARNING, "  color {:>2}: {} contacts", color, serialSolver.GetColorSize(color));
+    }
+
+    // Time solving a large jammed pile on more and more threads, from the same state every time
+    const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    BodyStore pile;
+    addPile(pile, 500, 0.6f);
+    UniformGridBroadphase pileBroadphase;
+    pileBroadphase.Update(pile);
+    std::vector<float> startVX(pile.VX(), pile.VX() + pile.Size());
+    std::vector<float> startVY(pile.VY(), pile.VY() + pile.Size());
+
+    double singleThreadUs = 0.0;
+    for (unsigned int threads = 1; threads <= std::max(16u, hardwareThreads); threads *= 2)
+    {
+        JobSystem timedJobs(threads);
+        ContactSolver solver;
+        std::chrono::microseconds solveTime(0);
+        for (unsigned int solve = 0; solve < numSolves; ++solve)
+        {
+            std::copy(startVX.begin(), startVX.end(), pile.VX());
+            std::copy(startVY.begin(), startVY.end(), pile.VY());
+
+            Timer solveTimer{false};
+            solveTimer.Start();
+            solver.Solve(pile, pileBroadphase.GetPairs(), dt, &timedJobs);
+            solveTime += solveTimer.Stop();
+        }
+
+        const double solveUs = static_cast<double>(solveTime.count()) / numSolves;
+        singleThreadUs = (threads == 1) ? solveUs : singleThreadUs;
+        LOG(LogLevel::WARNING, "{:>2} threads: {} contacts, solve avg = {:9.1f}us, speedup = {:.2f}x{}", threads, solver.GetContactCount(),
+            solveUs, singleThreadUs / solveUs, threads > hardwareThreads ? " (more threads than the CPU has)" : "");
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Contact solver tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void JobSystemTest()
+{
+    const unsigned int numThreads   = 4;
+    const size_t       rangeSize    = 1000000;
+    const unsigned int numGraphs    = 1000;
+    const unsigned int numEmptyJobs = 100000;
+    const unsigned int numSteps     = 60;
+
+    unsigned int errors = 0;
+    JobSystem jobs(numThreads);
+
+    // Every index is visited exactly once, in chunks that start on a grain boundary
+    std::vector<uint8_t> visits(rangeSize, 0);
+    std::atomic<unsigned int> misalignedChunks{0};
+    jobs.ParallelFor(rangeSize, 1000, [&](const size_t begin, const size_t end)
+    {
+        misalignedChunks.fetch_add((begin % 1000 != 0 || end - begin > 1000) ? 1 : 0, std::memory_order_relaxed);
+        for (size_t i = begin; i < end; ++i)
+        {
+            ++visits[i];
+        }
+    });
+    errors += misalignedChunks.load();
+    errors += static_cast<unsigned int>(std::count_if(visits.begin(), visits.end(), [](const uint8_t count) { return count != 1; }));
+
+    // A job that depends on a counter only starts once every job of that counter has finished
+    std::atomic<unsigned int> orderErrors{0};
+    for (unsigned int graph = 0; graph < numGraphs; ++graph)
+    {
+        std::array<std::atomic<int>, 8> stage{};
+        JobCounter first;
+        JobCounter second;
+        for (std::atomic<int>& value : stage)
+        {
+            jobs.Schedule(first, [&value] { value.store(1, std::memory_order_relaxed); });
+        }
+        jobs.Schedule(second, [&]
+        {
+            for (const std::atomic<int>& value : stage)
+            {
+                orderErrors.fetch_add(value.load(std::memory_order_relaxed) == 1 ? 0 : 1, std::memory_order_relaxed);
+            }
+        }, &first);
+        jobs.Wait(second);
+    }
+    errors += orderErrors.load();
+
+    // Jobs can wait on loops of their own, with the waiting thread running other jobs meanwhile
+    std::atomic<uint64_t> nestedSum{0};
+    JobCounter outer;
+    for (unsigned int job = 0; job < 16; ++job)
+    {
+        jobs.Schedule(outer, [&]
+        {
+            jobs.ParallelFor(10000, 100, [&](const size_t begin, const size_t end)
+            {
+                nestedSum.fetch_add(end - begin, std::memory_order_relaxed);
+            });
+        });
+    }
+    jobs.Wait(outer);
+    errors += (nestedSum.load() == 16 * 10000) ? 0 : 1;
+
+    // A step run as a job graph matches the same step on one thread exactly
+    BodyStore serialBodies;
+    BodyStore jobBodies;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+    std::uniform_real_distribution<float> velocity(-0.25f, 0.25f);
+    for (unsigned int i = 0; i < 20000; ++i)
+    {
+        const float bodyX = position(random);
+        const float bodyY = position(random);
+        const float bodyVX = velocity(random);
+        const float bodyVY = velocity(random);
+        serialBodies.Add(bodyX, bodyY, bodyVX, bodyVY, 1.0f, BODY_FLAG_NONE, 0.004f);
+        jobBodies.Add(bodyX, bodyY, bodyVX, bodyVY, 1.0f, BODY_FLAG_NONE, 0.004f);
+    }
+    Simulation serialSimulation(serialBodies);
+    Simulation jobSimulation(jobBodies);
+    serialSimulation.EnableContacts();
+    jobSimulation.EnableContacts();
+    jobSimulation.SetJobSystem(&jobs);
+    for (unsigned int step = 0; step < numSteps; ++step)
+    {
+        serialSimulation.Step(1.0f / 120.0f);
+        jobSimulation.Step(1.0f / 120.0f);
+    }
+    std::vector<float> serialPositions(2 * serialBodies.Size());
+    std::vector<float> jobPositions(2 * jobBodies.Size());
+    serialSimulation.InterpolatePositions(0.5f, serialPositions.data());
+    jobSimulation.InterpolatePositions(0.5f, jobPositions.data());
+    errors += (serialPositions == jobPositions) ? 0 : 1;
+
+    // Time what a job costs on its own, and a loop of chunks that do nothing
+    jobs.GetStats();
+    Timer jobTimer{false};
+    jobTimer.Start();
+    JobCounter empty;
+    for (unsigned int job = 0; job < numEmptyJobs; ++job)
+    {
+        jobs.Schedule(empty, [] {});
+        if (job % 1024 == 1023)
+        {
+            jobs.Wait(empty);
+        }
+    }
+    jobs.Wait(empty);
+    const std::chrono::microseconds jobTime = jobTimer.Stop();
+
+    Timer loopTimer{false};
+    loopTimer.Start();
+    for (unsigned int loop = 0; loop < 100; ++loop)
+    {
+        jobs.ParallelFor(rangeSize, 4096, [](size_t, size_t) {});
+    }
+    const std::chrono::microseconds loopTime = loopTimer.Stop();
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Job system errors = {} on {} threads", errors, jobs.GetThreadCount());
+    LOG(LogLevel::WARNING, "Empty job = {:.1f}ns, empty ParallelFor of {} chunks = {:.1f}us",
+        1000.0 * jobTime.count() / numEmptyJobs, (rangeSize + 4095) / 4096, loopTime.count() / 100.0);
+    LogJobStats(jobs.GetStats());
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Job system tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void GravityTest()
+{
+    const unsigned int numBodies      = 20000;
+    const unsigned int numLargeBodies = 1000000;
+    const unsigned int numLargeSteps  = 3;
+    const std::array<float, 4> openingAngles = {0.3f, 0.5f, 0.7f, 1.0f};
+
+    // Half the bodies spread over the world, half in a few dense clusters, so the tree gets both shallow and deep parts
+    const auto addBodies = [](BodyStore& bodies, const unsigned int count)
+    {
+        std::mt19937 random(99);
+        std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+        std::uniform_real_distribution<float> mass(0.5f, 1.5f);
+        std::normal_distribution<float> cluster(0.0f, 0.05f);
+        const std::array<std::array<float, 2>, 4> centers = {{{-0.5f, -0.4f}, {0.3f, 0.6f}, {0.7f, -0.7f}, {-0.9f, 0.9f}}};
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            float x = position(random);
+            float y = position(random);
+            if (i % 2 == 1)
+            {
+                x = WrapCoordinate(centers[i / 2 % 4][0] + cluster(random));
+                y = WrapCoordinate(centers[i / 2 % 4][1] + cluster(random));
+            }
+            bodies.Add(x, y, 0.0f, 0.0f, mass(random));
+        }
+    };
+
+    // Relative error of the tree's accelerations against the exact ones, over all bodies and the worst body
+    const auto compare = [](const std::vector<float>& ax, const std::vector<float>& ay, const std::vector<float>& exactX,
+                            const std::vector<float>& exactY, double& rmsError, double& maxError)
+    {
+        double errorSum = 0.0;
+        double exactSum = 0.0;
+        maxError = 0.0;
+        for (size_t i = 0; i < ax.size(); ++i)
+        {
+            const double error = std::hypot(ax[i] - exactX[i], ay[i] - exactY[i]);
+            const double exact = std::hypot(exactX[i], exactY[i]);
+            errorSum += error * error;
+            exactSum += exact * exact;
+            maxError = std::max(maxError, exact > 0.0 ? error / exact : 0.0);
+        }
+        rmsError = std::sqrt(errorSum / exactSum);
+    };
+
+    unsigned int errors = 0;
+    JobSystem jobs;
+    BodyStore bodies;
+    addBodies(bodies, numBodies);
+
+    std::vector<float> exactX(numBodies);
+    std::vector<float> exactY(numBodies);
+    Timer directTimer{false};
+    directTimer.Start();
+    BarnesHutTree::ComputeDirect(bodies, GravitySettings{}, exactX.data(), exactY.data(), &jobs);
+    const std::chrono::microseconds directTime = directTimer.Stop();
+
+    // Opening nothing, the tree sums the same pairs as the direct path
+    std::vector<float> ax(numBodies);
+    std::vector<float> ay(numBodies);
+    GravitySettings exactSettings;
+    exactSettings.openingAngle = 0.0f;
+    BarnesHutTree tree(exactSettings);
+    tree.Build(bodies, &jobs);
+    tree.ComputeAccelerations(ax.data(), ay.data(), &jobs);
+    double rmsError = 0.0;
+    double maxError = 0.0;
+    compare(ax, ay, exactX, exactY, rmsError, maxError);
+    errors += (maxError < 1e-3) ? 0 : 1;
+    errors += (tree.GetInteractionCount() == static_cast<uint64_t>(numBodies) * numBodies) ? 0 : 1;
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Direct gravity for {} bodies = {:.1f}ms, tree with theta 0 max error = {:.2e}", numBodies, directTime.count() * 1e-3, maxError);
+    for (const float openingAngle : openingAngles)
+    {
+        GravitySettings settings;
+        settings.openingAngle = openingAngle;
+        tree.SetSettings(settings);
+
+        Timer treeTimer{false};
+        treeTimer.Start();
+        tree.Build(bodies, &jobs);
+        tree.ComputeAccelerations(ax.data(), ay.data(), &jobs);
+        const std::chrono::microseconds treeTime = treeTimer.Stop();
+
+        compare(ax, ay, exactX, exactY, rmsError, maxError);
+        errors += (openingAngle <= 0.5f && rmsError > 2e-2) ? 1 : 0;
+        LOG(LogLevel::WARNING, "theta {:.1f}: {:8.1f}ms, {:5.1f}x faster, {:6.0f} interactions/body, rms error = {:.2e}, max error = {:.2e}",
+            openingAngle, treeTime.count() * 1e-3, static_cast<double>(directTime.count()) / std::max<int64_t>(treeTime.count(), 1),
+            static_cast<double>(tree.GetInteractionCount()) / numBodies, rmsError, maxError);
+    }
+    LOG(LogLevel::WARNING, "Gravity errors = {}", errors);
+
+    // Time a step's worth of gravity for a million bodies at the default opening angle
+    BodyStore largeBodies(numLargeBodies);
+    addBodies(largeBodies, numLargeBodies);
+    std::vector<float> largeAX(numLargeBodies);
+    std::vector<float> largeAY(numLargeBodies);
+    BarnesHutTree largeTree;
+    std::chrono::microseconds buildTime(0);
+    std::chrono::microseconds forceTime(0);
+    for (unsigned int step = 0; step < numLargeSteps; ++step)
+    {
+        Timer buildTimer{false};
+        buildTimer.Start();
+        largeTree.Build(largeBodies, &jobs);
+        buildTime += buildTimer.Stop();
+
+        Timer forceTimer{false};
+        forceTimer.Start();
+        largeTree.ComputeAccelerations(largeAX.data(), largeAY.data(), &jobs);
+        forceTime += forceTimer.Stop();
+    }
+    LOG(LogLevel::WARNING, "{} bodies on {} threads: build avg = {:.1f}ms ({} nodes), forces avg = {:.1f}ms, {:.0f} interactions/body",
+        numLargeBodies, jobs.GetThreadCount(), buildTime.count() * 1e-3 / numLargeSteps, largeTree.GetNodeCount(),
+        forceTime.count() * 1e-3 / numLargeSteps, static_cast<double>(largeTree.GetInteractionCount()) / numLargeBodies);
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Gravity tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void BodyReorderTest()
+{
+    const unsigned int numBodies = 500000;
+    const unsigned int numSteps  = 600;
+
+    // Bodies added in random order are scattered in memory relative to space, the worst case
+    const auto addBodies = [](BodyStore& bodies, const unsigned int count, const float speed)
+    {
+        std::mt19937 random(2024);
+        std::uniform_real_distribution<float> position(WORLD_MIN, WORLD_MAX);
+        std::uniform_real_distribution<float> velocity(-speed, speed);
+        const float radius = std::sqrt(WORLD_SIZE * WORLD_SIZE / (3.0f * 3.14159265f * count));
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            bodies.Add(position(random), position(random), velocity(random), velocity(random), 1.0f, BODY_FLAG_NONE, radius);
+        }
+    };
+
+    // Every handle still finds its own body after sorting
+    unsigned int errors = 0;
+    BodyStore bodies(numBodies);
+    addBodies(bodies, numBodies, 0.25f);
+    std::vector<BodyHandle> handles;
+    std::vector<std::array<float, 3>> expected;
+    for (size_t index = 0; index < bodies.Size(); index += 97)
+    {
+        handles.push_back(bodies.HandleAt(index));
+        expected.push_back({bodies.X()[index], bodies.Y()[index], bodies.VX()[index]});
+    }
+    bodies.Remove(handles[1]);
+
+    const float randomDisorder = BodyReorder::MeasureDisorder(bodies);
+    BodyReorder reorder;
+    reorder.Reorder(bodies);
+    const float sortedDisorder = BodyReorder::MeasureDisorder(bodies);
+    errors += (sortedDisorder == 0.0f && randomDisorder > 0.3f) ? 0 : 1;
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        const size_t index = bodies.IndexOf(handles[i]);
+        if (i == 1)
+        {
+            errors += (index == BodyStore::INVALID_INDEX) ? 0 : 1;
+            continue;
+        }
+        if (index == BodyStore::INVALID_INDEX || bodies.X()[index] != expected[i][0] || bodies.Y()[index] != expected[i][1] ||
+            bodies.VX()[index] != expected[i][2] || bodies.HandleAt(index) != handles[i])
+        {
+            ++errors;
+        }
+    }
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Body reorder errors = {}, disorder {:.3f} -> {:.3f}", errors, randomDisorder, sortedDisorder);
+
+    // The same passes over the same bodies in random and in Morton order, timed and with the cache misses they take.
+    // Only the calling thread is counted, so everything runs on it.
+    CacheMissCounter counter;
+    if (!counter.IsAvailable())
+    {
+        LOG(LogLevel::WARNING, "Cache miss counters are not available here, only times are measured");
+    }
+    const auto measurePasses = [&](BodyStore& store, const char* order)
+    {
+        UniformGridBroadphase broadphase;
+        ContactSolver solver;
+        BarnesHutTree tree;
+        Simulation simulation(store);
+        std::vector<float> vertices(2 * store.Size());
+        simulation.Step(1.0f / 120.0f);
+        broadphase.Update(store);
+
+        const auto measure = [&](const char* pass, auto&& function)
+        {
+            counter.Start();
+            Timer passTimer{false};
+            passTimer.Start();
+            function();
+            const std::chrono::microseconds passTime = passTimer.Stop();
+            const CacheMissCounts misses = counter.Stop();
+            LOG(LogLevel::WARNING, "{:>6} order, {:<14}: {:9.1f}us, {:>11} L1D misses, {:>10} LLC misses", order, pass,
+                static_cast<double>(passTime.count()), misses.l1DataMisses, misses.lastLevelMisses);
+        };
+        measure("grid broadphase", [&] { broadphase.Update(store); });
+        measure("contact solve", [&] { solver.Solve(store, broadphase.GetPairs(), 1.0f / 120.0f); });
+        measure("gravity build", [&] { tree.Build(store); });
+        measure("interpolation", [&] { simulation.InterpolatePositions(0.5f, vertices.data()); });
+    };
+    BodyStore randomBodies(numBodies);
+    addBodies(randomBodies, numBodies, 0.25f);
+    measurePasses(randomBodies, "random");
+    measurePasses(bodies, "Morton");
+
+    // Faster bodies degrade the order sooner, so they should be sorted more often
+    for (const float speed : {0.05f, 0.5f, 5.0f})
+    {
+        BodyStore moving(numBodies / 5);
+        addBodies(moving, numBodies / 5, speed);
+        Simulation simulation(moving);
+        simulation.EnableReordering();
+        for (unsigned int step = 0; step < numSteps; ++step)
+        {
+            simulation.Step(1.0f / 120.0f);
+        }
+        const BodyReorder& movingReorder = simulation.GetReorder();
+        LOG(LogLevel::WARNING, "Speed {:4.2f}: {} sorts in {} steps, checking every {} steps, disorder at the last check {:.3f}", speed,
+            movingReorder.GetReorderCount(), numSteps, movingReorder.GetCheckInterval(), movingReorder.GetLastDisorder());
+    }
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Body reorder tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
+
+void DrawQueueTest()
+{
+    // Shader, vertex array pairs told apart by their keys, the queue doesn't look behind the pointers
+    const unsigned int numShaders = 8;
+    const unsigned int numArrays = 16;
+    const unsigned int numStates = numShaders * numArrays;
+    const unsigned int instancesPerCommand = 64;
+
+    JobSystem jobs;
+    DrawQueue queue;
+    unsigned int errors = 0;
+    for (const unsigned int numCommands : {1024u, 16384u, 262144u, 1048576u})
+    {
+        // Every state gets as many instanced commands, splitting one instance range, as plain draws of its own index ranges
+        std::vector<DrawCommand> commands(numCommands);
+        for (unsigned int i = 0; i < numCommands; ++i)
+        {
+            const unsigned int state = i % numStates;
+            const unsigned int nth = i / numStates;
+            DrawCommand& command = commands[i];
+            command.indexCount = 6;
+            if (nth % 2 == 0)
+            {
+                command.key = MakeDrawKey(state / numArrays, state % numArrays, 0, 0);
+                command.instanceCount = instancesPerCommand;
+                command.firstInstance = (nth / 2) * instancesPerCommand;
+            }
+            else
+            {
+                // Further than the instanced draws, in any order among themselves
+                command.key = MakeDrawKey(state / numArrays, state % numArrays, 0, static_cast<uint16_t>(1 + (nth * 7919) % 65535));
+                command.firstIndex = 6 * (nth / 2);
+            }
+        }
+        std::shuffle(commands.begin(), commands.end(), std::mt19937(7));
+
+        jobs.ParallelFor(numCommands, 4096, [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                queue.Record(commands[i]);
+            }
+        });
+
+        Timer buildTimer{false};
+        buildTimer.Start();
+        const std::vector<DrawBatch>& batches = queue.Build();
+        const std::chrono::microseconds buildTime = buildTimer.Stop();
+
+        // One instanced draw and one multi draw per state, covering everything that was recorded
+        uint64_t instances = 0;
+        uint64_t ranges = 0;
+        for (const DrawBatch& batch : batches)
+        {
+            if (batch.multiDrawCount > 0)
+            {
+                ranges += batch.multiDrawCount;
+            }
+            else
+            {
+                instances += batch.instanceCount;
+                errors += (batch.firstInstance == 0) ? 0 : 1;
+            }
+        }
+        const unsigned int instancedCommands = numCommands / 2; // The counts are multiples of 2 * numStates
+        errors += (batches.size() == 2 * numStates) ? 0 : 1;
+        errors += (instances == uint64_t{instancedCommands} * instancesPerCommand) ? 0 : 1;
+        errors += (ranges == numCommands - instancedCommands) ? 0 : 1;
+        errors += (queue.GetStats().commands == numCommands) ? 0 : 1;
+
+        LOG(LogLevel::WARNING, "{:>8} commands sorted and merged into {:>4} draw calls in {:8.1f}us ({:.1f}ns per command)", numCommands,
+            batches.size(), static_cast<double>(buildTime.count()), 1000.0 * static_cast<double>(buildTime.count()) / numCommands);
+    }
+
+    // An empty frame leaves nothing behind
+    errors += (queue.Build().empty() && queue.GetStats().commands == 0) ? 0 : 1;
+
+    LOG(LogLevel::WARNING, "-----------------------------");
+    LOG(LogLevel::WARNING, "Draw queue errors = {}", errors);
+    LOG(LogLevel::WARNING, "Draw queue tests finished.");
+    LOG(LogLevel::WARNING, "-----------------------------");
+}
@@ -13,4 +13,185 @@
 //===============================================================
 void LogTimerTest();
 
+//===============================================================
+// LogContentionTest()
+// This function measures how the Logger behaves when several
+// threads log at the same time. For 1 to 16 producer threads it
+// logs a fixed number of messages from every thread and reports
+// the average cost of a LOG call, the overall throughput and
+// how many messages were dropped because the queue was full.
+//===============================================================
+void LogContentionTest();
+
+//===============================================================
+// LogDeferredFormatTest()
+// This function measures the cost of a LOG call on the calling
+// thread when the formatting is deferred to the logging thread,
+// and compares it to formatting the same message on the calling
+// thread before handing it to the logger.
+//===============================================================
+void LogDeferredFormatTest();
+
+//===============================================================
+// LogSinkThroughputTest()
+// This function measures how many messages per second the
+// Logger can write through each kind of sink (console, file,
+// rotating file and memory mapped file). The logger's sinks are
+// swapped out for each run and the console sink is restored
+// at the end.
+//===============================================================
+void LogSinkThroughputTest();
+
+//===============================================================
+// LogTimestampTest()
+// This function compares the cost of turning a timestamp into
+// the logger's HH:MM:SS.hh text with GetTimeString (localtime
+// and std::format on every call) against the cached formatting
+// the logging thread uses for Timer::Ticks() timestamps.
+//===============================================================
+void LogTimestampTest();
+
+//===============================================================
+// LogOverflowPolicyTest()
+// This function floods a separate Logger from several threads
+// with far more messages than their buffers hold, once for each
+// OverflowPolicy, and reports the average cost of a LOG call
+// along with how many messages were dropped, overwritten or
+// had to wait for space.
+//===============================================================
+void LogOverflowPolicyTest();
+
+//===============================================================
+// CircularBufferTest()
+// This function compares CircularBuffer against
+// FixedCircularBuffer: single element emplace/pop, bulk
+// push_n/pop_n, and a producer and consumer thread sharing an
+// SPSC buffer. Results are average nanoseconds per element.
+//===============================================================
+void CircularBufferTest();
+
+//===============================================================
+// ProfilerOverheadTest()
+// This function measures the cost of a PROFILE_SCOPE on the
+// calling thread against timing the same work with a Timer,
+// and the cost of Profiler::EndFrame aggregating a frame's
+// worth of zones. Records into the main Profiler.
+//===============================================================
+void ProfilerOverheadTest();
+
+//===============================================================
+// TraceWriterTest()
+// This function runs the same simulated frames through a
+// Profiler with and without a TraceWriter attached, and reports
+// the per-frame cost of tracing and the size of the trace file.
+// Records into the main Profiler.
+//===============================================================
+void TraceWriterTest();
+
+//===============================================================
+// BodyStoreTest()
+// This function fills a BodyStore with a million bodies, removes
+// every third one and checks that the remaining handles still
+// find their bodies. It then times a position update over the
+// store's separate arrays against the same update over
+// interleaved body structs.
+//===============================================================
+void BodyStoreTest();
+
+//===============================================================
+// SimulationStepTest()
+// This function feeds a FixedStepClock a series of frame times,
+// including a stall, and checks the number of steps it runs and
+// skips. It then checks that interpolated positions stay between
+// the last two steps and don't sweep across the world when a body
+// wraps, and times a step over a hundred thousand bodies.
+//===============================================================
+void SimulationStepTest();
+
+//===============================================================
+// IntegratorBenchmarkTest()
+// This function steps a million bodies under gravity and drag
+// with every integrator, compiled for every instruction set the
+// CPU supports, and reports bodies per second on one core. It
+// checks that the SIMD versions match the scalar one and compares
+// each integrator's velocity with the exact solution.
+//===============================================================
+void IntegratorBenchmarkTest();
+
+//===============================================================
+// BroadphaseTest()
+// This function checks the pairs the UniformGridBroadphase finds
+// against testing every pair of bodies, with bodies straddling the
+// world's edges. It then times rebuilding the grid for growing
+// numbers of bodies.
+//===============================================================
+void BroadphaseTest();
+
+//===============================================================
+// AabbTreeTest()
+// This function moves bodies of widely varying sizes around for a
+// number of steps, removing and adding some every step, and checks
+// that the AabbTreeBroadphase finds the same pairs as the grid and
+// that the tree stays valid. It checks ray casts against testing
+// every body, then times both broadphases on bodies of the same
+// size and of widely varying sizes.
+//===============================================================
+void AabbTreeTest();
+
+//===============================================================
+// ContactSolverTest()
+// This function packs bodies so tightly that each overlaps its
+// neighbours, with a row of static bodies through them, and lets
+// the ContactSolver push them apart. It checks that solving on a
+// JobSystem gives exactly the same velocities as solving on one
+// thread and that the overlap shrinks, then times a solve of a
+// large pile on growing numbers of threads.
+//===============================================================
+void ContactSolverTest();
+
+//===============================================================
+// JobSystemTest()
+// This function checks that ParallelFor visits every index once,
+// that jobs with a dependency only start after the jobs they
+// depend on, and that jobs can wait on loops of their own. It
+// checks that a physics step run as a job graph matches the
+// serial step exactly, then times empty jobs and loops and logs
+// each thread's utilization.
+//===============================================================
+void JobSystemTest();
+
+//===============================================================
+// GravityTest()
+// This function scatters bodies over the world and into a few
+// dense clusters, and compares the Barnes-Hut accelerations with
+// the exact O(n^2) sum. It checks that opening every node gives
+// the exact result and that small opening angles stay accurate,
+// logs the error and speedup for a range of opening angles, then
+// times building the tree and computing the forces for a million
+// bodies.
+//===============================================================
+void GravityTest();
+
+//===============================================================
+// BodyReorderTest()
+// This function sorts randomly ordered bodies by Morton code and
+// checks that every handle still finds its own body and that the
+// order is measured as sorted. It times the broadphase, contact
+// solve, gravity tree build and interpolation before and after
+// sorting, with cache miss counters where the system has them,
+// and logs how often bodies moving at different speeds are sorted.
+//===============================================================
+void BodyReorderTest();
+
+//===============================================================
+// DrawQueueTest()
+// This function records draw commands for many states in random
+// order, from job threads, and checks that the queue sorts them
+// by key and merges every state's instance ranges into one
+// instanced draw and its plain draws into one multi draw, with
+// no instance or index range lost. It times the sort and merge
+// for growing numbers of commands.
+//===============================================================
+void DrawQueueTest();
+
 #endif // !UNIT_TESTS_H
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "VertexArray.h"
 
+#include <cstdint>
+#include <utility>
+
+#include "GlStateCache.h"
 #include "OpenGlUtils.h"
 
 VertexArray::VertexArray()
@@ -10,31 +14,51 @@ VertexArray::VertexArray()
 
 VertexArray::~VertexArray()
 {
-    GL_CALL(glDeleteVertexArrays(1, &m_RendererId));
+    CurrentGlState().DeleteVertexArray(m_RendererId);
 }
 
 void VertexArray::AddBuffer(const VertexBuffer &vb, const VertexBufferLayout &layout)
+{
+    AddBuffer(vb.GetRendererId(), 0, layout.Share());
+}
+
+void VertexArray::AddBuffer(const StreamingVertexBuffer &vb, const VertexBufferLayout &layout)
+{
+    AddBuffer(vb.GetRendererId(), vb.GetOffset(), layout.Share());
+}
+
+void VertexArray::AddBuffer(const unsigned int rendererId, unsigned int offset, std::shared_ptr<const VertexBufferLayout> layout)
 {
     Bind(); // Bind the Vertex Array Object
-    vb.Bind();
-    const auto& elements = layout.GetElements();
-    unsigned int offset = 0;
-    for (int i = 0; i < elements.size(); i++)
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, rendererId); // The attribute pointers capture the bound buffer
+
+    const auto& elements = layout->GetElements();
+    for (unsigned int i = 0; i < elements.size(); i++)
     {
         const auto& element = elements[i];
-        GL_CALL(glEnableVertexAttribArray(i)); // Enable the vertex attribute at index 0
-        GL_CALL(glVertexAttribPointer(i, element.count, element.type, 
-            element.normalized, layout.GetStride(), (const void*)offset));
+        const unsigned int location = m_AttributeCount + i;
+        GL_CALL(glEnableVertexAttribArray(location)); // Enable the vertex attribute at its location
+        GL_CALL(glVertexAttribPointer(location, element.count, element.type, 
+            element.normalized, layout->GetStride(), reinterpret_cast<const void*>(static_cast<uintptr_t>(offset))));
+        GL_CALL(glVertexAttribDivisor(location, element.divisor)); // Per vertex or per instance
         offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
     }
+    m_AttributeCount += static_cast<unsigned int>(elements.size());
+    m_Layouts.push_back(std::move(layout));
+}
+
+void VertexArray::SetIndexBuffer(const unsigned int rendererId)
+{
+    Bind();
+    CurrentGlState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, rendererId); // The element buffer binding is part of the VAO state
 }
 
 void VertexArray::Bind() const
 {
-    GL_CALL(glBindVertexArray(m_RendererId));
+    CurrentGlState().BindVertexArray(m_RendererId);
 }
 
 void VertexArray::Unbind() const
 {
-    GL_CALL(glBindVertexArray(0));
+    CurrentGlState().BindVertexArray(0);
 }
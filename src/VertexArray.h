@@ -1,7 +1,17 @@
 #ifndef VERTEX_ARRAY_H
 #define VERTEX_ARRAY_H
 // VertexArray.h
+// A VAO records which buffers the attributes read from and how, once, when the buffers are
+// added. Drawing then only binds it. A buffer's attributes can't be moved to another buffer
+// or offset afterwards; draws that read other buffers or regions use another VertexArray,
+// see VertexArrayCache.
 
+// C++ Standard Library includes
+#include <memory>
+#include <vector>
+
+// Project includes
+#include "StreamingVertexBuffer.h"
 #include "VertexBuffer.h"
 #include "VertexBufferLayout.h"
 
@@ -10,16 +20,32 @@ class VertexArray
 private:
     unsigned int m_RendererId; // OpenGL buffer ID
 
-    // Store the layout of the vertex attributes
-    std::vector<VertexBufferLayout> m_Layouts;
+    // The shared layout of each buffer's vertex attributes
+    std::vector<std::shared_ptr<const VertexBufferLayout>> m_Layouts;
+    unsigned int m_AttributeCount = 0; // Attribute locations used by the buffers added so far
+
 public:
     VertexArray();
     ~VertexArray();
 
+    VertexArray(const VertexArray&) = delete;
+    VertexArray& operator=(const VertexArray&) = delete;
+
+    // Add a buffer whose attributes take the next locations, after those of the buffers added before it
     void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
+    // The attributes read from the region the streaming buffer was last mapped at
+    void AddBuffer(const StreamingVertexBuffer& vb, const VertexBufferLayout& layout);
+    // The attributes read from the buffer with the OpenGL ID rendererId, from offset bytes
+    void AddBuffer(unsigned int rendererId, unsigned int offset, std::shared_ptr<const VertexBufferLayout> layout);
+
+    // Record the element buffer the draws read the indices from
+    void SetIndexBuffer(unsigned int rendererId);
+
+    inline const std::vector<std::shared_ptr<const VertexBufferLayout>>& GetLayouts() const { return m_Layouts; }
+    inline unsigned int GetRendererId() const { return m_RendererId; }
 
     void Bind() const;
     void Unbind() const;
 };
 
-#endif // !VERTEX_ARRAY_H
\ No newline at end of file
+#endif // !VERTEX_ARRAY_H
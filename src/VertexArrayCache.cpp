@@ -0,0 +1,64 @@
+#include "VertexArrayCache.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+// More entries than this means the keys keep changing (say buffers recreated without a Clear),
+// so the cache is emptied rather than left to grow
+static constexpr size_t MAX_ENTRIES = 64;
+
+static size_t HashBindings(const VertexBufferBinding* bindings, const size_t count, const unsigned int indexBufferId)
+{
+    size_t hash = std::hash<unsigned int>{}(indexBufferId);
+    const auto combine = [&hash](const size_t value)
+    {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    };
+    for (size_t i = 0; i < count; ++i)
+    {
+        combine(bindings[i].rendererId);
+        combine(bindings[i].offset);
+        combine(std::hash<const VertexBufferLayout*>{}(bindings[i].layout.get()));
+    }
+    return hash;
+}
+
+const VertexArray& VertexArrayCache::Get(const VertexBufferBinding* bindings, const size_t count, const unsigned int indexBufferId)
+{
+    const size_t hash = HashBindings(bindings, count, indexBufferId);
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.hash == hash && entry.indexBufferId == indexBufferId && entry.bindings.size() == count &&
+            std::equal(bindings, bindings + count, entry.bindings.begin()))
+        {
+            return *entry.va;
+        }
+    }
+
+    if (m_entries.size() >= MAX_ENTRIES)
+    {
+        Clear();
+    }
+
+    Entry entry;
+    entry.hash = hash;
+    entry.bindings.assign(bindings, bindings + count);
+    entry.indexBufferId = indexBufferId;
+    entry.va = std::make_unique<VertexArray>();
+    for (size_t i = 0; i < count; ++i)
+    {
+        entry.va->AddBuffer(bindings[i].rendererId, bindings[i].offset, bindings[i].layout);
+    }
+    entry.va->SetIndexBuffer(indexBufferId);
+    entry.va->Unbind();
+    ++m_buildCount;
+
+    m_entries.push_back(std::move(entry));
+    return *m_entries.back().va;
+}
+
+void VertexArrayCache::Clear()
+{
+    m_entries.clear();
+}
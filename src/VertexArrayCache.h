@@ -0,0 +1,67 @@
+#ifndef VERTEX_ARRAY_CACHE_H
+#define VERTEX_ARRAY_CACHE_H
+// VertexArrayCache.h
+// This file contains a cache of VertexArrays keyed by the buffers they read from.
+// Re-pointing the attributes of one VAO at new buffers or offsets before every draw
+// costs a glBindBuffer and a glVertexAttribPointer per attribute each frame, and makes
+// the driver validate the vertex state again. Instead every distinct set of bindings
+// (buffer IDs, offsets, shared layouts and element buffer) gets its own VAO, recorded
+// once the first time it is asked for, and drawing only binds it. A streaming buffer
+// cycling through its regions needs one VAO per region, so the cache settles after the
+// first few frames. Layouts are compared by pointer, so they must come from
+// VertexBufferLayout::Share.
+// OpenGL may hand a deleted buffer's ID to a new buffer, which would match the VAO still
+// holding the old one, so call Clear whenever a buffer the cache has seen is deleted or
+// reallocated.
+
+// C++ Standard Library includes
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Project includes
+#include "VertexArray.h"
+#include "VertexBufferLayout.h"
+
+// One vertex buffer read by a VertexArray: its attributes, in layout, start offset bytes into the buffer
+struct VertexBufferBinding
+{
+    unsigned int rendererId = 0; // OpenGL buffer ID
+    unsigned int offset     = 0;
+    std::shared_ptr<const VertexBufferLayout> layout;
+
+    bool operator==(const VertexBufferBinding& other) const
+    {
+        return rendererId == other.rendererId && offset == other.offset && layout == other.layout;
+    }
+};
+
+class VertexArrayCache
+{
+public:
+    // The VertexArray reading count buffers from bindings (their attributes taking consecutive locations,
+    // in order) and the indices from the element buffer indexBufferId. Records it if it isn't cached yet.
+    const VertexArray& Get(const VertexBufferBinding* bindings, size_t count, unsigned int indexBufferId);
+
+    // Delete every cached VertexArray
+    void Clear();
+
+    // Statistics
+    size_t   GetSize()       const { return m_entries.size(); }
+    uint64_t GetBuildCount() const { return m_buildCount; } // VertexArrays recorded so far
+
+private:
+    struct Entry
+    {
+        size_t                           hash = 0;
+        std::vector<VertexBufferBinding> bindings;
+        unsigned int                     indexBufferId = 0;
+        std::unique_ptr<VertexArray>     va;
+    };
+
+    std::vector<Entry> m_entries;
+    uint64_t           m_buildCount = 0;
+};
+
+#endif // !VERTEX_ARRAY_CACHE_H
@@ -1,32 +1,40 @@
 #include "VertexBuffer.h"
 
+#include "GlStateCache.h"
 #include "OpenGlUtils.h"
 
 VertexBuffer::VertexBuffer(const void *data, unsigned int size)
+    : m_Size(size)
 {
     // Create a vertex array buffer to put data into
     GL_CALL(glGenBuffers(1, &m_RendererId));
-    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererId));
+    Bind();
     GL_CALL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW));
 }
 
 VertexBuffer::~VertexBuffer()
 {
-    GL_CALL(glDeleteBuffers(1, &m_RendererId));
+    CurrentGlState().DeleteBuffer(m_RendererId);
 }
 
 void VertexBuffer::Bind() const
 {
-    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererId));
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, m_RendererId);
 }
 
 void VertexBuffer::Unbind() const
 {
-    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    CurrentGlState().BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void VertexBuffer::UpdateData(const void* data, unsigned int size)
 {
     Bind();
+    if (size > m_Size)
+    {
+        // Grow by half again, so a slowly growing body count doesn't reallocate every frame
+        m_Size = size + size / 2;
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW));
+    }
     GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
 }
@@ -6,6 +6,7 @@ class VertexBuffer
 {
 private:
     unsigned int m_RendererId; // OpenGL buffer ID
+    unsigned int m_Size;       // Bytes allocated for the buffer
 
 public:
     VertexBuffer(const void* data, unsigned int size);
@@ -14,7 +15,11 @@ public:
     void Bind() const;
     void Unbind() const;
 
+    // Replace the start of the buffer with size bytes, reallocating it if it is smaller than that
     void UpdateData(const void* data, unsigned int size);
+
+    inline unsigned int GetSize() const { return m_Size; }
+    inline unsigned int GetRendererId() const { return m_RendererId; }
 };
 
 #endif // !VERTEX_BUFFER_H
@@ -1,5 +1,12 @@
 #include "VertexBufferLayout.h"
 
+#include <mutex>
+#include <unordered_map>
+
+// Every shared layout by hash. Entries of layouts nobody holds any more are dropped when their hash comes up again.
+static std::mutex s_SharedLayoutsMutex;
+static std::unordered_multimap<size_t, std::weak_ptr<const VertexBufferLayout>> s_SharedLayouts;
+
 VertexBufferLayout::VertexBufferLayout()
 {
 }
@@ -7,3 +14,58 @@ VertexBufferLayout::VertexBufferLayout()
 VertexBufferLayout::~VertexBufferLayout()
 {
 }
+
+void VertexBufferLayout::AddElement(const VertexBufferElement& element)
+{
+    m_Elements.push_back(element);
+    m_Stride += element.count * VertexBufferElement::GetSizeOfType(element.type);
+
+    // Combine the element into the hash (the boost hash_combine mix)
+    const size_t values[] = {element.type, element.count, element.normalized, element.divisor};
+    for (const size_t value : values)
+    {
+        m_Hash ^= value + 0x9e3779b97f4a7c15ull + (m_Hash << 6) + (m_Hash >> 2);
+    }
+}
+
+bool VertexBufferLayout::operator==(const VertexBufferLayout& other) const
+{
+    if (m_Hash != other.m_Hash || m_Stride != other.m_Stride || m_Elements.size() != other.m_Elements.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < m_Elements.size(); i++)
+    {
+        const VertexBufferElement& a = m_Elements[i];
+        const VertexBufferElement& b = other.m_Elements[i];
+        if (a.type != b.type || a.count != b.count || a.normalized != b.normalized || a.divisor != b.divisor)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const VertexBufferLayout> VertexBufferLayout::Share() const
+{
+    std::lock_guard<std::mutex> lock(s_SharedLayoutsMutex);
+    auto [begin, end] = s_SharedLayouts.equal_range(m_Hash);
+    for (auto it = begin; it != end;)
+    {
+        std::shared_ptr<const VertexBufferLayout> shared = it->second.lock();
+        if (shared == nullptr)
+        {
+            it = s_SharedLayouts.erase(it);
+            continue;
+        }
+        if (*shared == *this)
+        {
+            return shared;
+        }
+        ++it;
+    }
+
+    std::shared_ptr<const VertexBufferLayout> shared = std::make_shared<const VertexBufferLayout>(*this);
+    s_SharedLayouts.emplace(m_Hash, shared);
+    return shared;
+}
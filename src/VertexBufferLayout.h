@@ -1,7 +1,12 @@
 #ifndef VERTEX_BUFFER_LAYOUT_H
 #define VERTEX_BUFFER_LAYOUT_H
 // VertexBufferLayout.h
+// A layout is built with Push and then shared: Share() returns the one immutable copy of
+// every equal layout, so VAOs that use the same layout hold the same object, and two
+// layouts can be compared (and hashed, for the VertexArrayCache) by their pointer.
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 #include <GL/glew.h>
@@ -14,6 +19,7 @@ struct VertexBufferElement
     unsigned int  type;
     unsigned int  count;
     unsigned char normalized;
+    unsigned int  divisor; // 0 advances per vertex, n advances once every n instances
 
     static unsigned int GetSizeOfType(unsigned int type)
     {
@@ -37,47 +43,59 @@ class VertexBufferLayout
 private:
     std::vector<VertexBufferElement> m_Elements;
     unsigned int                     m_Stride = 0;
+    size_t                           m_Hash = 0; // Of every element, updated by Push
+
+    void AddElement(const VertexBufferElement& element);
 
 public:
     VertexBufferLayout();
     ~VertexBufferLayout();
 
+    // Add an attribute of count values. A divisor above 0 makes it a per-instance attribute for instanced draws.
     template<typename T>
-    void Push(unsigned int count)
+    void Push(unsigned int count, unsigned int divisor = 0)
     {
         // static_assert(false);
     }
 
-    template<>
-    void Push<float>(unsigned int count)
+    inline const std::vector<VertexBufferElement>& GetElements() const
     {
-        m_Elements.push_back({GL_FLOAT, count, GL_FALSE});
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_FLOAT);
+        return m_Elements;
     }
 
-    template<>
-    void Push<unsigned int>(unsigned int count)
+    inline unsigned int GetStride() const
     {
-        m_Elements.push_back({GL_UNSIGNED_INT, count, GL_FALSE});
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT);
+        return m_Stride;
     }
 
-    template<>
-    void Push<unsigned char>(unsigned int count)
+    inline size_t GetHash() const
     {
-        m_Elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
+        return m_Hash;
     }
 
-    inline const std::vector<VertexBufferElement> GetElements() const
-    {
-        return m_Elements;
-    }
+    bool operator==(const VertexBufferLayout& other) const;
 
-    inline unsigned int GetStride() const
-    {
-        return m_Stride;
-    }
+    // The shared, immutable copy of every layout equal to this one
+    std::shared_ptr<const VertexBufferLayout> Share() const;
 };
 
+// The specializations are at namespace scope, GCC rejects explicit specializations inside the class
+template<>
+inline void VertexBufferLayout::Push<float>(unsigned int count, unsigned int divisor)
+{
+    AddElement({GL_FLOAT, count, GL_FALSE, divisor});
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned int>(unsigned int count, unsigned int divisor)
+{
+    AddElement({GL_UNSIGNED_INT, count, GL_FALSE, divisor});
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned char>(unsigned int count, unsigned int divisor)
+{
+    AddElement({GL_UNSIGNED_BYTE, count, GL_TRUE, divisor});
+}
+
 #endif